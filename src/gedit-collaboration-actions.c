@@ -48,7 +48,7 @@ on_item_new_response (GtkDialog *dialog,
 		if (item->newfile)
 		{
 			InfcNotePlugin *plugin;
-			plugin = gedit_collaboration_manager_get_note_plugin (item->helper->priv->manager);
+			plugin = gedit_collaboration_core_get_note_plugin (item->helper->priv->core);
 
 			request = infc_browser_add_note (item->browser,
 			                                 &parent,
@@ -271,8 +271,16 @@ on_action_item_delete (GtkAction                      *action,
 		inf_gtk_browser_store_remove_connection (helper->priv->browser_store,
 		                                         connection);
 
+		/* Temporary bookmarks (opened by location) are not saved */
+		g_object_ref (bookmark);
+
+		gedit_collaboration_core_remove_temporary_bookmark (helper->priv->core,
+		                                                    bookmark);
+
 		bookmarks = gedit_collaboration_bookmarks_get_default ();
 		gedit_collaboration_bookmarks_remove (bookmarks, bookmark);
+
+		g_object_unref (bookmark);
 	}
 	else
 	{
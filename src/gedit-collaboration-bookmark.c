@@ -11,6 +11,8 @@ struct _GeditCollaborationBookmarkPrivate
 	gchar *host;
 	gint port;
 	GeditCollaborationUser *user;
+
+	gdouble connect_time;
 };
 
 /* Properties */
@@ -20,7 +22,8 @@ enum {
 	PROP_NAME,
 	PROP_HOST,
 	PROP_PORT,
-	PROP_USER
+	PROP_USER,
+	PROP_CONNECT_TIME
 };
 
 G_DEFINE_DYNAMIC_TYPE (GeditCollaborationBookmark,
@@ -101,6 +104,9 @@ gedit_collaboration_bookmark_get_property (GObject    *object,
 		case PROP_USER:
 			g_value_set_object (value, self->priv->user);
 		break;
+		case PROP_CONNECT_TIME:
+			g_value_set_double (value, self->priv->connect_time);
+		break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -167,6 +173,17 @@ gedit_collaboration_bookmark_class_init (GeditCollaborationBookmarkClass *klass)
 	                                                      GEDIT_COLLABORATION_TYPE_USER,
 	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
 
+	/* Not persisted, only tracks the last successful connect */
+	g_object_class_install_property (object_class,
+	                                 PROP_CONNECT_TIME,
+	                                 g_param_spec_double ("connect-time",
+	                                                      "Connect Time",
+	                                                      "Connect Time",
+	                                                      -1,
+	                                                      G_MAXDOUBLE,
+	                                                      -1,
+	                                                      G_PARAM_READABLE));
+
 	g_type_class_add_private (object_class, sizeof(GeditCollaborationBookmarkPrivate));
 }
 
@@ -179,6 +196,7 @@ static void
 gedit_collaboration_bookmark_init (GeditCollaborationBookmark *self)
 {
 	self->priv = GEDIT_COLLABORATION_BOOKMARK_GET_PRIVATE (self);
+	self->priv->connect_time = -1;
 }
 
 GeditCollaborationBookmark *
@@ -244,6 +262,23 @@ gedit_collaboration_bookmark_get_user (GeditCollaborationBookmark *bookmark)
 	return bookmark->priv->user;
 }
 
+gdouble
+gedit_collaboration_bookmark_get_connect_time (GeditCollaborationBookmark *bookmark)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_BOOKMARK (bookmark), -1);
+	return bookmark->priv->connect_time;
+}
+
+void
+_gedit_collaboration_bookmark_set_connect_time (GeditCollaborationBookmark *bookmark,
+                                                gdouble                     connect_time)
+{
+	g_return_if_fail (GEDIT_COLLABORATION_IS_BOOKMARK (bookmark));
+
+	bookmark->priv->connect_time = connect_time;
+	g_object_notify (G_OBJECT (bookmark), "connect-time");
+}
+
 void
 _gedit_collaboration_bookmark_register_type (GTypeModule *type_module)
 {
@@ -51,6 +51,10 @@ void gedit_collaboration_bookmark_set_port (GeditCollaborationBookmark *bookmark
 
 GeditCollaborationUser *gedit_collaboration_bookmark_get_user (GeditCollaborationBookmark *bookmark);
 
+gdouble gedit_collaboration_bookmark_get_connect_time (GeditCollaborationBookmark *bookmark);
+void _gedit_collaboration_bookmark_set_connect_time (GeditCollaborationBookmark *bookmark,
+                                                     gdouble                     connect_time);
+
 G_END_DECLS
 
 #endif /* __GEDIT_COLLABORATION_BOOKMARK_H__ */
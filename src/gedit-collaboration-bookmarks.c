@@ -276,6 +276,12 @@ on_bookmark_changed (GeditCollaborationBookmark  *bookmark,
                      GParamSpec                  *spec,
                      GeditCollaborationBookmarks *bookmarks)
 {
+	/* Runtime statistics are not saved */
+	if (g_strcmp0 (spec->name, "connect-time") == 0)
+	{
+		return;
+	}
+
 	if (bookmarks->priv->idle_save_id == 0)
 	{
 		bookmarks->priv->idle_save_id = g_idle_add ((GSourceFunc)bookmarks_idle_save,
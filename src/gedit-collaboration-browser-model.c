@@ -0,0 +1,154 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-browser-model.h"
+
+#define GEDIT_COLLABORATION_BROWSER_MODEL_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_BROWSER_MODEL, GeditCollaborationBrowserModelPrivate))
+
+struct _GeditCollaborationBrowserModelPrivate
+{
+	GeditCollaborationCollationCache *cache;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_COLLATION_CACHE
+};
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationBrowserModel,
+                       gedit_collaboration_browser_model,
+                       INF_GTK_TYPE_BROWSER_MODEL_SORT)
+
+/* The sort model places every new row with a binary search over its
+   level, the collation keys keep those comparisons cheap */
+static gint
+compare_func (GtkTreeModel *child_model,
+              GtkTreeIter  *first,
+              GtkTreeIter  *second,
+              gpointer      user_data)
+{
+	GeditCollaborationBrowserModel *model = user_data;
+
+	return gedit_collaboration_collation_cache_compare (model->priv->cache,
+	                                                    child_model,
+	                                                    first,
+	                                                    second);
+}
+
+static void
+gedit_collaboration_browser_model_dispose (GObject *object)
+{
+	GeditCollaborationBrowserModel *model = GEDIT_COLLABORATION_BROWSER_MODEL (object);
+
+	if (model->priv->cache)
+	{
+		g_object_unref (model->priv->cache);
+		model->priv->cache = NULL;
+	}
+
+	G_OBJECT_CLASS (gedit_collaboration_browser_model_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_browser_model_set_property (GObject      *object,
+                                                guint         prop_id,
+                                                const GValue *value,
+                                                GParamSpec   *pspec)
+{
+	GeditCollaborationBrowserModel *self = GEDIT_COLLABORATION_BROWSER_MODEL (object);
+
+	switch (prop_id)
+	{
+		case PROP_COLLATION_CACHE:
+			self->priv->cache = g_value_dup_object (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_browser_model_get_property (GObject    *object,
+                                                guint       prop_id,
+                                                GValue     *value,
+                                                GParamSpec *pspec)
+{
+	GeditCollaborationBrowserModel *self = GEDIT_COLLABORATION_BROWSER_MODEL (object);
+
+	switch (prop_id)
+	{
+		case PROP_COLLATION_CACHE:
+			g_value_set_object (value, self->priv->cache);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_browser_model_constructed (GObject *object)
+{
+	GeditCollaborationBrowserModel *model = GEDIT_COLLABORATION_BROWSER_MODEL (object);
+
+	if (G_OBJECT_CLASS (gedit_collaboration_browser_model_parent_class)->constructed)
+	{
+		G_OBJECT_CLASS (gedit_collaboration_browser_model_parent_class)->constructed (object);
+	}
+
+	gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (model),
+	                                         compare_func,
+	                                         model,
+	                                         NULL);
+}
+
+static void
+gedit_collaboration_browser_model_class_init (GeditCollaborationBrowserModelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_browser_model_dispose;
+	object_class->constructed = gedit_collaboration_browser_model_constructed;
+
+	object_class->set_property = gedit_collaboration_browser_model_set_property;
+	object_class->get_property = gedit_collaboration_browser_model_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_COLLATION_CACHE,
+	                                 g_param_spec_object ("collation-cache",
+	                                                      "Collation Cache",
+	                                                      "Collation cache used for sorting",
+	                                                      GEDIT_COLLABORATION_TYPE_COLLATION_CACHE,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationBrowserModelPrivate));
+}
+
+static void
+gedit_collaboration_browser_model_class_finalize (GeditCollaborationBrowserModelClass *klass)
+{
+}
+
+static void
+gedit_collaboration_browser_model_init (GeditCollaborationBrowserModel *self)
+{
+	self->priv = GEDIT_COLLABORATION_BROWSER_MODEL_GET_PRIVATE (self);
+}
+
+GeditCollaborationBrowserModel *
+gedit_collaboration_browser_model_new (InfGtkBrowserModel               *child_model,
+                                       GeditCollaborationCollationCache *cache)
+{
+	return g_object_new (GEDIT_COLLABORATION_TYPE_BROWSER_MODEL,
+	                     "model", child_model,
+	                     "collation-cache", cache,
+	                     NULL);
+}
+
+void
+_gedit_collaboration_browser_model_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_browser_model_register_type (type_module);
+}
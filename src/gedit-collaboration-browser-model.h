@@ -0,0 +1,43 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_BROWSER_MODEL_H__
+#define __GEDIT_COLLABORATION_BROWSER_MODEL_H__
+
+#include <libinfgtk/inf-gtk-browser-model-sort.h>
+#include "gedit-collaboration-collation-cache.h"
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_BROWSER_MODEL		(gedit_collaboration_browser_model_get_type ())
+#define GEDIT_COLLABORATION_BROWSER_MODEL(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_BROWSER_MODEL, GeditCollaborationBrowserModel))
+#define GEDIT_COLLABORATION_BROWSER_MODEL_CONST(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_BROWSER_MODEL, GeditCollaborationBrowserModel const))
+#define GEDIT_COLLABORATION_BROWSER_MODEL_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_BROWSER_MODEL, GeditCollaborationBrowserModelClass))
+#define GEDIT_COLLABORATION_IS_BROWSER_MODEL(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_BROWSER_MODEL))
+#define GEDIT_COLLABORATION_IS_BROWSER_MODEL_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_BROWSER_MODEL))
+#define GEDIT_COLLABORATION_BROWSER_MODEL_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_BROWSER_MODEL, GeditCollaborationBrowserModelClass))
+
+typedef struct _GeditCollaborationBrowserModel		GeditCollaborationBrowserModel;
+typedef struct _GeditCollaborationBrowserModelClass	GeditCollaborationBrowserModelClass;
+typedef struct _GeditCollaborationBrowserModelPrivate	GeditCollaborationBrowserModelPrivate;
+
+struct _GeditCollaborationBrowserModel
+{
+	InfGtkBrowserModelSort parent;
+
+	GeditCollaborationBrowserModelPrivate *priv;
+};
+
+struct _GeditCollaborationBrowserModelClass
+{
+	InfGtkBrowserModelSortClass parent_class;
+};
+
+GType gedit_collaboration_browser_model_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_browser_model_register_type (GTypeModule *type_module);
+
+GeditCollaborationBrowserModel *gedit_collaboration_browser_model_new (InfGtkBrowserModel               *child_model,
+                                                                      GeditCollaborationCollationCache *cache);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_BROWSER_MODEL_H__ */
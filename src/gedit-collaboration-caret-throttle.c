@@ -0,0 +1,299 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-caret-throttle.h"
+
+#include <gtk/gtk.h>
+#include <libinfinity/common/inf-user-table.h>
+#include <libinftextgtk/inf-text-gtk-buffer.h>
+
+#define GEDIT_COLLABORATION_CARET_THROTTLE_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_CARET_THROTTLE, GeditCollaborationCaretThrottlePrivate))
+
+/* Minimum time between two caret updates (in milliseconds) for each user
+   taking part in the session, and the upper bound of that time */
+#define CARET_INTERVAL_PER_USER 10
+#define CARET_INTERVAL_MAX 250
+
+struct _GeditCollaborationCaretThrottlePrivate
+{
+	InfSession *session;
+
+	InfTextGtkBuffer *inf_buffer;
+	GtkTextBuffer *buffer;
+
+	guint mark_set_signal;
+	gulong hook;
+
+	gint64 last_update;
+	guint flush_id;
+	gboolean flushing;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_SESSION
+};
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationCaretThrottle,
+                       gedit_collaboration_caret_throttle,
+                       G_TYPE_OBJECT)
+
+static void
+block_mark_set (GeditCollaborationCaretThrottle *throttle,
+                gboolean                         block)
+{
+	if (block)
+	{
+		g_signal_handlers_block_matched (throttle->priv->buffer,
+		                                 G_SIGNAL_MATCH_ID | G_SIGNAL_MATCH_DATA,
+		                                 throttle->priv->mark_set_signal,
+		                                 0,
+		                                 NULL,
+		                                 NULL,
+		                                 throttle->priv->inf_buffer);
+	}
+	else
+	{
+		g_signal_handlers_unblock_matched (throttle->priv->buffer,
+		                                   G_SIGNAL_MATCH_ID | G_SIGNAL_MATCH_DATA,
+		                                   throttle->priv->mark_set_signal,
+		                                   0,
+		                                   NULL,
+		                                   NULL,
+		                                   throttle->priv->inf_buffer);
+	}
+}
+
+static void
+count_available_user (InfUser  *user,
+                      gpointer  data)
+{
+	if (inf_user_get_status (user) != INF_USER_UNAVAILABLE)
+	{
+		++*(guint *)data;
+	}
+}
+
+static guint
+get_interval (GeditCollaborationCaretThrottle *throttle)
+{
+	guint n_users = 0;
+
+	inf_user_table_foreach_user (inf_session_get_user_table (throttle->priv->session),
+	                             count_available_user,
+	                             &n_users);
+
+	return MIN (n_users * CARET_INTERVAL_PER_USER, CARET_INTERVAL_MAX);
+}
+
+static gboolean
+on_flush_timeout (GeditCollaborationCaretThrottle *throttle)
+{
+	GtkTextMark *insert;
+	GtkTextIter iter;
+
+	throttle->priv->flush_id = 0;
+	throttle->priv->last_update = g_get_monotonic_time ();
+
+	block_mark_set (throttle, FALSE);
+
+	/* Let the infinote buffer see the latest caret and selection */
+	throttle->priv->flushing = TRUE;
+
+	insert = gtk_text_buffer_get_insert (throttle->priv->buffer);
+	gtk_text_buffer_get_iter_at_mark (throttle->priv->buffer, &iter, insert);
+	gtk_text_buffer_move_mark (throttle->priv->buffer, insert, &iter);
+
+	throttle->priv->flushing = FALSE;
+
+	return FALSE;
+}
+
+static gboolean
+on_mark_set_hook (GSignalInvocationHint *ihint,
+                  guint                  n_param_values,
+                  const GValue          *param_values,
+                  gpointer               data)
+{
+	GeditCollaborationCaretThrottle *throttle = data;
+	GtkTextMark *mark;
+	gint64 elapsed;
+	guint interval;
+
+	if (g_value_get_object (&param_values[0]) != (GObject *)throttle->priv->buffer ||
+	    throttle->priv->flushing ||
+	    throttle->priv->flush_id != 0)
+	{
+		return TRUE;
+	}
+
+	mark = g_value_get_object (&param_values[2]);
+
+	if (mark != gtk_text_buffer_get_insert (throttle->priv->buffer) &&
+	    mark != gtk_text_buffer_get_selection_bound (throttle->priv->buffer))
+	{
+		return TRUE;
+	}
+
+	/* Always defer at least to the main loop, moving the cursor sets
+	   both the insert and the selection bound marks */
+	interval = get_interval (throttle);
+	elapsed = (g_get_monotonic_time () - throttle->priv->last_update) / 1000;
+
+	block_mark_set (throttle, TRUE);
+
+	throttle->priv->flush_id =
+		g_timeout_add (elapsed < interval ? interval - elapsed : 0,
+		               (GSourceFunc)on_flush_timeout,
+		               throttle);
+
+	return TRUE;
+}
+
+static void
+gedit_collaboration_caret_throttle_dispose (GObject *object)
+{
+	GeditCollaborationCaretThrottle *throttle = GEDIT_COLLABORATION_CARET_THROTTLE (object);
+
+	if (throttle->priv->hook != 0)
+	{
+		g_signal_remove_emission_hook (throttle->priv->mark_set_signal,
+		                               throttle->priv->hook);
+		throttle->priv->hook = 0;
+	}
+
+	if (throttle->priv->flush_id != 0)
+	{
+		g_source_remove (throttle->priv->flush_id);
+		throttle->priv->flush_id = 0;
+
+		block_mark_set (throttle, FALSE);
+	}
+
+	if (throttle->priv->buffer)
+	{
+		g_object_unref (throttle->priv->buffer);
+		throttle->priv->buffer = NULL;
+	}
+
+	if (throttle->priv->inf_buffer)
+	{
+		g_object_unref (throttle->priv->inf_buffer);
+		throttle->priv->inf_buffer = NULL;
+	}
+
+	if (throttle->priv->session)
+	{
+		g_object_unref (throttle->priv->session);
+		throttle->priv->session = NULL;
+	}
+
+	G_OBJECT_CLASS (gedit_collaboration_caret_throttle_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_caret_throttle_set_property (GObject      *object,
+                                                 guint         prop_id,
+                                                 const GValue *value,
+                                                 GParamSpec   *pspec)
+{
+	GeditCollaborationCaretThrottle *self = GEDIT_COLLABORATION_CARET_THROTTLE (object);
+
+	switch (prop_id)
+	{
+		case PROP_SESSION:
+			self->priv->session = g_value_dup_object (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_caret_throttle_get_property (GObject    *object,
+                                                 guint       prop_id,
+                                                 GValue     *value,
+                                                 GParamSpec *pspec)
+{
+	GeditCollaborationCaretThrottle *self = GEDIT_COLLABORATION_CARET_THROTTLE (object);
+
+	switch (prop_id)
+	{
+		case PROP_SESSION:
+			g_value_set_object (value, self->priv->session);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_caret_throttle_constructed (GObject *object)
+{
+	GeditCollaborationCaretThrottle *throttle = GEDIT_COLLABORATION_CARET_THROTTLE (object);
+	InfTextGtkBuffer *inf_buffer;
+
+	inf_buffer = INF_TEXT_GTK_BUFFER (inf_session_get_buffer (throttle->priv->session));
+
+	throttle->priv->inf_buffer = g_object_ref (inf_buffer);
+	throttle->priv->buffer = g_object_ref (inf_text_gtk_buffer_get_text_buffer (inf_buffer));
+
+	/* The hook runs before the handler of the infinote buffer which
+	   sends the caret position */
+	throttle->priv->mark_set_signal = g_signal_lookup ("mark-set", GTK_TYPE_TEXT_BUFFER);
+	throttle->priv->hook = g_signal_add_emission_hook (throttle->priv->mark_set_signal,
+	                                                   0,
+	                                                   on_mark_set_hook,
+	                                                   throttle,
+	                                                   NULL);
+}
+
+static void
+gedit_collaboration_caret_throttle_class_init (GeditCollaborationCaretThrottleClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_caret_throttle_dispose;
+	object_class->constructed = gedit_collaboration_caret_throttle_constructed;
+
+	object_class->set_property = gedit_collaboration_caret_throttle_set_property;
+	object_class->get_property = gedit_collaboration_caret_throttle_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_SESSION,
+	                                 g_param_spec_object ("session",
+	                                                      "Session",
+	                                                      "Session",
+	                                                      INF_TYPE_SESSION,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationCaretThrottlePrivate));
+}
+
+static void
+gedit_collaboration_caret_throttle_class_finalize (GeditCollaborationCaretThrottleClass *klass)
+{
+}
+
+static void
+gedit_collaboration_caret_throttle_init (GeditCollaborationCaretThrottle *self)
+{
+	self->priv = GEDIT_COLLABORATION_CARET_THROTTLE_GET_PRIVATE (self);
+}
+
+GeditCollaborationCaretThrottle *
+gedit_collaboration_caret_throttle_new (InfSession *session)
+{
+	return g_object_new (GEDIT_COLLABORATION_TYPE_CARET_THROTTLE,
+	                     "session", session,
+	                     NULL);
+}
+
+void
+_gedit_collaboration_caret_throttle_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_caret_throttle_register_type (type_module);
+}
@@ -0,0 +1,42 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_CARET_THROTTLE_H__
+#define __GEDIT_COLLABORATION_CARET_THROTTLE_H__
+
+#include <glib-object.h>
+#include <libinfinity/common/inf-session.h>
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_CARET_THROTTLE		(gedit_collaboration_caret_throttle_get_type ())
+#define GEDIT_COLLABORATION_CARET_THROTTLE(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_CARET_THROTTLE, GeditCollaborationCaretThrottle))
+#define GEDIT_COLLABORATION_CARET_THROTTLE_CONST(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_CARET_THROTTLE, GeditCollaborationCaretThrottle const))
+#define GEDIT_COLLABORATION_CARET_THROTTLE_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_CARET_THROTTLE, GeditCollaborationCaretThrottleClass))
+#define GEDIT_COLLABORATION_IS_CARET_THROTTLE(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_CARET_THROTTLE))
+#define GEDIT_COLLABORATION_IS_CARET_THROTTLE_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_CARET_THROTTLE))
+#define GEDIT_COLLABORATION_CARET_THROTTLE_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_CARET_THROTTLE, GeditCollaborationCaretThrottleClass))
+
+typedef struct _GeditCollaborationCaretThrottle		GeditCollaborationCaretThrottle;
+typedef struct _GeditCollaborationCaretThrottleClass	GeditCollaborationCaretThrottleClass;
+typedef struct _GeditCollaborationCaretThrottlePrivate	GeditCollaborationCaretThrottlePrivate;
+
+struct _GeditCollaborationCaretThrottle
+{
+	GObject parent;
+
+	GeditCollaborationCaretThrottlePrivate *priv;
+};
+
+struct _GeditCollaborationCaretThrottleClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_caret_throttle_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_caret_throttle_register_type (GTypeModule *type_module);
+
+GeditCollaborationCaretThrottle *gedit_collaboration_caret_throttle_new (InfSession *session);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_CARET_THROTTLE_H__ */
@@ -0,0 +1,740 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-chat-log.h"
+
+#include <string.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#define GEDIT_COLLABORATION_CHAT_LOG_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_CHAT_LOG, GeditCollaborationChatLogPrivate))
+
+/* Size of the blocks read backwards from the log */
+#define READ_BLOCK_SIZE 4096
+
+/* The log is moved aside to <filename>.1 when it would grow beyond this,
+   replacing the previous one */
+#define MAX_LOG_SIZE (4 * 1024 * 1024)
+
+struct _GeditCollaborationChatLogPrivate
+{
+	gchar *filename;
+	GFile *file;
+	GOutputStream *stream;
+
+	goffset size;
+	goffset last_offset;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_FILENAME
+};
+
+/* Signals */
+enum
+{
+	ROTATED,
+	NUM_SIGNALS
+};
+
+static guint signals[NUM_SIGNALS] = {0,};
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationChatLog,
+                       gedit_collaboration_chat_log,
+                       G_TYPE_OBJECT)
+
+static void
+close_stream (GeditCollaborationChatLog *log)
+{
+	if (log->priv->stream)
+	{
+		g_output_stream_close (log->priv->stream, NULL, NULL);
+		g_object_unref (log->priv->stream);
+		log->priv->stream = NULL;
+	}
+}
+
+static void
+open_stream (GeditCollaborationChatLog *log)
+{
+	GFileOutputStream *stream;
+	GFileInfo *info;
+	GError *error = NULL;
+
+	stream = g_file_append_to (log->priv->file,
+	                           G_FILE_CREATE_PRIVATE,
+	                           NULL,
+	                           &error);
+
+	if (stream == NULL)
+	{
+		g_warning ("%s", error->message);
+		g_error_free (error);
+
+		return;
+	}
+
+	log->priv->stream = G_OUTPUT_STREAM (stream);
+	log->priv->size = 0;
+
+	info = g_file_query_info (log->priv->file,
+	                          G_FILE_ATTRIBUTE_STANDARD_SIZE,
+	                          G_FILE_QUERY_INFO_NONE,
+	                          NULL,
+	                          NULL);
+
+	if (info != NULL)
+	{
+		log->priv->size = g_file_info_get_size (info);
+		g_object_unref (info);
+	}
+
+	log->priv->last_offset = log->priv->size;
+}
+
+static void
+rotate (GeditCollaborationChatLog *log)
+{
+	gchar *previous;
+
+	close_stream (log);
+
+	previous = g_strconcat (log->priv->filename, ".1", NULL);
+
+	if (g_rename (log->priv->filename, previous) != 0)
+	{
+		g_warning ("Could not rotate chat log %s", log->priv->filename);
+	}
+
+	g_free (previous);
+
+	open_stream (log);
+
+	/* Offsets into the log are no longer valid */
+	g_signal_emit (log, signals[ROTATED], 0);
+}
+
+static void
+gedit_collaboration_chat_log_dispose (GObject *object)
+{
+	GeditCollaborationChatLog *log = GEDIT_COLLABORATION_CHAT_LOG (object);
+
+	close_stream (log);
+
+	if (log->priv->file)
+	{
+		g_object_unref (log->priv->file);
+		log->priv->file = NULL;
+	}
+
+	G_OBJECT_CLASS (gedit_collaboration_chat_log_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_chat_log_finalize (GObject *object)
+{
+	GeditCollaborationChatLog *log = GEDIT_COLLABORATION_CHAT_LOG (object);
+
+	g_free (log->priv->filename);
+
+	G_OBJECT_CLASS (gedit_collaboration_chat_log_parent_class)->finalize (object);
+}
+
+static void
+gedit_collaboration_chat_log_set_property (GObject      *object,
+                                           guint         prop_id,
+                                           const GValue *value,
+                                           GParamSpec   *pspec)
+{
+	GeditCollaborationChatLog *self = GEDIT_COLLABORATION_CHAT_LOG (object);
+
+	switch (prop_id)
+	{
+		case PROP_FILENAME:
+			g_free (self->priv->filename);
+			self->priv->filename = g_value_dup_string (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_chat_log_get_property (GObject    *object,
+                                           guint       prop_id,
+                                           GValue     *value,
+                                           GParamSpec *pspec)
+{
+	GeditCollaborationChatLog *self = GEDIT_COLLABORATION_CHAT_LOG (object);
+
+	switch (prop_id)
+	{
+		case PROP_FILENAME:
+			g_value_set_string (value, self->priv->filename);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_chat_log_constructed (GObject *object)
+{
+	GeditCollaborationChatLog *log = GEDIT_COLLABORATION_CHAT_LOG (object);
+	gchar *dirname;
+
+	dirname = g_path_get_dirname (log->priv->filename);
+	g_mkdir_with_parents (dirname, 0755);
+	g_free (dirname);
+
+	log->priv->file = g_file_new_for_path (log->priv->filename);
+
+	open_stream (log);
+
+	if (log->priv->stream != NULL && log->priv->size > MAX_LOG_SIZE)
+	{
+		rotate (log);
+	}
+}
+
+static void
+gedit_collaboration_chat_log_class_init (GeditCollaborationChatLogClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_chat_log_dispose;
+	object_class->finalize = gedit_collaboration_chat_log_finalize;
+	object_class->constructed = gedit_collaboration_chat_log_constructed;
+
+	object_class->set_property = gedit_collaboration_chat_log_set_property;
+	object_class->get_property = gedit_collaboration_chat_log_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_FILENAME,
+	                                 g_param_spec_string ("filename",
+	                                                      "Filename",
+	                                                      "Filename",
+	                                                      NULL,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	signals[ROTATED] =
+		g_signal_new ("rotated",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL,
+		              NULL,
+		              g_cclosure_marshal_VOID__VOID,
+		              G_TYPE_NONE,
+		              0);
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationChatLogPrivate));
+}
+
+static void
+gedit_collaboration_chat_log_class_finalize (GeditCollaborationChatLogClass *klass)
+{
+}
+
+static void
+gedit_collaboration_chat_log_init (GeditCollaborationChatLog *self)
+{
+	self->priv = GEDIT_COLLABORATION_CHAT_LOG_GET_PRIVATE (self);
+}
+
+GeditCollaborationChatLog *
+gedit_collaboration_chat_log_new (const gchar *filename)
+{
+	return g_object_new (GEDIT_COLLABORATION_TYPE_CHAT_LOG,
+	                     "filename", filename,
+	                     NULL);
+}
+
+goffset
+gedit_collaboration_chat_log_append (GeditCollaborationChatLog *log,
+                                     const gchar               *line)
+{
+	GError *error = NULL;
+	gchar *text;
+	gsize len;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CHAT_LOG (log), -1);
+	g_return_val_if_fail (line != NULL, -1);
+
+	if (log->priv->stream == NULL)
+	{
+		return -1;
+	}
+
+	text = g_strconcat (line, "\n", NULL);
+	len = strlen (text);
+
+	if (log->priv->size > 0 && log->priv->size + len > MAX_LOG_SIZE)
+	{
+		rotate (log);
+
+		if (log->priv->stream == NULL)
+		{
+			g_free (text);
+			return -1;
+		}
+	}
+
+	/* Flush right away so the line can be read back at any time */
+	if (!g_output_stream_write_all (log->priv->stream, text, len, NULL, NULL, &error) ||
+	    !g_output_stream_flush (log->priv->stream, NULL, &error))
+	{
+		g_warning ("%s", error->message);
+		g_error_free (error);
+		g_free (text);
+
+		return -1;
+	}
+
+	g_free (text);
+
+	log->priv->last_offset = log->priv->size;
+	log->priv->size += len;
+
+	return log->priv->last_offset;
+}
+
+goffset
+gedit_collaboration_chat_log_get_size (GeditCollaborationChatLog *log)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CHAT_LOG (log), 0);
+	return log->priv->size;
+}
+
+goffset
+gedit_collaboration_chat_log_get_last_offset (GeditCollaborationChatLog *log)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CHAT_LOG (log), 0);
+	return log->priv->last_offset;
+}
+
+/* Fields are separated by tabs, so tabs, newlines and backslashes in
+   them are escaped */
+static void
+append_escaped (GString     *str,
+                const gchar *text,
+                gsize        length)
+{
+	gsize i;
+
+	for (i = 0; i < length; ++i)
+	{
+		switch (text[i])
+		{
+			case '\\':
+				g_string_append (str, "\\\\");
+			break;
+			case '\t':
+				g_string_append (str, "\\t");
+			break;
+			case '\n':
+				g_string_append (str, "\\n");
+			break;
+			case '\r':
+				g_string_append (str, "\\r");
+			break;
+			default:
+				g_string_append_c (str, text[i]);
+			break;
+		}
+	}
+}
+
+static gchar *
+unescape (const gchar *text)
+{
+	GString *str;
+
+	str = g_string_sized_new (strlen (text));
+
+	for (; *text; ++text)
+	{
+		if (*text != '\\' || text[1] == '\0')
+		{
+			g_string_append_c (str, *text);
+			continue;
+		}
+
+		switch (*++text)
+		{
+			case 't':
+				g_string_append_c (str, '\t');
+			break;
+			case 'n':
+				g_string_append_c (str, '\n');
+			break;
+			case 'r':
+				g_string_append_c (str, '\r');
+			break;
+			default:
+				g_string_append_c (str, *text);
+			break;
+		}
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static const struct
+{
+	InfChatBufferMessageType type;
+	const gchar *name;
+} message_types[] = {
+	{INF_CHAT_BUFFER_MESSAGE_NORMAL, "message"},
+	{INF_CHAT_BUFFER_MESSAGE_EMOTE, "emote"},
+	{INF_CHAT_BUFFER_MESSAGE_USERJOIN, "join"},
+	{INF_CHAT_BUFFER_MESSAGE_USERPART, "part"}
+};
+
+static const gchar *
+type_to_string (InfChatBufferMessageType type)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (message_types); ++i)
+	{
+		if (message_types[i].type == type)
+		{
+			return message_types[i].name;
+		}
+	}
+
+	return message_types[0].name;
+}
+
+/**
+ * gedit_collaboration_chat_log_format_message:
+ * @message: a #InfChatBufferMessage
+ *
+ * Formats @message as a single log line of tab separated fields: the unix
+ * time, the message type, the user name and the text.
+ *
+ * Returns: a newly allocated line, without the terminating newline
+ */
+gchar *
+gedit_collaboration_chat_log_format_message (const InfChatBufferMessage *message)
+{
+	GString *str;
+	const gchar *name;
+
+	g_return_val_if_fail (message != NULL, NULL);
+
+	name = inf_user_get_name (message->user);
+	str = g_string_new (NULL);
+
+	g_string_append_printf (str,
+	                        "%" G_GINT64_FORMAT "\t%s\t",
+	                        (gint64)message->time,
+	                        type_to_string (message->type));
+
+	append_escaped (str, name, strlen (name));
+	g_string_append_c (str, '\t');
+	append_escaped (str, message->text, message->length);
+
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * gedit_collaboration_chat_log_parse_message:
+ * @line: a line written by gedit_collaboration_chat_log_format_message()
+ * @time: (out): return location for the time of the message
+ * @type: (out): return location for the type of the message
+ * @name: (out): return location for the user name
+ * @text: (out): return location for the text
+ *
+ * Returns: %TRUE if @line could be parsed, in which case @name and @text
+ * have to be freed
+ */
+gboolean
+gedit_collaboration_chat_log_parse_message (const gchar               *line,
+                                            gint64                    *time,
+                                            InfChatBufferMessageType  *type,
+                                            gchar                    **name,
+                                            gchar                    **text)
+{
+	gchar **fields;
+	gchar *end;
+	guint i;
+
+	g_return_val_if_fail (line != NULL, FALSE);
+
+	fields = g_strsplit (line, "\t", 4);
+
+	if (g_strv_length (fields) != 4)
+	{
+		g_strfreev (fields);
+		return FALSE;
+	}
+
+	*time = g_ascii_strtoll (fields[0], &end, 10);
+
+	if (end == fields[0] || *end != '\0')
+	{
+		g_strfreev (fields);
+		return FALSE;
+	}
+
+	*type = INF_CHAT_BUFFER_MESSAGE_NORMAL;
+
+	for (i = 0; i < G_N_ELEMENTS (message_types); ++i)
+	{
+		if (strcmp (fields[1], message_types[i].name) == 0)
+		{
+			*type = message_types[i].type;
+			break;
+		}
+	}
+
+	*name = unescape (fields[2]);
+	*text = unescape (fields[3]);
+
+	g_strfreev (fields);
+	return TRUE;
+}
+
+/**
+ * gedit_collaboration_chat_log_read_after:
+ * @log: a #GeditCollaborationChatLog
+ * @offset: the offset of a line start
+ * @n_lines: the maximum number of lines to read
+ * @offsets: (out): return location for the offsets of the lines
+ *
+ * Reads up to @n_lines lines starting at @offset.
+ *
+ * Returns: a %NULL terminated array of lines, oldest first
+ */
+gchar **
+gedit_collaboration_chat_log_read_after (GeditCollaborationChatLog  *log,
+                                         goffset                     offset,
+                                         guint                       n_lines,
+                                         goffset                   **offsets)
+{
+	GFileInputStream *stream;
+	GDataInputStream *data;
+	GError *error = NULL;
+	GPtrArray *lines;
+	GArray *starts;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CHAT_LOG (log), NULL);
+
+	*offsets = NULL;
+
+	if (offset < 0 || offset >= log->priv->size || n_lines == 0)
+	{
+		return NULL;
+	}
+
+	stream = g_file_read (log->priv->file, NULL, &error);
+
+	if (stream == NULL ||
+	    !g_seekable_seek (G_SEEKABLE (stream), offset, G_SEEK_SET, NULL, &error))
+	{
+		g_warning ("%s", error->message);
+		g_error_free (error);
+
+		if (stream != NULL)
+		{
+			g_object_unref (stream);
+		}
+
+		return NULL;
+	}
+
+	data = g_data_input_stream_new (G_INPUT_STREAM (stream));
+	g_data_input_stream_set_newline_type (data, G_DATA_STREAM_NEWLINE_TYPE_LF);
+
+	lines = g_ptr_array_new ();
+	starts = g_array_new (FALSE, FALSE, sizeof (goffset));
+
+	/* Only complete lines, the log is always written a line at a time */
+	while (lines->len < n_lines && offset < log->priv->size)
+	{
+		gchar *line;
+		gsize length;
+
+		line = g_data_input_stream_read_line (data, &length, NULL, &error);
+
+		if (line == NULL)
+		{
+			if (error != NULL)
+			{
+				g_warning ("%s", error->message);
+				g_error_free (error);
+			}
+
+			break;
+		}
+
+		g_ptr_array_add (lines, line);
+		g_array_append_val (starts, offset);
+
+		offset += length + 1;
+	}
+
+	g_object_unref (data);
+	g_object_unref (stream);
+
+	g_ptr_array_add (lines, NULL);
+
+	*offsets = (goffset *)g_array_free (starts, FALSE);
+	return (gchar **)g_ptr_array_free (lines, FALSE);
+}
+
+static guint
+count_lines (const gchar *data,
+             gsize        len)
+{
+	guint ret = 0;
+	gsize i;
+
+	for (i = 0; i < len; ++i)
+	{
+		if (data[i] == '\n')
+		{
+			++ret;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * gedit_collaboration_chat_log_read_before:
+ * @log: a #GeditCollaborationChatLog
+ * @offset: the offset of a line start
+ * @n_lines: the maximum number of lines to read
+ * @offsets: (out): return location for the offsets of the lines
+ *
+ * Reads up to @n_lines lines preceding @offset, reading the file backwards in
+ * blocks so that only the requested lines are ever loaded.
+ *
+ * Returns: a %NULL terminated array of lines, oldest first
+ */
+gchar **
+gedit_collaboration_chat_log_read_before (GeditCollaborationChatLog  *log,
+                                          goffset                     offset,
+                                          guint                       n_lines,
+                                          goffset                   **offsets)
+{
+	GFileInputStream *stream;
+	GError *error = NULL;
+	GString *data;
+	goffset pos;
+	GPtrArray *lines;
+	GArray *starts;
+	gsize start;
+	gsize i;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CHAT_LOG (log), NULL);
+
+	*offsets = NULL;
+
+	offset = CLAMP (offset, 0, log->priv->size);
+
+	if (offset == 0 || n_lines == 0)
+	{
+		return NULL;
+	}
+
+	stream = g_file_read (log->priv->file, NULL, &error);
+
+	if (stream == NULL)
+	{
+		g_warning ("%s", error->message);
+		g_error_free (error);
+
+		return NULL;
+	}
+
+	data = g_string_new ("");
+	pos = offset;
+
+	/* Read blocks until the data holds n_lines complete lines, the
+	   newline terminating the last line does not count */
+	while (pos > 0 && count_lines (data->str, data->len > 0 ? data->len - 1 : 0) < n_lines)
+	{
+		gchar block[READ_BLOCK_SIZE];
+		gsize size = MIN (pos, READ_BLOCK_SIZE);
+		gsize read;
+
+		pos -= size;
+
+		if (!g_seekable_seek (G_SEEKABLE (stream), pos, G_SEEK_SET, NULL, &error) ||
+		    !g_input_stream_read_all (G_INPUT_STREAM (stream), block, size, &read, NULL, &error))
+		{
+			g_warning ("%s", error->message);
+			g_error_free (error);
+
+			break;
+		}
+
+		g_string_prepend_len (data, block, read);
+	}
+
+	g_object_unref (stream);
+
+	lines = g_ptr_array_new ();
+	starts = g_array_new (FALSE, FALSE, sizeof (goffset));
+
+	/* Collect the lines from the end, dropping a partial first line */
+	i = data->len > 0 ? data->len - 1 : 0;
+	start = data->len;
+
+	while (i > 0 && lines->len < n_lines)
+	{
+		--i;
+
+		if (data->str[i] == '\n')
+		{
+			goffset loffset = pos + i + 1;
+
+			g_ptr_array_add (lines, g_strndup (data->str + i + 1, start - i - 2));
+			g_array_append_val (starts, loffset);
+
+			start = i + 1;
+		}
+	}
+
+	if (i == 0 && pos == 0 && lines->len < n_lines && start > 0)
+	{
+		goffset loffset = 0;
+
+		g_ptr_array_add (lines, g_strndup (data->str, start - 1));
+		g_array_append_val (starts, loffset);
+	}
+
+	g_string_free (data, TRUE);
+
+	/* Oldest first */
+	for (i = 0; i < lines->len / 2; ++i)
+	{
+		gpointer tmp = lines->pdata[i];
+		goffset otmp = g_array_index (starts, goffset, i);
+
+		lines->pdata[i] = lines->pdata[lines->len - i - 1];
+		lines->pdata[lines->len - i - 1] = tmp;
+
+		g_array_index (starts, goffset, i) = g_array_index (starts, goffset, lines->len - i - 1);
+		g_array_index (starts, goffset, lines->len - i - 1) = otmp;
+	}
+
+	g_ptr_array_add (lines, NULL);
+
+	*offsets = (goffset *)g_array_free (starts, FALSE);
+	return (gchar **)g_ptr_array_free (lines, FALSE);
+}
+
+void
+_gedit_collaboration_chat_log_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_chat_log_register_type (type_module);
+}
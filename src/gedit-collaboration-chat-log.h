@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_CHAT_LOG_H__
+#define __GEDIT_COLLABORATION_CHAT_LOG_H__
+
+#include <glib-object.h>
+#include <libinfinity/common/inf-chat-buffer.h>
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_CHAT_LOG		(gedit_collaboration_chat_log_get_type ())
+#define GEDIT_COLLABORATION_CHAT_LOG(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_CHAT_LOG, GeditCollaborationChatLog))
+#define GEDIT_COLLABORATION_CHAT_LOG_CONST(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_CHAT_LOG, GeditCollaborationChatLog const))
+#define GEDIT_COLLABORATION_CHAT_LOG_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_CHAT_LOG, GeditCollaborationChatLogClass))
+#define GEDIT_COLLABORATION_IS_CHAT_LOG(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_CHAT_LOG))
+#define GEDIT_COLLABORATION_IS_CHAT_LOG_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_CHAT_LOG))
+#define GEDIT_COLLABORATION_CHAT_LOG_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_CHAT_LOG, GeditCollaborationChatLogClass))
+
+typedef struct _GeditCollaborationChatLog		GeditCollaborationChatLog;
+typedef struct _GeditCollaborationChatLogClass		GeditCollaborationChatLogClass;
+typedef struct _GeditCollaborationChatLogPrivate	GeditCollaborationChatLogPrivate;
+
+struct _GeditCollaborationChatLog
+{
+	GObject parent;
+
+	GeditCollaborationChatLogPrivate *priv;
+};
+
+struct _GeditCollaborationChatLogClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_chat_log_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_chat_log_register_type (GTypeModule *type_module);
+
+GeditCollaborationChatLog *gedit_collaboration_chat_log_new (const gchar *filename);
+
+goffset gedit_collaboration_chat_log_append (GeditCollaborationChatLog *log,
+                                             const gchar               *line);
+
+goffset gedit_collaboration_chat_log_get_size (GeditCollaborationChatLog *log);
+goffset gedit_collaboration_chat_log_get_last_offset (GeditCollaborationChatLog *log);
+
+gchar *gedit_collaboration_chat_log_format_message (const InfChatBufferMessage *message);
+gboolean gedit_collaboration_chat_log_parse_message (const gchar               *line,
+                                                     gint64                    *time,
+                                                     InfChatBufferMessageType  *type,
+                                                     gchar                    **name,
+                                                     gchar                    **text);
+
+gchar **gedit_collaboration_chat_log_read_after (GeditCollaborationChatLog  *log,
+                                                 goffset                     offset,
+                                                 guint                       n_lines,
+                                                 goffset                   **offsets);
+
+gchar **gedit_collaboration_chat_log_read_before (GeditCollaborationChatLog  *log,
+                                                  goffset                     offset,
+                                                  guint                       n_lines,
+                                                  goffset                   **offsets);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_CHAT_LOG_H__ */
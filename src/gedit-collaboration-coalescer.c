@@ -0,0 +1,639 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-coalescer.h"
+
+#include <gtk/gtk.h>
+#include <libinftextgtk/inf-text-gtk-buffer.h>
+
+#define GEDIT_COLLABORATION_COALESCER_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_COALESCER, GeditCollaborationCoalescerPrivate))
+
+typedef enum
+{
+	PENDING_NONE,
+	PENDING_INSERT,
+	PENDING_DELETE
+} PendingKind;
+
+enum
+{
+	INSERT_TEXT,
+	DELETE_RANGE,
+	RECEIVED,
+	NUM_HOOKS
+};
+
+struct _GeditCollaborationCoalescerPrivate
+{
+	InfSession *session;
+	InfXmlConnection *connection;
+	guint latency;
+
+	InfTextGtkBuffer *inf_buffer;
+	GtkTextBuffer *buffer;
+
+	guint hook_signals[NUM_HOOKS];
+	gulong hooks[NUM_HOOKS];
+
+	gulong undo_handler;
+	gulong redo_handler;
+
+	/* The run of single character edits not yet sent. The text of an
+	   insert run is in the buffer between offset and offset + length,
+	   the text removed by a delete run is kept in deleted */
+	PendingKind kind;
+	gint offset;
+	gint length;
+	GString *deleted;
+
+	gboolean replaying;
+	guint flush_id;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_SESSION,
+	PROP_CONNECTION,
+	PROP_LATENCY
+};
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationCoalescer,
+                       gedit_collaboration_coalescer,
+                       G_TYPE_OBJECT)
+
+static void
+block_buffer (GeditCollaborationCoalescer *coalescer)
+{
+	g_signal_handlers_block_matched (coalescer->priv->buffer,
+	                                 G_SIGNAL_MATCH_DATA,
+	                                 0,
+	                                 0,
+	                                 NULL,
+	                                 NULL,
+	                                 coalescer->priv->inf_buffer);
+}
+
+static void
+unblock_buffer (GeditCollaborationCoalescer *coalescer)
+{
+	g_signal_handlers_unblock_matched (coalescer->priv->buffer,
+	                                   G_SIGNAL_MATCH_DATA,
+	                                   0,
+	                                   0,
+	                                   NULL,
+	                                   NULL,
+	                                   coalescer->priv->inf_buffer);
+}
+
+static void
+reset_pending (GeditCollaborationCoalescer *coalescer)
+{
+	if (coalescer->priv->flush_id != 0)
+	{
+		g_source_remove (coalescer->priv->flush_id);
+		coalescer->priv->flush_id = 0;
+	}
+
+	coalescer->priv->kind = PENDING_NONE;
+	coalescer->priv->offset = 0;
+	coalescer->priv->length = 0;
+
+	g_string_truncate (coalescer->priv->deleted, 0);
+}
+
+static void
+replay_pending (GeditCollaborationCoalescer *coalescer)
+{
+	GtkTextBuffer *buffer = coalescer->priv->buffer;
+	GtkTextIter start;
+	GtkTextIter end;
+
+	gtk_text_buffer_get_iter_at_offset (buffer,
+	                                    &start,
+	                                    coalescer->priv->offset);
+
+	if (coalescer->priv->kind == PENDING_INSERT)
+	{
+		gchar *text;
+
+		gtk_text_buffer_get_iter_at_offset (buffer,
+		                                    &end,
+		                                    coalescer->priv->offset + coalescer->priv->length);
+
+		text = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+
+		/* Take the run out behind the back of the infinote buffer
+		   and insert it again as a single request */
+		gtk_text_buffer_delete (buffer, &start, &end);
+		unblock_buffer (coalescer);
+
+		gtk_text_buffer_insert (buffer, &start, text, -1);
+		g_free (text);
+	}
+	else
+	{
+		/* Put the removed text back silently and remove it again as a
+		   single request */
+		gtk_text_buffer_insert (buffer,
+		                        &start,
+		                        coalescer->priv->deleted->str,
+		                        coalescer->priv->deleted->len);
+
+		unblock_buffer (coalescer);
+
+		gtk_text_buffer_get_iter_at_offset (buffer,
+		                                    &start,
+		                                    coalescer->priv->offset);
+
+		gtk_text_buffer_get_iter_at_offset (buffer,
+		                                    &end,
+		                                    coalescer->priv->offset +
+		                                    g_utf8_strlen (coalescer->priv->deleted->str,
+		                                                   coalescer->priv->deleted->len));
+
+		gtk_text_buffer_delete (buffer, &start, &end);
+	}
+}
+
+/**
+ * gedit_collaboration_coalescer_flush:
+ * @coalescer: a #GeditCollaborationCoalescer
+ *
+ * Sends the pending run of edits, if any, as a single request.
+ */
+void
+gedit_collaboration_coalescer_flush (GeditCollaborationCoalescer *coalescer)
+{
+	GtkTextMark *insert;
+	GtkTextIter iter;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_COALESCER (coalescer));
+
+	if (coalescer->priv->kind == PENDING_NONE)
+	{
+		return;
+	}
+
+	coalescer->priv->replaying = TRUE;
+
+	gtk_text_buffer_begin_user_action (coalescer->priv->buffer);
+	replay_pending (coalescer);
+	gtk_text_buffer_end_user_action (coalescer->priv->buffer);
+
+	/* Caret moves were not seen while the run was pending */
+	insert = gtk_text_buffer_get_insert (coalescer->priv->buffer);
+	gtk_text_buffer_get_iter_at_mark (coalescer->priv->buffer, &iter, insert);
+	gtk_text_buffer_move_mark (coalescer->priv->buffer, insert, &iter);
+
+	coalescer->priv->replaying = FALSE;
+
+	reset_pending (coalescer);
+}
+
+static gboolean
+on_flush_timeout (GeditCollaborationCoalescer *coalescer)
+{
+	coalescer->priv->flush_id = 0;
+	gedit_collaboration_coalescer_flush (coalescer);
+
+	return FALSE;
+}
+
+static void
+start_pending (GeditCollaborationCoalescer *coalescer,
+               PendingKind                  kind,
+               gint                         offset)
+{
+	coalescer->priv->kind = kind;
+	coalescer->priv->offset = offset;
+
+	block_buffer (coalescer);
+
+	coalescer->priv->flush_id =
+		g_timeout_add (coalescer->priv->latency,
+		               (GSourceFunc)on_flush_timeout,
+		               coalescer);
+}
+
+static gboolean
+is_buffer_modification (GeditCollaborationCoalescer *coalescer,
+                        GSignalInvocationHint       *ihint,
+                        const GValue                *param_values)
+{
+	if (g_value_get_object (&param_values[0]) != (GObject *)coalescer->priv->buffer ||
+	    coalescer->priv->replaying)
+	{
+		return FALSE;
+	}
+
+	if (coalescer->priv->kind != PENDING_NONE)
+	{
+		return TRUE;
+	}
+
+	/* The infinote buffer blocks its own handlers while it applies
+	   remote requests and undos, leave those alone */
+	return g_signal_handler_find (coalescer->priv->buffer,
+	                              G_SIGNAL_MATCH_ID | G_SIGNAL_MATCH_DATA | G_SIGNAL_MATCH_UNBLOCKED,
+	                              ihint->signal_id,
+	                              0,
+	                              NULL,
+	                              NULL,
+	                              coalescer->priv->inf_buffer) != 0;
+}
+
+static gboolean
+on_insert_text_hook (GSignalInvocationHint *ihint,
+                     guint                  n_param_values,
+                     const GValue          *param_values,
+                     gpointer               data)
+{
+	GeditCollaborationCoalescer *coalescer = data;
+	GtkTextIter *location;
+	const gchar *text;
+	gint len;
+	gint offset;
+
+	if (!is_buffer_modification (coalescer, ihint, param_values))
+	{
+		return TRUE;
+	}
+
+	location = g_value_get_boxed (&param_values[1]);
+	text = g_value_get_string (&param_values[2]);
+	len = g_value_get_int (&param_values[3]);
+
+	offset = gtk_text_iter_get_offset (location);
+
+	if (g_utf8_strlen (text, len) != 1)
+	{
+		gedit_collaboration_coalescer_flush (coalescer);
+		gtk_text_buffer_get_iter_at_offset (coalescer->priv->buffer, location, offset);
+
+		return TRUE;
+	}
+
+	if (coalescer->priv->kind == PENDING_INSERT &&
+	    offset == coalescer->priv->offset + coalescer->priv->length)
+	{
+		++coalescer->priv->length;
+		return TRUE;
+	}
+
+	/* Flushing does not change the length of the buffer, but it does
+	   invalidate the iter */
+	gedit_collaboration_coalescer_flush (coalescer);
+	gtk_text_buffer_get_iter_at_offset (coalescer->priv->buffer, location, offset);
+
+	start_pending (coalescer, PENDING_INSERT, offset);
+	coalescer->priv->length = 1;
+
+	return TRUE;
+}
+
+static gboolean
+on_delete_range_hook (GSignalInvocationHint *ihint,
+                      guint                  n_param_values,
+                      const GValue          *param_values,
+                      gpointer               data)
+{
+	GeditCollaborationCoalescer *coalescer = data;
+	GtkTextIter *start;
+	GtkTextIter *end;
+	gint start_offset;
+	gint end_offset;
+	gchar *text;
+
+	if (!is_buffer_modification (coalescer, ihint, param_values))
+	{
+		return TRUE;
+	}
+
+	start = g_value_get_boxed (&param_values[1]);
+	end = g_value_get_boxed (&param_values[2]);
+
+	start_offset = gtk_text_iter_get_offset (start);
+	end_offset = gtk_text_iter_get_offset (end);
+
+	if (end_offset - start_offset != 1)
+	{
+		gedit_collaboration_coalescer_flush (coalescer);
+
+		gtk_text_buffer_get_iter_at_offset (coalescer->priv->buffer, start, start_offset);
+		gtk_text_buffer_get_iter_at_offset (coalescer->priv->buffer, end, end_offset);
+
+		return TRUE;
+	}
+
+	text = gtk_text_buffer_get_text (coalescer->priv->buffer, start, end, TRUE);
+
+	if (coalescer->priv->kind == PENDING_DELETE &&
+	    end_offset == coalescer->priv->offset)
+	{
+		/* Backspace */
+		g_string_prepend (coalescer->priv->deleted, text);
+		coalescer->priv->offset = start_offset;
+	}
+	else if (coalescer->priv->kind == PENDING_DELETE &&
+	         start_offset == coalescer->priv->offset)
+	{
+		/* Delete */
+		g_string_append (coalescer->priv->deleted, text);
+	}
+	else
+	{
+		gedit_collaboration_coalescer_flush (coalescer);
+
+		gtk_text_buffer_get_iter_at_offset (coalescer->priv->buffer, start, start_offset);
+		gtk_text_buffer_get_iter_at_offset (coalescer->priv->buffer, end, end_offset);
+
+		start_pending (coalescer, PENDING_DELETE, start_offset);
+		g_string_assign (coalescer->priv->deleted, text);
+	}
+
+	g_free (text);
+	return TRUE;
+}
+
+static gboolean
+on_received_hook (GSignalInvocationHint *ihint,
+                  guint                  n_param_values,
+                  const GValue          *param_values,
+                  gpointer               data)
+{
+	GeditCollaborationCoalescer *coalescer = data;
+
+	/* Remote requests are transformed against what was sent so far, so
+	   the pending run has to go out before one is processed */
+	if (g_value_get_object (&param_values[0]) == (GObject *)coalescer->priv->connection)
+	{
+		gedit_collaboration_coalescer_flush (coalescer);
+	}
+
+	return TRUE;
+}
+
+static void
+on_undo_redo (GtkTextBuffer               *buffer,
+              GeditCollaborationCoalescer *coalescer)
+{
+	gedit_collaboration_coalescer_flush (coalescer);
+}
+
+static void
+add_hook (GeditCollaborationCoalescer *coalescer,
+          gint                         hook,
+          const gchar                 *name,
+          GType                        type,
+          GSignalEmissionHook          func)
+{
+	coalescer->priv->hook_signals[hook] = g_signal_lookup (name, type);
+	coalescer->priv->hooks[hook] =
+		g_signal_add_emission_hook (coalescer->priv->hook_signals[hook],
+		                            0,
+		                            func,
+		                            coalescer,
+		                            NULL);
+}
+
+static void
+gedit_collaboration_coalescer_dispose (GObject *object)
+{
+	GeditCollaborationCoalescer *coalescer = GEDIT_COLLABORATION_COALESCER (object);
+	gint i;
+
+	for (i = 0; i < NUM_HOOKS; ++i)
+	{
+		if (coalescer->priv->hooks[i] != 0)
+		{
+			g_signal_remove_emission_hook (coalescer->priv->hook_signals[i],
+			                               coalescer->priv->hooks[i]);
+			coalescer->priv->hooks[i] = 0;
+		}
+	}
+
+	if (coalescer->priv->buffer)
+	{
+		if (coalescer->priv->kind != PENDING_NONE)
+		{
+			if (inf_session_get_status (coalescer->priv->session) == INF_SESSION_RUNNING)
+			{
+				gedit_collaboration_coalescer_flush (coalescer);
+			}
+			else
+			{
+				unblock_buffer (coalescer);
+				reset_pending (coalescer);
+			}
+		}
+
+		g_signal_handler_disconnect (coalescer->priv->buffer,
+		                             coalescer->priv->undo_handler);
+
+		g_signal_handler_disconnect (coalescer->priv->buffer,
+		                             coalescer->priv->redo_handler);
+
+		g_object_unref (coalescer->priv->buffer);
+		coalescer->priv->buffer = NULL;
+	}
+
+	if (coalescer->priv->inf_buffer)
+	{
+		g_object_unref (coalescer->priv->inf_buffer);
+		coalescer->priv->inf_buffer = NULL;
+	}
+
+	if (coalescer->priv->connection)
+	{
+		g_object_unref (coalescer->priv->connection);
+		coalescer->priv->connection = NULL;
+	}
+
+	if (coalescer->priv->session)
+	{
+		g_object_unref (coalescer->priv->session);
+		coalescer->priv->session = NULL;
+	}
+
+	G_OBJECT_CLASS (gedit_collaboration_coalescer_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_coalescer_finalize (GObject *object)
+{
+	GeditCollaborationCoalescer *coalescer = GEDIT_COLLABORATION_COALESCER (object);
+
+	g_string_free (coalescer->priv->deleted, TRUE);
+
+	G_OBJECT_CLASS (gedit_collaboration_coalescer_parent_class)->finalize (object);
+}
+
+static void
+gedit_collaboration_coalescer_set_property (GObject      *object,
+                                            guint         prop_id,
+                                            const GValue *value,
+                                            GParamSpec   *pspec)
+{
+	GeditCollaborationCoalescer *self = GEDIT_COLLABORATION_COALESCER (object);
+
+	switch (prop_id)
+	{
+		case PROP_SESSION:
+			self->priv->session = g_value_dup_object (value);
+		break;
+		case PROP_CONNECTION:
+			self->priv->connection = g_value_dup_object (value);
+		break;
+		case PROP_LATENCY:
+			self->priv->latency = g_value_get_uint (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_coalescer_get_property (GObject    *object,
+                                            guint       prop_id,
+                                            GValue     *value,
+                                            GParamSpec *pspec)
+{
+	GeditCollaborationCoalescer *self = GEDIT_COLLABORATION_COALESCER (object);
+
+	switch (prop_id)
+	{
+		case PROP_SESSION:
+			g_value_set_object (value, self->priv->session);
+		break;
+		case PROP_CONNECTION:
+			g_value_set_object (value, self->priv->connection);
+		break;
+		case PROP_LATENCY:
+			g_value_set_uint (value, self->priv->latency);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_coalescer_constructed (GObject *object)
+{
+	GeditCollaborationCoalescer *coalescer = GEDIT_COLLABORATION_COALESCER (object);
+	InfTextGtkBuffer *inf_buffer;
+
+	inf_buffer = INF_TEXT_GTK_BUFFER (inf_session_get_buffer (coalescer->priv->session));
+
+	coalescer->priv->inf_buffer = g_object_ref (inf_buffer);
+	coalescer->priv->buffer = g_object_ref (inf_text_gtk_buffer_get_text_buffer (inf_buffer));
+
+	/* Emission hooks run before any handler, in particular before the
+	   ones of the infinote buffer which turn edits into requests */
+	add_hook (coalescer,
+	          INSERT_TEXT,
+	          "insert-text",
+	          GTK_TYPE_TEXT_BUFFER,
+	          on_insert_text_hook);
+
+	add_hook (coalescer,
+	          DELETE_RANGE,
+	          "delete-range",
+	          GTK_TYPE_TEXT_BUFFER,
+	          on_delete_range_hook);
+
+	if (coalescer->priv->connection != NULL)
+	{
+		add_hook (coalescer,
+		          RECEIVED,
+		          "received",
+		          INF_TYPE_XML_CONNECTION,
+		          on_received_hook);
+	}
+
+	coalescer->priv->undo_handler =
+		g_signal_connect (coalescer->priv->buffer,
+		                  "undo",
+		                  G_CALLBACK (on_undo_redo),
+		                  coalescer);
+
+	coalescer->priv->redo_handler =
+		g_signal_connect (coalescer->priv->buffer,
+		                  "redo",
+		                  G_CALLBACK (on_undo_redo),
+		                  coalescer);
+}
+
+static void
+gedit_collaboration_coalescer_class_init (GeditCollaborationCoalescerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_coalescer_dispose;
+	object_class->finalize = gedit_collaboration_coalescer_finalize;
+	object_class->constructed = gedit_collaboration_coalescer_constructed;
+
+	object_class->set_property = gedit_collaboration_coalescer_set_property;
+	object_class->get_property = gedit_collaboration_coalescer_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_SESSION,
+	                                 g_param_spec_object ("session",
+	                                                      "Session",
+	                                                      "Session",
+	                                                      INF_TYPE_SESSION,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_CONNECTION,
+	                                 g_param_spec_object ("connection",
+	                                                      "Connection",
+	                                                      "Connection",
+	                                                      INF_TYPE_XML_CONNECTION,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_LATENCY,
+	                                 g_param_spec_uint ("latency",
+	                                                    "Latency",
+	                                                    "Latency",
+	                                                    1,
+	                                                    G_MAXUINT,
+	                                                    20,
+	                                                    G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationCoalescerPrivate));
+}
+
+static void
+gedit_collaboration_coalescer_class_finalize (GeditCollaborationCoalescerClass *klass)
+{
+}
+
+static void
+gedit_collaboration_coalescer_init (GeditCollaborationCoalescer *self)
+{
+	self->priv = GEDIT_COLLABORATION_COALESCER_GET_PRIVATE (self);
+
+	self->priv->deleted = g_string_new ("");
+}
+
+GeditCollaborationCoalescer *
+gedit_collaboration_coalescer_new (InfSession       *session,
+                                   InfXmlConnection *connection,
+                                   guint             latency)
+{
+	return g_object_new (GEDIT_COLLABORATION_TYPE_COALESCER,
+	                     "session", session,
+	                     "connection", connection,
+	                     "latency", latency,
+	                     NULL);
+}
+
+void
+_gedit_collaboration_coalescer_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_coalescer_register_type (type_module);
+}
@@ -0,0 +1,47 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_COALESCER_H__
+#define __GEDIT_COLLABORATION_COALESCER_H__
+
+#include <glib-object.h>
+#include <libinfinity/common/inf-session.h>
+#include <libinfinity/common/inf-xml-connection.h>
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_COALESCER		(gedit_collaboration_coalescer_get_type ())
+#define GEDIT_COLLABORATION_COALESCER(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_COALESCER, GeditCollaborationCoalescer))
+#define GEDIT_COLLABORATION_COALESCER_CONST(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_COALESCER, GeditCollaborationCoalescer const))
+#define GEDIT_COLLABORATION_COALESCER_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_COALESCER, GeditCollaborationCoalescerClass))
+#define GEDIT_COLLABORATION_IS_COALESCER(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_COALESCER))
+#define GEDIT_COLLABORATION_IS_COALESCER_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_COALESCER))
+#define GEDIT_COLLABORATION_COALESCER_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_COALESCER, GeditCollaborationCoalescerClass))
+
+typedef struct _GeditCollaborationCoalescer		GeditCollaborationCoalescer;
+typedef struct _GeditCollaborationCoalescerClass	GeditCollaborationCoalescerClass;
+typedef struct _GeditCollaborationCoalescerPrivate	GeditCollaborationCoalescerPrivate;
+
+struct _GeditCollaborationCoalescer
+{
+	GObject parent;
+
+	GeditCollaborationCoalescerPrivate *priv;
+};
+
+struct _GeditCollaborationCoalescerClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_coalescer_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_coalescer_register_type (GTypeModule *type_module);
+
+GeditCollaborationCoalescer *gedit_collaboration_coalescer_new (InfSession       *session,
+                                                                InfXmlConnection *connection,
+                                                                guint             latency);
+
+void gedit_collaboration_coalescer_flush (GeditCollaborationCoalescer *coalescer);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_COALESCER_H__ */
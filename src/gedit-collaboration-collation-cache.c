@@ -0,0 +1,365 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-collation-cache.h"
+
+#include <string.h>
+#include <libinfinity/client/infc-browser.h>
+#include <libinfgtk/inf-gtk-browser-model.h>
+
+#define GEDIT_COLLABORATION_COLLATION_CACHE_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_COLLATION_CACHE, GeditCollaborationCollationCachePrivate))
+
+typedef struct
+{
+	gboolean is_directory;
+	gchar *key;
+} CollationKey;
+
+typedef struct
+{
+	GeditCollaborationCollationCache *cache;
+	InfcBrowser *browser;
+
+	/* Node id -> CollationKey */
+	GHashTable *keys;
+} BrowserKeys;
+
+struct _GeditCollaborationCollationCachePrivate
+{
+	/* InfcBrowser -> BrowserKeys */
+	GHashTable *browsers;
+};
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationCollationCache,
+                       gedit_collaboration_collation_cache,
+                       G_TYPE_OBJECT)
+
+static void
+collation_key_free (CollationKey *key)
+{
+	g_free (key->key);
+	g_slice_free (CollationKey, key);
+}
+
+static CollationKey *
+collation_key_new (const gchar *name,
+                   gboolean     is_directory)
+{
+	CollationKey *key;
+	gchar *folded;
+
+	key = g_slice_new (CollationKey);
+	key->is_directory = is_directory;
+
+	folded = g_utf8_casefold (name ? name : "", -1);
+	key->key = g_utf8_collate_key (folded, -1);
+	g_free (folded);
+
+	return key;
+}
+
+static void on_node_removed (InfcBrowser     *browser,
+                             InfcBrowserIter *iter,
+                             BrowserKeys     *keys);
+
+static void on_browser_status_changed (InfcBrowser *browser,
+                                       GParamSpec  *spec,
+                                       BrowserKeys *keys);
+
+static void on_browser_finalized (BrowserKeys *keys,
+                                  GObject     *browser);
+
+static void
+browser_keys_free (BrowserKeys *keys)
+{
+	/* Unset when the browser is finalized */
+	if (keys->browser != NULL)
+	{
+		g_signal_handlers_disconnect_by_func (keys->browser,
+		                                      G_CALLBACK (on_node_removed),
+		                                      keys);
+
+		g_signal_handlers_disconnect_by_func (keys->browser,
+		                                      G_CALLBACK (on_browser_status_changed),
+		                                      keys);
+
+		g_object_weak_unref (G_OBJECT (keys->browser),
+		                     (GWeakNotify)on_browser_finalized,
+		                     keys);
+	}
+
+	g_hash_table_destroy (keys->keys);
+	g_slice_free (BrowserKeys, keys);
+}
+
+static void
+on_browser_finalized (BrowserKeys *keys,
+                      GObject     *browser)
+{
+	keys->browser = NULL;
+	g_hash_table_remove (keys->cache->priv->browsers, browser);
+}
+
+static void
+forget_node (BrowserKeys     *keys,
+             InfcBrowserIter *iter)
+{
+	/* Removing a directory removes everything below it without a
+	   signal for each node */
+	if (infc_browser_iter_is_subdirectory (keys->browser, iter) &&
+	    infc_browser_iter_get_explored (keys->browser, iter))
+	{
+		InfcBrowserIter child = *iter;
+
+		if (infc_browser_iter_get_child (keys->browser, &child))
+		{
+			do
+			{
+				forget_node (keys, &child);
+			} while (infc_browser_iter_get_next (keys->browser, &child));
+		}
+	}
+
+	g_hash_table_remove (keys->keys, GUINT_TO_POINTER (iter->node_id));
+}
+
+static void
+on_node_removed (InfcBrowser     *browser,
+                 InfcBrowserIter *iter,
+                 BrowserKeys     *keys)
+{
+	forget_node (keys, iter);
+}
+
+static void
+on_browser_status_changed (InfcBrowser *browser,
+                           GParamSpec  *spec,
+                           BrowserKeys *keys)
+{
+	/* Node ids are only meaningful for a single connection */
+	if (infc_browser_get_status (browser) == INFC_BROWSER_DISCONNECTED)
+	{
+		g_hash_table_remove_all (keys->keys);
+	}
+}
+
+static BrowserKeys *
+get_browser_keys (GeditCollaborationCollationCache *cache,
+                  InfcBrowser                      *browser)
+{
+	BrowserKeys *keys;
+
+	keys = g_hash_table_lookup (cache->priv->browsers, browser);
+
+	if (keys != NULL)
+	{
+		return keys;
+	}
+
+	keys = g_slice_new (BrowserKeys);
+	keys->cache = cache;
+	keys->browser = browser;
+	keys->keys = g_hash_table_new_full (g_direct_hash,
+	                                    g_direct_equal,
+	                                    NULL,
+	                                    (GDestroyNotify)collation_key_free);
+
+	g_signal_connect (browser,
+	                  "node-removed",
+	                  G_CALLBACK (on_node_removed),
+	                  keys);
+
+	g_signal_connect (browser,
+	                  "notify::status",
+	                  G_CALLBACK (on_browser_status_changed),
+	                  keys);
+
+	g_object_weak_ref (G_OBJECT (browser),
+	                   (GWeakNotify)on_browser_finalized,
+	                   keys);
+
+	g_hash_table_insert (cache->priv->browsers, browser, keys);
+
+	return keys;
+}
+
+static CollationKey const *
+lookup_node_key (GeditCollaborationCollationCache *cache,
+                 InfcBrowser                      *browser,
+                 InfcBrowserIter                  *iter)
+{
+	BrowserKeys *keys;
+	CollationKey *key;
+
+	keys = get_browser_keys (cache, browser);
+	key = g_hash_table_lookup (keys->keys, GUINT_TO_POINTER (iter->node_id));
+
+	if (key == NULL)
+	{
+		key = collation_key_new (infc_browser_iter_get_name (browser, iter),
+		                         infc_browser_iter_is_subdirectory (browser, iter));
+
+		g_hash_table_insert (keys->keys, GUINT_TO_POINTER (iter->node_id), key);
+	}
+
+	return key;
+}
+
+/* Nodes are looked up by their browser and node id. Connections are few
+   and their names change, their keys are not kept */
+static CollationKey const *
+get_row_key (GeditCollaborationCollationCache  *cache,
+             GtkTreeModel                      *model,
+             GtkTreeIter                       *iter,
+             CollationKey                     **owned)
+{
+	CollationKey const *key = NULL;
+	GtkTreeIter parent;
+	gchar *name;
+
+	*owned = NULL;
+
+	if (gtk_tree_model_iter_parent (model, &parent, iter))
+	{
+		InfcBrowser *browser;
+		InfcBrowserIter *browser_iter;
+
+		gtk_tree_model_get (model,
+		                    iter,
+		                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
+		                    &browser,
+		                    INF_GTK_BROWSER_MODEL_COL_NODE,
+		                    &browser_iter,
+		                    -1);
+
+		if (browser != NULL && browser_iter != NULL)
+		{
+			key = lookup_node_key (cache, browser, browser_iter);
+		}
+
+		if (browser != NULL)
+		{
+			g_object_unref (browser);
+		}
+
+		if (browser_iter != NULL)
+		{
+			infc_browser_iter_free (browser_iter);
+		}
+
+		if (key != NULL)
+		{
+			return key;
+		}
+	}
+
+	gtk_tree_model_get (model,
+	                    iter,
+	                    INF_GTK_BROWSER_MODEL_COL_NAME,
+	                    &name,
+	                    -1);
+
+	*owned = collation_key_new (name, FALSE);
+	g_free (name);
+
+	return *owned;
+}
+
+static gint
+compare_keys (CollationKey const *first,
+              CollationKey const *second)
+{
+	if (first->is_directory != second->is_directory)
+	{
+		return first->is_directory ? -1 : 1;
+	}
+
+	return strcmp (first->key, second->key);
+}
+
+static void
+gedit_collaboration_collation_cache_dispose (GObject *object)
+{
+	GeditCollaborationCollationCache *cache = GEDIT_COLLABORATION_COLLATION_CACHE (object);
+
+	g_hash_table_remove_all (cache->priv->browsers);
+
+	G_OBJECT_CLASS (gedit_collaboration_collation_cache_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_collation_cache_finalize (GObject *object)
+{
+	GeditCollaborationCollationCache *cache = GEDIT_COLLABORATION_COLLATION_CACHE (object);
+
+	g_hash_table_destroy (cache->priv->browsers);
+
+	G_OBJECT_CLASS (gedit_collaboration_collation_cache_parent_class)->finalize (object);
+}
+
+static void
+gedit_collaboration_collation_cache_class_init (GeditCollaborationCollationCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_collation_cache_dispose;
+	object_class->finalize = gedit_collaboration_collation_cache_finalize;
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationCollationCachePrivate));
+}
+
+static void
+gedit_collaboration_collation_cache_class_finalize (GeditCollaborationCollationCacheClass *klass)
+{
+}
+
+static void
+gedit_collaboration_collation_cache_init (GeditCollaborationCollationCache *self)
+{
+	self->priv = GEDIT_COLLABORATION_COLLATION_CACHE_GET_PRIVATE (self);
+
+	self->priv->browsers = g_hash_table_new_full (g_direct_hash,
+	                                              g_direct_equal,
+	                                              NULL,
+	                                              (GDestroyNotify)browser_keys_free);
+}
+
+GeditCollaborationCollationCache *
+gedit_collaboration_collation_cache_new (void)
+{
+	return g_object_new (GEDIT_COLLABORATION_TYPE_COLLATION_CACHE, NULL);
+}
+
+/* Sorts directories before documents and then by name, like gobby does */
+gint
+gedit_collaboration_collation_cache_compare (GeditCollaborationCollationCache *cache,
+                                             GtkTreeModel                     *model,
+                                             GtkTreeIter                      *first,
+                                             GtkTreeIter                      *second)
+{
+	CollationKey *owned_first;
+	CollationKey *owned_second;
+	gint result;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_COLLATION_CACHE (cache), 0);
+
+	result = compare_keys (get_row_key (cache, model, first, &owned_first),
+	                       get_row_key (cache, model, second, &owned_second));
+
+	if (owned_first != NULL)
+	{
+		collation_key_free (owned_first);
+	}
+
+	if (owned_second != NULL)
+	{
+		collation_key_free (owned_second);
+	}
+
+	return result;
+}
+
+void
+_gedit_collaboration_collation_cache_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_collation_cache_register_type (type_module);
+}
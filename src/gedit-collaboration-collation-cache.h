@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_COLLATION_CACHE_H__
+#define __GEDIT_COLLABORATION_COLLATION_CACHE_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_COLLATION_CACHE		(gedit_collaboration_collation_cache_get_type ())
+#define GEDIT_COLLABORATION_COLLATION_CACHE(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_COLLATION_CACHE, GeditCollaborationCollationCache))
+#define GEDIT_COLLABORATION_COLLATION_CACHE_CONST(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_COLLATION_CACHE, GeditCollaborationCollationCache const))
+#define GEDIT_COLLABORATION_COLLATION_CACHE_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_COLLATION_CACHE, GeditCollaborationCollationCacheClass))
+#define GEDIT_COLLABORATION_IS_COLLATION_CACHE(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_COLLATION_CACHE))
+#define GEDIT_COLLABORATION_IS_COLLATION_CACHE_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_COLLATION_CACHE))
+#define GEDIT_COLLABORATION_COLLATION_CACHE_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_COLLATION_CACHE, GeditCollaborationCollationCacheClass))
+
+typedef struct _GeditCollaborationCollationCache		GeditCollaborationCollationCache;
+typedef struct _GeditCollaborationCollationCacheClass	GeditCollaborationCollationCacheClass;
+typedef struct _GeditCollaborationCollationCachePrivate	GeditCollaborationCollationCachePrivate;
+
+struct _GeditCollaborationCollationCache
+{
+	GObject parent;
+
+	GeditCollaborationCollationCachePrivate *priv;
+};
+
+struct _GeditCollaborationCollationCacheClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_collation_cache_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_collation_cache_register_type (GTypeModule *type_module);
+
+GeditCollaborationCollationCache *gedit_collaboration_collation_cache_new (void);
+
+gint gedit_collaboration_collation_cache_compare (GeditCollaborationCollationCache *cache,
+                                                  GtkTreeModel                     *model,
+                                                  GtkTreeIter                      *first,
+                                                  GtkTreeIter                      *second);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_COLLATION_CACHE_H__ */
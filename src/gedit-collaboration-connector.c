@@ -0,0 +1,723 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-connector.h"
+#include "gedit-collaboration-receive-throttle.h"
+
+#include <gio/gio.h>
+#include <libinfinity/common/inf-ip-address.h>
+
+#define GEDIT_COLLABORATION_CONNECTOR_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_CONNECTOR, GeditCollaborationConnectorPrivate))
+
+/* Delay (in milliseconds) before the next address is tried while the
+   previous attempts are still in progress */
+#define STAGGER_DELAY 250
+
+struct _GeditCollaborationConnectorPrivate
+{
+	InfIo *io;
+	gchar *host;
+	guint port;
+
+	GCancellable *cancellable;
+
+	GList *addresses;
+	GList *next_address;
+
+	GSList *attempts;
+	GSList *closed;
+
+	guint stagger_id;
+	gboolean running;
+
+	GTimer *timer;
+	gdouble connect_time;
+
+	GError *error;
+};
+
+typedef struct
+{
+	GeditCollaborationConnector *connector;
+	GCancellable *cancellable;
+} ResolveData;
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_IO,
+	PROP_HOST,
+	PROP_PORT,
+	PROP_CONNECT_TIME
+};
+
+/* Signals */
+enum
+{
+	RESOLVED,
+	CONNECTED,
+	FAILED,
+	NUM_SIGNALS
+};
+
+static guint signals[NUM_SIGNALS] = {0,};
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationConnector,
+                       gedit_collaboration_connector,
+                       G_TYPE_OBJECT)
+
+static void on_attempt_status_changed (InfTcpConnection            *tcp,
+                                       GParamSpec                  *spec,
+                                       GeditCollaborationConnector *connector);
+
+static void on_attempt_error (InfTcpConnection            *tcp,
+                              const GError                *error,
+                              GeditCollaborationConnector *connector);
+
+static void
+set_error (GeditCollaborationConnector *connector,
+           const GError                *error)
+{
+	if (connector->priv->error)
+	{
+		g_error_free (connector->priv->error);
+	}
+
+	connector->priv->error = error ? g_error_copy (error) : NULL;
+}
+
+static void
+release_attempt (GeditCollaborationConnector *connector,
+                 InfTcpConnection            *tcp)
+{
+	g_signal_handlers_disconnect_by_func (tcp,
+	                                      G_CALLBACK (on_attempt_status_changed),
+	                                      connector);
+
+	g_signal_handlers_disconnect_by_func (tcp,
+	                                      G_CALLBACK (on_attempt_error),
+	                                      connector);
+
+	connector->priv->attempts = g_slist_remove (connector->priv->attempts,
+	                                            tcp);
+}
+
+static void
+close_attempts (GeditCollaborationConnector *connector)
+{
+	while (connector->priv->attempts)
+	{
+		InfTcpConnection *tcp = connector->priv->attempts->data;
+		InfTcpConnectionStatus status;
+
+		release_attempt (connector, tcp);
+
+		g_object_get (tcp, "status", &status, NULL);
+
+		if (status != INF_TCP_CONNECTION_CLOSED)
+		{
+			inf_tcp_connection_close (tcp);
+		}
+
+		g_object_unref (tcp);
+	}
+}
+
+static void
+free_closed (GeditCollaborationConnector *connector)
+{
+	g_slist_foreach (connector->priv->closed, (GFunc)g_object_unref, NULL);
+	g_slist_free (connector->priv->closed);
+	connector->priv->closed = NULL;
+}
+
+static void
+free_addresses (GeditCollaborationConnector *connector)
+{
+	g_list_foreach (connector->priv->addresses, (GFunc)g_object_unref, NULL);
+	g_list_free (connector->priv->addresses);
+
+	connector->priv->addresses = NULL;
+	connector->priv->next_address = NULL;
+}
+
+static void
+reset (GeditCollaborationConnector *connector)
+{
+	if (connector->priv->cancellable)
+	{
+		g_cancellable_cancel (connector->priv->cancellable);
+		g_object_unref (connector->priv->cancellable);
+		connector->priv->cancellable = NULL;
+	}
+
+	if (connector->priv->stagger_id)
+	{
+		g_source_remove (connector->priv->stagger_id);
+		connector->priv->stagger_id = 0;
+	}
+
+	close_attempts (connector);
+	free_addresses (connector);
+
+	connector->priv->running = FALSE;
+}
+
+static void
+gedit_collaboration_connector_dispose (GObject *object)
+{
+	GeditCollaborationConnector *connector = GEDIT_COLLABORATION_CONNECTOR (object);
+
+	reset (connector);
+	free_closed (connector);
+
+	if (connector->priv->io)
+	{
+		g_object_unref (connector->priv->io);
+		connector->priv->io = NULL;
+	}
+
+	G_OBJECT_CLASS (gedit_collaboration_connector_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_connector_finalize (GObject *object)
+{
+	GeditCollaborationConnector *connector = GEDIT_COLLABORATION_CONNECTOR (object);
+
+	g_free (connector->priv->host);
+	g_timer_destroy (connector->priv->timer);
+
+	set_error (connector, NULL);
+
+	G_OBJECT_CLASS (gedit_collaboration_connector_parent_class)->finalize (object);
+}
+
+static void
+gedit_collaboration_connector_set_property (GObject      *object,
+                                            guint         prop_id,
+                                            const GValue *value,
+                                            GParamSpec   *pspec)
+{
+	GeditCollaborationConnector *self = GEDIT_COLLABORATION_CONNECTOR (object);
+
+	switch (prop_id)
+	{
+		case PROP_IO:
+			self->priv->io = g_value_dup_object (value);
+		break;
+		case PROP_HOST:
+			g_free (self->priv->host);
+			self->priv->host = g_value_dup_string (value);
+		break;
+		case PROP_PORT:
+			self->priv->port = g_value_get_uint (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_connector_get_property (GObject    *object,
+                                            guint       prop_id,
+                                            GValue     *value,
+                                            GParamSpec *pspec)
+{
+	GeditCollaborationConnector *self = GEDIT_COLLABORATION_CONNECTOR (object);
+
+	switch (prop_id)
+	{
+		case PROP_IO:
+			g_value_set_object (value, self->priv->io);
+		break;
+		case PROP_HOST:
+			g_value_set_string (value, self->priv->host);
+		break;
+		case PROP_PORT:
+			g_value_set_uint (value, self->priv->port);
+		break;
+		case PROP_CONNECT_TIME:
+			g_value_set_double (value, self->priv->connect_time);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_connector_class_init (GeditCollaborationConnectorClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_connector_dispose;
+	object_class->finalize = gedit_collaboration_connector_finalize;
+
+	object_class->set_property = gedit_collaboration_connector_set_property;
+	object_class->get_property = gedit_collaboration_connector_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_IO,
+	                                 g_param_spec_object ("io",
+	                                                      "IO",
+	                                                      "IO",
+	                                                      INF_TYPE_IO,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_HOST,
+	                                 g_param_spec_string ("host",
+	                                                      "Host",
+	                                                      "Host",
+	                                                      NULL,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_PORT,
+	                                 g_param_spec_uint ("port",
+	                                                    "Port",
+	                                                    "Port",
+	                                                    0,
+	                                                    G_MAXUINT16,
+	                                                    0,
+	                                                    G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_CONNECT_TIME,
+	                                 g_param_spec_double ("connect-time",
+	                                                      "Connect Time",
+	                                                      "Seconds it took the last connect to succeed",
+	                                                      -1,
+	                                                      G_MAXDOUBLE,
+	                                                      -1,
+	                                                      G_PARAM_READABLE));
+
+	signals[RESOLVED] =
+		g_signal_new ("resolved",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL,
+		              NULL,
+		              g_cclosure_marshal_VOID__VOID,
+		              G_TYPE_NONE,
+		              0);
+
+	signals[CONNECTED] =
+		g_signal_new ("connected",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL,
+		              NULL,
+		              g_cclosure_marshal_VOID__OBJECT,
+		              G_TYPE_NONE,
+		              1,
+		              INF_TYPE_TCP_CONNECTION);
+
+	signals[FAILED] =
+		g_signal_new ("failed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL,
+		              NULL,
+		              g_cclosure_marshal_VOID__POINTER,
+		              G_TYPE_NONE,
+		              1,
+		              G_TYPE_POINTER);
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationConnectorPrivate));
+}
+
+static void
+gedit_collaboration_connector_class_finalize (GeditCollaborationConnectorClass *klass)
+{
+}
+
+static void
+gedit_collaboration_connector_init (GeditCollaborationConnector *self)
+{
+	self->priv = GEDIT_COLLABORATION_CONNECTOR_GET_PRIVATE (self);
+
+	self->priv->timer = g_timer_new ();
+	self->priv->connect_time = -1;
+}
+
+static void
+finish_failed (GeditCollaborationConnector *connector)
+{
+	GError *error;
+
+	reset (connector);
+
+	if (connector->priv->error)
+	{
+		error = g_error_copy (connector->priv->error);
+	}
+	else
+	{
+		error = g_error_new_literal (G_IO_ERROR,
+		                             G_IO_ERROR_FAILED,
+		                             "Could not connect");
+	}
+
+	/* Handlers might drop the last reference */
+	g_object_ref (connector);
+	g_signal_emit (connector, signals[FAILED], 0, error);
+	g_object_unref (connector);
+
+	g_error_free (error);
+}
+
+static gboolean
+start_attempt (GeditCollaborationConnector *connector)
+{
+	GInetAddress *address;
+	InfIpAddress *ipaddress;
+	InfTcpConnection *tcp;
+	GeditCollaborationReceiveThrottle *throttle;
+	gchar *ipaddr;
+	GError *error = NULL;
+
+	address = connector->priv->next_address->data;
+	connector->priv->next_address = g_list_next (connector->priv->next_address);
+
+	ipaddr = g_inet_address_to_string (address);
+	ipaddress = inf_ip_address_new_from_string (ipaddr);
+	g_free (ipaddr);
+
+	/* Every connection reads its socket within a time budget of its own */
+	throttle = gedit_collaboration_receive_throttle_new (connector->priv->io);
+
+	tcp = inf_tcp_connection_new (INF_IO (throttle),
+	                              ipaddress,
+	                              connector->priv->port);
+	inf_ip_address_free (ipaddress);
+	g_object_unref (throttle);
+
+	g_signal_connect (tcp,
+	                  "error",
+	                  G_CALLBACK (on_attempt_error),
+	                  connector);
+
+	g_signal_connect (tcp,
+	                  "notify::status",
+	                  G_CALLBACK (on_attempt_status_changed),
+	                  connector);
+
+	connector->priv->attempts = g_slist_prepend (connector->priv->attempts,
+	                                             tcp);
+
+	if (!inf_tcp_connection_open (tcp, &error))
+	{
+		set_error (connector, error);
+		g_error_free (error);
+
+		release_attempt (connector, tcp);
+		g_object_unref (tcp);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean on_stagger_timeout (GeditCollaborationConnector *connector);
+
+static void
+launch (GeditCollaborationConnector *connector)
+{
+	/* Start the next address which does not fail right away */
+	while (connector->priv->next_address != NULL)
+	{
+		if (start_attempt (connector))
+		{
+			break;
+		}
+	}
+
+	if (connector->priv->next_address != NULL &&
+	    connector->priv->stagger_id == 0)
+	{
+		connector->priv->stagger_id =
+			g_timeout_add (STAGGER_DELAY,
+			               (GSourceFunc)on_stagger_timeout,
+			               connector);
+	}
+
+	if (connector->priv->attempts == NULL &&
+	    connector->priv->next_address == NULL)
+	{
+		finish_failed (connector);
+	}
+}
+
+static gboolean
+on_stagger_timeout (GeditCollaborationConnector *connector)
+{
+	connector->priv->stagger_id = 0;
+	launch (connector);
+
+	return FALSE;
+}
+
+static void
+attempt_succeeded (GeditCollaborationConnector *connector,
+                   InfTcpConnection            *tcp)
+{
+	connector->priv->connect_time = g_timer_elapsed (connector->priv->timer,
+	                                                 NULL);
+
+	/* Take the winner out before closing the remaining attempts */
+	release_attempt (connector, tcp);
+	reset (connector);
+
+	set_error (connector, NULL);
+
+	g_object_ref (connector);
+
+	g_object_notify (G_OBJECT (connector), "connect-time");
+	g_signal_emit (connector, signals[CONNECTED], 0, tcp);
+
+	g_object_unref (connector);
+	g_object_unref (tcp);
+}
+
+static void
+attempt_failed (GeditCollaborationConnector *connector,
+                InfTcpConnection            *tcp)
+{
+	release_attempt (connector, tcp);
+
+	/* We are called from within a signal emission of tcp, so keep it
+	   alive until the connector is restarted or disposed */
+	connector->priv->closed = g_slist_prepend (connector->priv->closed, tcp);
+
+	/* Don't wait for the stagger delay if nothing is in flight anymore */
+	if (connector->priv->attempts == NULL && connector->priv->stagger_id)
+	{
+		g_source_remove (connector->priv->stagger_id);
+		connector->priv->stagger_id = 0;
+	}
+
+	if (connector->priv->attempts == NULL)
+	{
+		launch (connector);
+	}
+}
+
+static void
+on_attempt_error (InfTcpConnection            *tcp,
+                  const GError                *error,
+                  GeditCollaborationConnector *connector)
+{
+	set_error (connector, error);
+}
+
+static void
+on_attempt_status_changed (InfTcpConnection            *tcp,
+                           GParamSpec                  *spec,
+                           GeditCollaborationConnector *connector)
+{
+	InfTcpConnectionStatus status;
+
+	g_object_get (tcp, "status", &status, NULL);
+
+	switch (status)
+	{
+		case INF_TCP_CONNECTION_CONNECTED:
+			attempt_succeeded (connector, tcp);
+		break;
+		case INF_TCP_CONNECTION_CLOSED:
+			attempt_failed (connector, tcp);
+		break;
+		default:
+		break;
+	}
+}
+
+static GList *
+interleave_addresses (GList *addresses)
+{
+	GList *first = NULL;
+	GList *second = NULL;
+	GList *ret = NULL;
+	GSocketFamily family;
+	GList *item;
+
+	if (addresses == NULL)
+	{
+		return NULL;
+	}
+
+	/* Alternate between address families, starting with the family the
+	   resolver preferred, so that a broken family can not hold up the
+	   other one */
+	family = g_inet_address_get_family (addresses->data);
+
+	for (item = addresses; item; item = g_list_next (item))
+	{
+		GInetAddress *address = g_object_ref (item->data);
+
+		if (g_inet_address_get_family (address) == family)
+		{
+			first = g_list_prepend (first, address);
+		}
+		else
+		{
+			second = g_list_prepend (second, address);
+		}
+	}
+
+	first = g_list_reverse (first);
+	second = g_list_reverse (second);
+
+	while (first || second)
+	{
+		if (first)
+		{
+			ret = g_list_prepend (ret, first->data);
+			first = g_list_delete_link (first, first);
+		}
+
+		if (second)
+		{
+			ret = g_list_prepend (ret, second->data);
+			second = g_list_delete_link (second, second);
+		}
+	}
+
+	return g_list_reverse (ret);
+}
+
+static void
+on_resolved (GResolver    *resolver,
+             GAsyncResult *result,
+             ResolveData  *data)
+{
+	GeditCollaborationConnector *connector = data->connector;
+	GList *addresses;
+	GError *error = NULL;
+
+	addresses = g_resolver_lookup_by_name_finish (resolver, result, &error);
+
+	if (g_cancellable_is_cancelled (data->cancellable))
+	{
+		if (addresses)
+		{
+			g_resolver_free_addresses (addresses);
+		}
+
+		if (error)
+		{
+			g_error_free (error);
+		}
+	}
+	else if (!addresses)
+	{
+		set_error (connector, error);
+		g_error_free (error);
+
+		finish_failed (connector);
+	}
+	else
+	{
+		g_object_unref (connector->priv->cancellable);
+		connector->priv->cancellable = NULL;
+
+		connector->priv->addresses = interleave_addresses (addresses);
+		connector->priv->next_address = connector->priv->addresses;
+		g_resolver_free_addresses (addresses);
+
+		g_signal_emit (connector, signals[RESOLVED], 0);
+
+		launch (connector);
+	}
+
+	g_object_unref (data->cancellable);
+	g_object_unref (data->connector);
+	g_slice_free (ResolveData, data);
+}
+
+GeditCollaborationConnector *
+gedit_collaboration_connector_new (InfIo       *io,
+                                   const gchar *host,
+                                   guint        port)
+{
+	g_return_val_if_fail (INF_IS_IO (io), NULL);
+	g_return_val_if_fail (host != NULL, NULL);
+
+	return g_object_new (GEDIT_COLLABORATION_TYPE_CONNECTOR,
+	                     "io", io,
+	                     "host", host,
+	                     "port", port,
+	                     NULL);
+}
+
+void
+gedit_collaboration_connector_start (GeditCollaborationConnector *connector)
+{
+	GResolver *resolver;
+	ResolveData *data;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CONNECTOR (connector));
+
+	if (connector->priv->running)
+	{
+		return;
+	}
+
+	reset (connector);
+	free_closed (connector);
+	set_error (connector, NULL);
+
+	connector->priv->running = TRUE;
+	connector->priv->cancellable = g_cancellable_new ();
+
+	g_timer_start (connector->priv->timer);
+
+	data = g_slice_new (ResolveData);
+	data->connector = g_object_ref (connector);
+	data->cancellable = g_object_ref (connector->priv->cancellable);
+
+	resolver = g_resolver_get_default ();
+	g_resolver_lookup_by_name_async (resolver,
+	                                 connector->priv->host,
+	                                 connector->priv->cancellable,
+	                                 (GAsyncReadyCallback)on_resolved,
+	                                 data);
+	g_object_unref (resolver);
+}
+
+void
+gedit_collaboration_connector_cancel (GeditCollaborationConnector *connector)
+{
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CONNECTOR (connector));
+
+	reset (connector);
+}
+
+gboolean
+gedit_collaboration_connector_is_running (GeditCollaborationConnector *connector)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CONNECTOR (connector), FALSE);
+
+	return connector->priv->running;
+}
+
+gdouble
+gedit_collaboration_connector_get_connect_time (GeditCollaborationConnector *connector)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CONNECTOR (connector), -1);
+
+	return connector->priv->connect_time;
+}
+
+void
+_gedit_collaboration_connector_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_connector_register_type (type_module);
+}
@@ -0,0 +1,51 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_CONNECTOR_H__
+#define __GEDIT_COLLABORATION_CONNECTOR_H__
+
+#include <glib-object.h>
+#include <libinfinity/common/inf-io.h>
+#include <libinfinity/common/inf-tcp-connection.h>
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_CONNECTOR		(gedit_collaboration_connector_get_type ())
+#define GEDIT_COLLABORATION_CONNECTOR(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_CONNECTOR, GeditCollaborationConnector))
+#define GEDIT_COLLABORATION_CONNECTOR_CONST(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_CONNECTOR, GeditCollaborationConnector const))
+#define GEDIT_COLLABORATION_CONNECTOR_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_CONNECTOR, GeditCollaborationConnectorClass))
+#define GEDIT_COLLABORATION_IS_CONNECTOR(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_CONNECTOR))
+#define GEDIT_COLLABORATION_IS_CONNECTOR_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_CONNECTOR))
+#define GEDIT_COLLABORATION_CONNECTOR_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_CONNECTOR, GeditCollaborationConnectorClass))
+
+typedef struct _GeditCollaborationConnector		GeditCollaborationConnector;
+typedef struct _GeditCollaborationConnectorClass	GeditCollaborationConnectorClass;
+typedef struct _GeditCollaborationConnectorPrivate	GeditCollaborationConnectorPrivate;
+
+struct _GeditCollaborationConnector
+{
+	GObject parent;
+
+	GeditCollaborationConnectorPrivate *priv;
+};
+
+struct _GeditCollaborationConnectorClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_connector_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_connector_register_type (GTypeModule *type_module);
+
+GeditCollaborationConnector *gedit_collaboration_connector_new (InfIo       *io,
+                                                                const gchar *host,
+                                                                guint        port);
+
+void gedit_collaboration_connector_start (GeditCollaborationConnector *connector);
+void gedit_collaboration_connector_cancel (GeditCollaborationConnector *connector);
+
+gboolean gedit_collaboration_connector_is_running (GeditCollaborationConnector *connector);
+gdouble gedit_collaboration_connector_get_connect_time (GeditCollaborationConnector *connector);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_CONNECTOR_H__ */
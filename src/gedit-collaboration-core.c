@@ -0,0 +1,2149 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-core.h"
+
+#include <config.h>
+#include <glib/gi18n-lib.h>
+#include <gedit/gedit-app.h>
+
+#include <libinfgtk/inf-gtk-io.h>
+#include <libinfinity/common/inf-xmpp-manager.h>
+#include <libinfinity/common/inf-xmpp-connection.h>
+#include <libinfinity/common/inf-error.h>
+#include <libinfinity/inf-config.h>
+#include <libinftext/inf-text-session.h>
+#include <libinftext/inf-text-default-buffer.h>
+
+#ifdef LIBINFINITY_HAVE_AVAHI
+#include <libinfinity/common/inf-discovery-avahi.h>
+#endif
+
+#include "gedit-collaboration.h"
+#include "gedit-collaboration-bookmarks.h"
+#include "gedit-collaboration-connector.h"
+#include "gedit-collaboration-chat-log.h"
+#include "gedit-collaboration-collation-cache.h"
+#include "gedit-collaboration-listing-cache.h"
+
+#define GEDIT_COLLABORATION_CORE_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_CORE, GeditCollaborationCorePrivate))
+
+struct _GeditCollaborationCorePrivate
+{
+	gchar *data_dir;
+	GSettings *settings;
+
+	InfIo *io;
+	InfCommunicationManager *communication_manager;
+	InfXmppManager *xmpp_manager;
+	InfCertificateCredentials *certificate_credentials;
+	InfGtkBrowserStore *browser_store;
+	GeditCollaborationCollationCache *collation_cache;
+	GeditCollaborationPathIndex *path_index;
+
+	InfcNotePlugin note_plugin;
+
+	GSList *managers;
+
+	/* InfXmlConnection -> GQueue of managers waiting for a session, NULL
+	   for a window that was closed in the meantime */
+	GHashTable *pending_subscriptions;
+
+	/* InfcBrowser -> ChatData */
+	GHashTable *chats;
+
+	/* InfcBrowser -> GeditCollaborationListingCache */
+	GHashTable *listing_caches;
+
+	GSList *bookmark_connections;
+	guint added_handler_id;
+	guint removed_handler_id;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_DATA_DIR
+};
+
+/* Signals */
+enum
+{
+	CHAT_ADDED,
+	CHAT_JOINED,
+	CHAT_REMOVED,
+	CHAT_UNREAD_CHANGED,
+	NUM_SIGNALS
+};
+
+static guint signals[NUM_SIGNALS] = {0,};
+
+static GeditCollaborationCore *core_default = NULL;
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationCore,
+                       gedit_collaboration_core,
+                       G_TYPE_OBJECT)
+
+typedef struct
+{
+	GeditCollaborationCore *core;
+	InfcBrowser *browser;
+	InfcSessionProxy *proxy;
+	GObject *request;
+
+	InfUser *user;
+	gchar *user_name;
+	gint name_failed_counter;
+
+	GeditCollaborationChatLog *log;
+
+	/* Where the messages of this subscription start in the log */
+	goffset log_start;
+
+	/* Time of the last message in the log when it was opened, and the
+	   lines logged with that time, to recognize them in the backlog */
+	gint64 log_time;
+	GHashTable *logged;
+
+	gboolean synchronized;
+	guint unread;
+} ChatData;
+
+typedef enum
+{
+	BOOKMARK_STATE_IDLE,
+	BOOKMARK_STATE_RESOLVING,
+	BOOKMARK_STATE_RESOLVE_FAILED,
+	BOOKMARK_STATE_CONNECTING,
+	BOOKMARK_STATE_CONNECT_FAILED,
+	BOOKMARK_STATE_CONNECTED
+} BookmarkState;
+
+typedef struct
+{
+	GeditCollaborationCore *core;
+	GeditCollaborationBookmark *bookmark;
+
+	GeditCollaborationConnector *connector;
+	InfXmlConnection *connection;
+	InfcBrowser *browser;
+
+	BookmarkState state;
+
+	/* Not part of the saved bookmarks, see add_temporary_bookmark */
+	gboolean temporary;
+
+	/* Subscribed (non chat) sessions keeping the connection alive */
+	GSList *sessions;
+	guint idle_disconnect_id;
+} BookmarkConnection;
+
+static void bookmark_connection_free (BookmarkConnection *bc);
+static void chat_data_free (ChatData *cdata);
+
+static void
+free_bookmark_connections (GeditCollaborationCore *core)
+{
+	g_slist_foreach (core->priv->bookmark_connections,
+	                 (GFunc)bookmark_connection_free,
+	                 NULL);
+
+	g_slist_free (core->priv->bookmark_connections);
+	core->priv->bookmark_connections = NULL;
+}
+
+static void
+gedit_collaboration_core_dispose (GObject *object)
+{
+	GeditCollaborationCore *core = GEDIT_COLLABORATION_CORE (object);
+
+	if (core->priv->browser_store)
+	{
+		GeditCollaborationBookmarks *bookmarks;
+
+		bookmarks = gedit_collaboration_bookmarks_get_default ();
+
+		g_signal_handler_disconnect (bookmarks, core->priv->added_handler_id);
+		g_signal_handler_disconnect (bookmarks, core->priv->removed_handler_id);
+
+		free_bookmark_connections (core);
+
+		g_hash_table_destroy (core->priv->chats);
+		core->priv->chats = NULL;
+
+		g_hash_table_destroy (core->priv->listing_caches);
+		core->priv->listing_caches = NULL;
+
+		g_object_unref (core->priv->collation_cache);
+		core->priv->collation_cache = NULL;
+
+		g_object_unref (core->priv->path_index);
+		core->priv->path_index = NULL;
+
+		g_object_unref (core->priv->browser_store);
+		core->priv->browser_store = NULL;
+	}
+
+	if (core->priv->xmpp_manager)
+	{
+		g_object_unref (core->priv->xmpp_manager);
+		core->priv->xmpp_manager = NULL;
+	}
+
+	if (core->priv->communication_manager)
+	{
+		g_object_unref (core->priv->communication_manager);
+		core->priv->communication_manager = NULL;
+	}
+
+	if (core->priv->io)
+	{
+		g_object_unref (core->priv->io);
+		core->priv->io = NULL;
+	}
+
+	if (core->priv->settings)
+	{
+		g_object_unref (core->priv->settings);
+		core->priv->settings = NULL;
+	}
+
+	G_OBJECT_CLASS (gedit_collaboration_core_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_core_finalize (GObject *object)
+{
+	GeditCollaborationCore *core = GEDIT_COLLABORATION_CORE (object);
+
+	g_hash_table_destroy (core->priv->pending_subscriptions);
+	g_slist_free (core->priv->managers);
+
+	if (core->priv->certificate_credentials)
+	{
+		inf_certificate_credentials_unref (core->priv->certificate_credentials);
+	}
+
+	g_free (core->priv->data_dir);
+
+	G_OBJECT_CLASS (gedit_collaboration_core_parent_class)->finalize (object);
+}
+
+static void
+gedit_collaboration_core_set_property (GObject      *object,
+                                       guint         prop_id,
+                                       const GValue *value,
+                                       GParamSpec   *pspec)
+{
+	GeditCollaborationCore *self = GEDIT_COLLABORATION_CORE (object);
+
+	switch (prop_id)
+	{
+		case PROP_DATA_DIR:
+			g_free (self->priv->data_dir);
+			self->priv->data_dir = g_value_dup_string (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_core_get_property (GObject    *object,
+                                       guint       prop_id,
+                                       GValue     *value,
+                                       GParamSpec *pspec)
+{
+	GeditCollaborationCore *self = GEDIT_COLLABORATION_CORE (object);
+
+	switch (prop_id)
+	{
+		case PROP_DATA_DIR:
+			g_value_set_string (value, self->priv->data_dir);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+/* Password requests */
+static gchar *
+show_password_dialog (GeditCollaborationCore *core,
+                      GeditCollaborationUser *user,
+                      InfXmppConnection      *connection)
+{
+	GtkBuilder *builder;
+	GtkWidget *dialog;
+	GtkWidget *label;
+	GtkWidget *entry;
+	GeditWindow *window;
+	gchar *password;
+	gchar *remote;
+	gchar *text;
+	gchar *name;
+	gchar *username;
+	gchar *remotename;
+
+	builder = gedit_collaboration_create_builder (core->priv->data_dir,
+	                                              "gedit-collaboration-password-dialog.ui");
+
+	if (!builder)
+	{
+		return NULL;
+	}
+
+	dialog = GTK_WIDGET (gtk_builder_get_object (builder, "dialog_password"));
+	label = GTK_WIDGET (gtk_builder_get_object (builder, "label_caption"));
+	entry = GTK_WIDGET (gtk_builder_get_object (builder, "entry_password"));
+
+	/* Connections are shared between windows, ask on the one in use */
+	window = gedit_app_get_active_window (gedit_app_get_default ());
+
+	if (window != NULL)
+	{
+		gtk_window_set_transient_for (GTK_WINDOW (dialog), GTK_WINDOW (window));
+	}
+
+	g_object_get (connection, "remote-hostname", &remote, NULL);
+
+	username = g_markup_escape_text (gedit_collaboration_user_get_name (user), -1);
+	remotename = g_markup_escape_text (remote, -1);
+
+	name = g_strdup_printf ("<i>%s@%s</i>", username, remotename);
+
+	g_free (remote);
+	g_free (username);
+	g_free (remotename);
+
+	text = g_strdup_printf (_("Please provide a password for %s"),
+	                        name);
+	g_free (name);
+
+	if (!inf_xmpp_connection_get_tls_enabled (connection))
+	{
+		gchar *all = g_strdup_printf ("%s\n\n<small><b>%s</b></small>",
+		                              text,
+		                              _("Note: The connection is not secure"));
+
+		g_free (text);
+		text = all;
+	}
+
+	gtk_label_set_markup (GTK_LABEL (label),
+	                      text);
+	g_free (text);
+
+	gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+
+	/* Need to do this modal/sync for now */
+	if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_OK)
+	{
+		password = g_strdup (gtk_entry_get_text (GTK_ENTRY (entry)));
+
+		if (!*password)
+		{
+			g_free (password);
+			password = NULL;
+		}
+	}
+	else
+	{
+		password = NULL;
+	}
+
+	g_object_unref (builder);
+	gtk_widget_destroy (dialog);
+
+	return password;
+}
+
+static void
+user_request_password (GeditCollaborationUser *user,
+                       gpointer                session_data,
+                       GeditCollaborationCore *core)
+{
+	gchar *password;
+
+	password = show_password_dialog (core, user, session_data);
+	gedit_collaboration_user_set_password (user, password);
+
+	g_free (password);
+}
+
+/* Chat */
+static void
+chat_data_free (ChatData *cdata)
+{
+	if (cdata->request)
+	{
+		g_signal_handlers_disconnect_matched (cdata->request,
+		                                      G_SIGNAL_MATCH_DATA,
+		                                      0,
+		                                      0,
+		                                      NULL,
+		                                      NULL,
+		                                      cdata);
+
+		g_object_unref (cdata->request);
+	}
+
+	if (cdata->proxy)
+	{
+		InfSession *session;
+
+		session = infc_session_proxy_get_session (cdata->proxy);
+
+		g_signal_handlers_disconnect_matched (inf_session_get_buffer (session),
+		                                      G_SIGNAL_MATCH_DATA,
+		                                      0,
+		                                      0,
+		                                      NULL,
+		                                      NULL,
+		                                      cdata);
+
+		g_signal_handlers_disconnect_matched (session,
+		                                      G_SIGNAL_MATCH_DATA,
+		                                      0,
+		                                      0,
+		                                      NULL,
+		                                      NULL,
+		                                      cdata);
+
+		if (cdata->synchronized)
+		{
+			g_signal_emit (cdata->core, signals[CHAT_REMOVED], 0, cdata->browser);
+		}
+
+		if (inf_session_get_status (session) != INF_SESSION_CLOSED)
+		{
+			inf_session_close (session);
+		}
+
+		g_object_unref (cdata->proxy);
+	}
+
+	if (cdata->user)
+	{
+		g_object_unref (cdata->user);
+	}
+
+	if (cdata->log)
+	{
+		g_signal_handlers_disconnect_matched (cdata->log,
+		                                      G_SIGNAL_MATCH_DATA,
+		                                      0,
+		                                      0,
+		                                      NULL,
+		                                      NULL,
+		                                      cdata);
+
+		g_object_unref (cdata->log);
+	}
+
+	if (cdata->logged)
+	{
+		g_hash_table_destroy (cdata->logged);
+	}
+
+	g_free (cdata->user_name);
+
+	g_slice_free (ChatData, cdata);
+}
+
+static void
+set_chat_request (ChatData *cdata,
+                  gpointer  request)
+{
+	if (cdata->request)
+	{
+		g_signal_handlers_disconnect_matched (cdata->request,
+		                                      G_SIGNAL_MATCH_DATA,
+		                                      0,
+		                                      0,
+		                                      NULL,
+		                                      NULL,
+		                                      cdata);
+
+		g_object_unref (cdata->request);
+	}
+
+	cdata->request = request ? g_object_ref (request) : NULL;
+}
+
+static void chat_request_join (ChatData *cdata, const gchar *name);
+
+static void
+on_chat_join_finished (InfcUserRequest *request,
+                       InfUser         *user,
+                       ChatData        *cdata)
+{
+	set_chat_request (cdata, NULL);
+
+	cdata->user = g_object_ref (user);
+	g_signal_emit (cdata->core, signals[CHAT_JOINED], 0, cdata->browser);
+}
+
+static void
+on_chat_join_failed (InfcRequest  *request,
+                     const GError *error,
+                     ChatData     *cdata)
+{
+	if (error->domain == inf_user_error_quark () &&
+	    error->code == INF_USER_ERROR_NAME_IN_USE)
+	{
+		gchar *new_name;
+
+		new_name = gedit_collaboration_generate_new_name (
+			cdata->user_name,
+			&cdata->name_failed_counter);
+
+		chat_request_join (cdata, new_name);
+
+		g_free (new_name);
+	}
+	else
+	{
+		g_warning ("%s", error->message);
+		set_chat_request (cdata, NULL);
+	}
+}
+
+static void
+chat_request_join (ChatData    *cdata,
+                   const gchar *name)
+{
+	InfcUserRequest *request;
+	GError *error = NULL;
+
+	GParameter parameters[] = {
+		{"name", {0,}}
+	};
+
+	g_value_init (&parameters[0].value, G_TYPE_STRING);
+	g_value_set_string (&parameters[0].value,
+	                    name);
+
+	request = infc_session_proxy_join_user (cdata->proxy,
+	                                        parameters,
+	                                        1,
+	                                        &error);
+
+	g_value_unset (&parameters[0].value);
+
+	if (error != NULL)
+	{
+		g_warning ("%s", error->message);
+		g_error_free (error);
+
+		set_chat_request (cdata, NULL);
+		return;
+	}
+
+	set_chat_request (cdata, request);
+
+	g_signal_connect_after (request,
+	                        "failed",
+	                        G_CALLBACK (on_chat_join_failed),
+	                        cdata);
+
+	g_signal_connect_after (request,
+	                        "finished",
+	                        G_CALLBACK (on_chat_join_finished),
+	                        cdata);
+}
+
+static void
+on_chat_sync_failed (InfSession       *session,
+                     InfXmlConnection *connection,
+                     const GError     *error,
+                     ChatData         *cdata)
+{
+	if (error != NULL)
+	{
+		g_warning ("%s", error->message);
+	}
+
+	g_hash_table_remove (cdata->core->priv->chats, cdata->browser);
+}
+
+static void
+on_chat_receive_message (InfChatSession             *session,
+                         const InfChatBufferMessage *message,
+                         ChatData                   *cdata)
+{
+	/* Only count what people actually said */
+	if (message->type != INF_CHAT_BUFFER_MESSAGE_NORMAL &&
+	    message->type != INF_CHAT_BUFFER_MESSAGE_EMOTE)
+	{
+		return;
+	}
+
+	if (message->user == cdata->user)
+	{
+		return;
+	}
+
+	++cdata->unread;
+	g_signal_emit (cdata->core, signals[CHAT_UNREAD_CHANGED], 0, cdata->browser);
+}
+
+static void
+on_chat_sync_completed (InfSession       *session,
+                        InfXmlConnection *connection,
+                        ChatData         *cdata)
+{
+	GeditCollaborationBookmark *bookmark;
+	GeditCollaborationUser *user;
+
+	g_signal_handlers_disconnect_by_func (session,
+	                                      G_CALLBACK (on_chat_sync_failed),
+	                                      cdata);
+
+	g_signal_handlers_disconnect_by_func (session,
+	                                      G_CALLBACK (on_chat_sync_completed),
+	                                      cdata);
+
+	bookmark = g_object_get_data (G_OBJECT (connection),
+	                              BOOKMARK_DATA_KEY);
+
+	if (bookmark)
+	{
+		user = gedit_collaboration_bookmark_get_user (bookmark);
+	}
+	else
+	{
+		user = gedit_collaboration_user_get_default ();
+	}
+
+	g_signal_connect (session,
+	                  "receive-message",
+	                  G_CALLBACK (on_chat_receive_message),
+	                  cdata);
+
+	cdata->synchronized = TRUE;
+	cdata->user_name = g_strdup (gedit_collaboration_user_get_name (user));
+
+	/* Only the backlog could contain messages logged before */
+	if (cdata->logged != NULL)
+	{
+		g_hash_table_destroy (cdata->logged);
+		cdata->logged = NULL;
+	}
+
+	g_signal_emit (cdata->core, signals[CHAT_ADDED], 0, cdata->browser);
+
+	chat_request_join (cdata, cdata->user_name);
+}
+
+static void
+on_chat_add_message (InfChatBuffer              *buffer,
+                     const InfChatBufferMessage *message,
+                     ChatData                   *cdata)
+{
+	gchar *line;
+
+	line = gedit_collaboration_chat_log_format_message (message);
+
+	/* The synchronization replays the backlog of the server, part of
+	   which was logged already in an earlier session */
+	if (!cdata->synchronized &&
+	    (message->time < cdata->log_time ||
+	     (message->time == cdata->log_time &&
+	      g_hash_table_remove (cdata->logged, line))))
+	{
+		g_free (line);
+		return;
+	}
+
+	gedit_collaboration_chat_log_append (cdata->log, line);
+	g_free (line);
+}
+
+/* Number of lines read at a time when looking for the last messages */
+#define LOGGED_READ_LINES 16
+
+static void
+read_logged_messages (ChatData *cdata)
+{
+	goffset offset;
+	gboolean done = FALSE;
+
+	cdata->log_time = 0;
+	cdata->logged = g_hash_table_new_full (g_str_hash,
+	                                       g_str_equal,
+	                                       g_free,
+	                                       NULL);
+
+	offset = gedit_collaboration_chat_log_get_size (cdata->log);
+
+	/* Several messages can have the same time as the last one */
+	while (!done && offset > 0)
+	{
+		gchar **lines;
+		goffset *offsets;
+		gint i;
+
+		lines = gedit_collaboration_chat_log_read_before (cdata->log,
+		                                                  offset,
+		                                                  LOGGED_READ_LINES,
+		                                                  &offsets);
+
+		if (lines == NULL || lines[0] == NULL)
+		{
+			g_strfreev (lines);
+			g_free (offsets);
+			break;
+		}
+
+		for (i = g_strv_length (lines) - 1; i >= 0 && !done; --i)
+		{
+			InfChatBufferMessageType type;
+			gint64 time;
+			gchar *name;
+			gchar *text;
+
+			if (!gedit_collaboration_chat_log_parse_message (lines[i],
+			                                                 &time,
+			                                                 &type,
+			                                                 &name,
+			                                                 &text))
+			{
+				done = TRUE;
+				break;
+			}
+
+			g_free (name);
+			g_free (text);
+
+			if (cdata->log_time == 0)
+			{
+				cdata->log_time = time;
+			}
+
+			if (time != cdata->log_time)
+			{
+				done = TRUE;
+				break;
+			}
+
+			g_hash_table_insert (cdata->logged, g_strdup (lines[i]), NULL);
+		}
+
+		offset = offsets[0];
+
+		g_strfreev (lines);
+		g_free (offsets);
+	}
+}
+
+static void
+on_chat_log_rotated (GeditCollaborationChatLog *log,
+                     ChatData                  *cdata)
+{
+	cdata->log_start = 0;
+}
+
+static GeditCollaborationChatLog *
+create_chat_log (InfcBrowser *browser)
+{
+	GeditCollaborationChatLog *log;
+	gchar *key;
+	gchar *name;
+	gchar *filename;
+
+	key = gedit_collaboration_get_server_key (infc_browser_get_connection (browser));
+
+	name = g_strdup_printf ("%s.log", key);
+	g_strdelimit (name, G_DIR_SEPARATOR_S ":", '_');
+
+	filename = g_build_filename (g_get_user_cache_dir (),
+	                             "gedit",
+	                             "collaboration",
+	                             "chat",
+	                             name,
+	                             NULL);
+
+	log = gedit_collaboration_chat_log_new (filename);
+
+	g_free (filename);
+	g_free (name);
+	g_free (key);
+
+	return log;
+}
+
+static void
+on_chat_subscribe_finished (InfcNodeRequest *request,
+                            InfcBrowserIter *iter,
+                            ChatData        *cdata)
+{
+	InfcSessionProxy *proxy;
+	InfSession *session;
+
+	set_chat_request (cdata, NULL);
+	proxy = infc_browser_get_chat_session (cdata->browser);
+
+	if (proxy == NULL)
+	{
+		g_hash_table_remove (cdata->core->priv->chats, cdata->browser);
+		return;
+	}
+
+	cdata->proxy = g_object_ref (proxy);
+	session = infc_session_proxy_get_session (proxy);
+
+	/* Everything said in the chat goes to an append-only log on disk, so
+	   views only need to keep the most recent lines in memory */
+	cdata->log = create_chat_log (cdata->browser);
+	cdata->log_start = gedit_collaboration_chat_log_get_size (cdata->log);
+	read_logged_messages (cdata);
+
+	g_signal_connect (cdata->log,
+	                  "rotated",
+	                  G_CALLBACK (on_chat_log_rotated),
+	                  cdata);
+
+	g_signal_connect (inf_session_get_buffer (session),
+	                  "add-message",
+	                  G_CALLBACK (on_chat_add_message),
+	                  cdata);
+
+	g_signal_connect_after (session,
+	                        "synchronization-failed",
+	                        G_CALLBACK (on_chat_sync_failed),
+	                        cdata);
+
+	g_signal_connect_after (session,
+	                        "synchronization-complete",
+	                        G_CALLBACK (on_chat_sync_completed),
+	                        cdata);
+}
+
+static void
+on_chat_subscribe_failed (InfcRequest  *request,
+                          const GError *error,
+                          ChatData     *cdata)
+{
+	if (error != NULL)
+	{
+		g_warning ("%s", error->message);
+	}
+
+	g_hash_table_remove (cdata->core->priv->chats, cdata->browser);
+}
+
+static void
+request_chat (GeditCollaborationCore *core,
+              InfcBrowser            *browser)
+{
+	InfcNodeRequest *request;
+	ChatData *cdata;
+
+	if (g_hash_table_lookup (core->priv->chats, browser) != NULL)
+	{
+		return;
+	}
+
+	request = infc_browser_subscribe_chat (browser);
+
+	cdata = g_slice_new0 (ChatData);
+	cdata->core = core;
+	cdata->browser = browser;
+
+	g_hash_table_insert (core->priv->chats, browser, cdata);
+	set_chat_request (cdata, request);
+
+	g_signal_connect (request,
+	                  "failed",
+	                  G_CALLBACK (on_chat_subscribe_failed),
+	                  cdata);
+
+	g_signal_connect (request,
+	                  "finished",
+	                  G_CALLBACK (on_chat_subscribe_finished),
+	                  cdata);
+}
+
+static void
+add_listing_cache (GeditCollaborationCore *core,
+                   InfcBrowser            *browser)
+{
+	GeditCollaborationListingCache *cache;
+	gchar *key;
+	gchar *name;
+	gchar *filename;
+
+	if (g_hash_table_lookup (core->priv->listing_caches, browser) != NULL)
+	{
+		return;
+	}
+
+	key = gedit_collaboration_get_server_key (infc_browser_get_connection (browser));
+
+	name = g_strdup_printf ("%s.xml", key);
+	g_strdelimit (name, G_DIR_SEPARATOR_S ":", '_');
+
+	filename = g_build_filename (g_get_user_cache_dir (),
+	                             "gedit",
+	                             "collaboration",
+	                             "listings",
+	                             name,
+	                             NULL);
+
+	cache = gedit_collaboration_listing_cache_new (browser, filename);
+	g_hash_table_insert (core->priv->listing_caches, browser, cache);
+
+	g_free (filename);
+	g_free (name);
+	g_free (key);
+}
+
+static void
+add_path_index_browser (GeditCollaborationCore *core,
+                        InfcBrowser            *browser)
+{
+	InfXmlConnection *connection;
+	GeditCollaborationBookmark *bookmark;
+	gchar *host = NULL;
+
+	connection = infc_browser_get_connection (browser);
+	bookmark = g_object_get_data (G_OBJECT (connection), BOOKMARK_DATA_KEY);
+
+	if (bookmark == NULL)
+	{
+		g_object_get (connection, "remote-hostname", &host, NULL);
+	}
+
+	gedit_collaboration_path_index_add_browser (core->priv->path_index,
+	                                            browser,
+	                                            bookmark ? gedit_collaboration_bookmark_get_name (bookmark)
+	                                                     : host);
+
+	g_free (host);
+}
+
+static void
+on_browser_status_changed (InfcBrowser            *browser,
+                           GParamSpec             *spec,
+                           GeditCollaborationCore *core)
+{
+	InfcBrowserStatus status;
+
+	status = infc_browser_get_status (browser);
+
+	/* Directories explored in an earlier session are explored again
+	   right away */
+	if (status == INFC_BROWSER_CONNECTED)
+	{
+		add_listing_cache (core, browser);
+		add_path_index_browser (core, browser);
+	}
+
+	/* The chat is only subscribed once somebody looks at it, see
+	   gedit_collaboration_core_request_chat */
+	if (status == INFC_BROWSER_DISCONNECTED)
+	{
+		g_hash_table_remove (core->priv->chats, browser);
+		g_hash_table_remove (core->priv->listing_caches, browser);
+
+		gedit_collaboration_path_index_remove_browser (core->priv->path_index,
+		                                               browser);
+
+		/* Requests on a closed connection never get a session */
+		g_hash_table_remove (core->priv->pending_subscriptions,
+		                     infc_browser_get_connection (browser));
+	}
+}
+
+/* Bookmarks */
+static void
+update_connection_name (BookmarkConnection *bc)
+{
+	const gchar *name;
+	gchar *display;
+
+	name = gedit_collaboration_bookmark_get_name (bc->bookmark);
+
+	switch (bc->state)
+	{
+		case BOOKMARK_STATE_RESOLVING:
+			display = g_strdup_printf (_("%s (resolving...)"), name);
+		break;
+		case BOOKMARK_STATE_RESOLVE_FAILED:
+			display = g_strdup_printf (_("%s (could not resolve host)"), name);
+		break;
+		case BOOKMARK_STATE_CONNECTING:
+			display = g_strdup_printf (_("%s (connecting...)"), name);
+		break;
+		case BOOKMARK_STATE_CONNECT_FAILED:
+			display = g_strdup_printf (_("%s (could not connect)"), name);
+		break;
+		default:
+			display = g_strdup (name);
+		break;
+	}
+
+	inf_gtk_browser_store_set_connection_name (bc->core->priv->browser_store,
+	                                           bc->connection,
+	                                           display);
+
+	g_free (display);
+}
+
+static void
+on_bookmark_name_changed (GeditCollaborationBookmark *bookmark,
+                          GParamSpec                 *spec,
+                          BookmarkConnection         *bc)
+{
+	update_connection_name (bc);
+}
+
+static BookmarkConnection *
+find_bookmark_connection (GeditCollaborationCore *core,
+                          InfXmlConnection       *connection)
+{
+	GSList *item;
+
+	for (item = core->priv->bookmark_connections; item; item = g_slist_next (item))
+	{
+		BookmarkConnection *bc = item->data;
+
+		if (bc->connection == connection)
+		{
+			return bc;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+stop_idle_disconnect (BookmarkConnection *bc)
+{
+	if (bc->idle_disconnect_id != 0)
+	{
+		g_source_remove (bc->idle_disconnect_id);
+		bc->idle_disconnect_id = 0;
+	}
+}
+
+static gboolean
+on_idle_disconnect_timeout (BookmarkConnection *bc)
+{
+	InfXmlConnectionStatus status;
+
+	bc->idle_disconnect_id = 0;
+
+	g_object_get (bc->connection, "status", &status, NULL);
+
+	if (status != INF_XML_CONNECTION_CLOSED &&
+	    status != INF_XML_CONNECTION_CLOSING)
+	{
+		inf_xml_connection_close (bc->connection);
+	}
+
+	return FALSE;
+}
+
+static void
+schedule_idle_disconnect (BookmarkConnection *bc)
+{
+	guint timeout;
+
+	stop_idle_disconnect (bc);
+
+	if (bc->sessions != NULL ||
+	    bc->browser == NULL ||
+	    infc_browser_get_status (bc->browser) != INFC_BROWSER_CONNECTED)
+	{
+		return;
+	}
+
+	timeout = g_settings_get_uint (bc->core->priv->settings,
+	                               "idle-disconnect-timeout");
+
+	if (timeout != 0)
+	{
+		bc->idle_disconnect_id =
+			g_timeout_add_seconds (timeout,
+			                       (GSourceFunc)on_idle_disconnect_timeout,
+			                       bc);
+	}
+}
+
+static void on_bookmark_session_close (InfSession         *session,
+                                       BookmarkConnection *bc);
+
+static void
+untrack_session (BookmarkConnection *bc,
+                 InfSession         *session)
+{
+	g_signal_handlers_disconnect_by_func (session,
+	                                      G_CALLBACK (on_bookmark_session_close),
+	                                      bc);
+
+	bc->sessions = g_slist_remove (bc->sessions, session);
+}
+
+static void
+on_bookmark_session_close (InfSession         *session,
+                           BookmarkConnection *bc)
+{
+	untrack_session (bc, session);
+	schedule_idle_disconnect (bc);
+}
+
+static void
+on_bookmark_subscribe_session (InfcBrowser        *browser,
+                               InfcBrowserIter    *iter,
+                               InfcSessionProxy   *proxy,
+                               BookmarkConnection *bc)
+{
+	InfSession *session;
+
+	session = infc_session_proxy_get_session (proxy);
+
+	/* The chat alone does not keep a connection in use */
+	if (INF_IS_CHAT_SESSION (session))
+	{
+		return;
+	}
+
+	bc->sessions = g_slist_prepend (bc->sessions, session);
+
+	g_signal_connect (session,
+	                  "close",
+	                  G_CALLBACK (on_bookmark_session_close),
+	                  bc);
+
+	stop_idle_disconnect (bc);
+}
+
+static void
+on_bookmark_browser_status_changed (InfcBrowser        *browser,
+                                    GParamSpec         *spec,
+                                    BookmarkConnection *bc)
+{
+	if (infc_browser_get_status (browser) == INFC_BROWSER_DISCONNECTED)
+	{
+		while (bc->sessions)
+		{
+			untrack_session (bc, bc->sessions->data);
+		}
+	}
+
+	schedule_idle_disconnect (bc);
+}
+
+static void
+bookmark_connection_set_browser (BookmarkConnection *bc,
+                                 InfcBrowser        *browser)
+{
+	stop_idle_disconnect (bc);
+
+	while (bc->sessions)
+	{
+		untrack_session (bc, bc->sessions->data);
+	}
+
+	if (bc->browser)
+	{
+		g_signal_handlers_disconnect_by_func (bc->browser,
+		                                      G_CALLBACK (on_bookmark_subscribe_session),
+		                                      bc);
+
+		g_signal_handlers_disconnect_by_func (bc->browser,
+		                                      G_CALLBACK (on_bookmark_browser_status_changed),
+		                                      bc);
+
+		g_object_unref (bc->browser);
+	}
+
+	bc->browser = browser ? g_object_ref (browser) : NULL;
+
+	if (bc->browser)
+	{
+		g_signal_connect (bc->browser,
+		                  "subscribe-session",
+		                  G_CALLBACK (on_bookmark_subscribe_session),
+		                  bc);
+
+		g_signal_connect (bc->browser,
+		                  "notify::status",
+		                  G_CALLBACK (on_bookmark_browser_status_changed),
+		                  bc);
+
+		schedule_idle_disconnect (bc);
+	}
+}
+
+static void on_connector_resolved (GeditCollaborationConnector *connector,
+                                   BookmarkConnection          *bc);
+
+static void on_connector_connected (GeditCollaborationConnector *connector,
+                                    InfTcpConnection            *tcp,
+                                    BookmarkConnection          *bc);
+
+static void on_connector_failed (GeditCollaborationConnector *connector,
+                                 const GError                *error,
+                                 BookmarkConnection          *bc);
+
+static void
+bookmark_connection_free (BookmarkConnection *bc)
+{
+	bookmark_connection_set_browser (bc, NULL);
+
+	g_signal_handlers_disconnect_by_func (bc->connector,
+	                                      G_CALLBACK (on_connector_resolved),
+	                                      bc);
+
+	g_signal_handlers_disconnect_by_func (bc->connector,
+	                                      G_CALLBACK (on_connector_connected),
+	                                      bc);
+
+	g_signal_handlers_disconnect_by_func (bc->connector,
+	                                      G_CALLBACK (on_connector_failed),
+	                                      bc);
+
+	gedit_collaboration_connector_cancel (bc->connector);
+	g_object_unref (bc->connector);
+
+	g_signal_handlers_disconnect_by_func (bc->bookmark,
+	                                      G_CALLBACK (on_bookmark_name_changed),
+	                                      bc);
+
+	g_signal_handlers_disconnect_by_func (gedit_collaboration_bookmark_get_user (bc->bookmark),
+	                                      G_CALLBACK (user_request_password),
+	                                      bc->core);
+
+	g_object_unref (bc->connection);
+	g_object_unref (bc->bookmark);
+
+	g_slice_free (BookmarkConnection, bc);
+}
+
+static InfXmlConnection *
+create_bookmark_connection (GeditCollaborationCore     *core,
+                            GeditCollaborationBookmark *bookmark,
+                            InfTcpConnection           *tcp)
+{
+	InfXmppConnection *connection;
+	GeditCollaborationUser *user;
+
+	user = gedit_collaboration_bookmark_get_user (bookmark);
+	connection = inf_xmpp_connection_new (tcp,
+	                                      INF_XMPP_CONNECTION_CLIENT,
+	                                      NULL,
+	                                      gedit_collaboration_bookmark_get_host (bookmark),
+	                                      INF_XMPP_CONNECTION_SECURITY_BOTH_PREFER_TLS,
+	                                      core->priv->certificate_credentials,
+	                                      gedit_collaboration_user_get_sasl_context (user),
+	                                      "ANONYMOUS PLAIN");
+
+	g_object_set_data (G_OBJECT (connection), BOOKMARK_DATA_KEY, bookmark);
+
+	return INF_XML_CONNECTION (connection);
+}
+
+static void
+bookmark_connection_open (BookmarkConnection *bc)
+{
+	InfXmlConnectionStatus status;
+
+	g_object_get (bc->connection, "status", &status, NULL);
+
+	if (status != INF_XML_CONNECTION_CLOSED)
+	{
+		/* Count this as activity on the connection */
+		schedule_idle_disconnect (bc);
+		return;
+	}
+
+	if (gedit_collaboration_connector_is_running (bc->connector))
+	{
+		return;
+	}
+
+	bc->state = BOOKMARK_STATE_RESOLVING;
+	update_connection_name (bc);
+
+	gedit_collaboration_connector_start (bc->connector);
+}
+
+static void
+on_connector_resolved (GeditCollaborationConnector *connector,
+                       BookmarkConnection          *bc)
+{
+	bc->state = BOOKMARK_STATE_CONNECTING;
+	update_connection_name (bc);
+}
+
+static void
+on_connector_connected (GeditCollaborationConnector *connector,
+                        InfTcpConnection            *tcp,
+                        BookmarkConnection          *bc)
+{
+	InfGtkBrowserStore *store = bc->core->priv->browser_store;
+
+	_gedit_collaboration_bookmark_set_connect_time (bc->bookmark,
+	                                                gedit_collaboration_connector_get_connect_time (connector));
+
+	/* Replace the unconnected connection with one on top of the winning
+	   tcp connection */
+	bookmark_connection_set_browser (bc, NULL);
+	inf_gtk_browser_store_remove_connection (store, bc->connection);
+	g_object_unref (bc->connection);
+
+	bc->connection = create_bookmark_connection (bc->core,
+	                                             bc->bookmark,
+	                                             tcp);
+
+	bc->state = BOOKMARK_STATE_CONNECTED;
+
+	inf_gtk_browser_store_add_connection (store,
+	                                      bc->connection,
+	                                      gedit_collaboration_bookmark_get_name (bc->bookmark));
+}
+
+static void
+on_connector_failed (GeditCollaborationConnector *connector,
+                     const GError                *error,
+                     BookmarkConnection          *bc)
+{
+	g_warning ("%s", error->message);
+
+	if (error->domain == G_RESOLVER_ERROR)
+	{
+		bc->state = BOOKMARK_STATE_RESOLVE_FAILED;
+	}
+	else
+	{
+		bc->state = BOOKMARK_STATE_CONNECT_FAILED;
+	}
+
+	update_connection_name (bc);
+}
+
+static BookmarkConnection *
+bookmark_added (GeditCollaborationCore     *core,
+                GeditCollaborationBookmark *bookmark)
+{
+	BookmarkConnection *bc;
+	InfTcpConnection *tcp;
+	GeditCollaborationUser *user;
+
+	bc = g_slice_new0 (BookmarkConnection);
+	bc->core = core;
+	bc->bookmark = g_object_ref (bookmark);
+	bc->state = BOOKMARK_STATE_IDLE;
+
+	/* Bookmarks are not connected until they are used. Until then
+	   the row is backed by an unconnected placeholder, which is replaced
+	   once one of the resolved addresses wins the connection race */
+	tcp = g_object_new (INF_TYPE_TCP_CONNECTION,
+	                    "io", core->priv->io,
+	                    "remote-port", (guint)gedit_collaboration_bookmark_get_port (bookmark),
+	                    NULL);
+
+	bc->connection = create_bookmark_connection (core, bookmark, tcp);
+	g_object_unref (tcp);
+
+	bc->connector = gedit_collaboration_connector_new (core->priv->io,
+	                                                   gedit_collaboration_bookmark_get_host (bookmark),
+	                                                   gedit_collaboration_bookmark_get_port (bookmark));
+
+	g_signal_connect (bc->connector,
+	                  "resolved",
+	                  G_CALLBACK (on_connector_resolved),
+	                  bc);
+
+	g_signal_connect (bc->connector,
+	                  "connected",
+	                  G_CALLBACK (on_connector_connected),
+	                  bc);
+
+	g_signal_connect (bc->connector,
+	                  "failed",
+	                  G_CALLBACK (on_connector_failed),
+	                  bc);
+
+	user = gedit_collaboration_bookmark_get_user (bookmark);
+
+	g_signal_connect (user,
+	                  "request-password",
+	                  G_CALLBACK (user_request_password),
+	                  core);
+
+	core->priv->bookmark_connections =
+		g_slist_prepend (core->priv->bookmark_connections, bc);
+
+	inf_gtk_browser_store_add_connection (core->priv->browser_store,
+	                                      bc->connection,
+	                                      gedit_collaboration_bookmark_get_name (bookmark));
+
+	update_connection_name (bc);
+
+	g_signal_connect (bookmark,
+	                  "notify::name",
+	                  G_CALLBACK (on_bookmark_name_changed),
+	                  bc);
+
+	return bc;
+}
+
+static void
+on_bookmark_added (GeditCollaborationBookmarks *bookmarks,
+                   GeditCollaborationBookmark  *bookmark,
+                   GeditCollaborationCore      *core)
+{
+	bookmark_added (core, bookmark);
+}
+
+static void
+bookmark_removed (GeditCollaborationCore     *core,
+                  GeditCollaborationBookmark *bookmark,
+                  gboolean                    temporary)
+{
+	GSList *item;
+
+	for (item = core->priv->bookmark_connections; item; item = g_slist_next (item))
+	{
+		BookmarkConnection *bc = item->data;
+
+		if (bc->bookmark == bookmark)
+		{
+			if (bc->temporary != temporary)
+			{
+				break;
+			}
+
+			core->priv->bookmark_connections =
+				g_slist_delete_link (core->priv->bookmark_connections,
+				                     item);
+
+			bookmark_connection_free (bc);
+			break;
+		}
+	}
+}
+
+static void
+on_bookmark_removed (GeditCollaborationBookmarks *bookmarks,
+                     GeditCollaborationBookmark  *bookmark,
+                     GeditCollaborationCore      *core)
+{
+	bookmark_removed (core, bookmark, FALSE);
+}
+
+static void
+init_bookmarks (GeditCollaborationCore *core)
+{
+	GeditCollaborationBookmarks *bookmarks;
+	GList *item;
+
+	bookmarks = gedit_collaboration_bookmarks_get_default ();
+	item = gedit_collaboration_bookmarks_get_bookmarks (bookmarks);
+
+	while (item)
+	{
+		GeditCollaborationBookmark *bookmark = item->data;
+
+		bookmark_added (core, bookmark);
+		item = g_list_next (item);
+	}
+
+	core->priv->added_handler_id =
+		g_signal_connect (bookmarks,
+		                  "added",
+		                  G_CALLBACK (on_bookmark_added),
+		                  core);
+
+	core->priv->removed_handler_id =
+		g_signal_connect (bookmarks,
+		                  "removed",
+		                  G_CALLBACK (on_bookmark_removed),
+		                  core);
+}
+
+#ifdef LIBINFINITY_HAVE_AVAHI
+static void
+init_discovery (GeditCollaborationCore *core)
+{
+	InfDiscoveryAvahi *discovery;
+	GeditCollaborationUser *user;
+
+	user = gedit_collaboration_user_get_default ();
+	discovery = inf_discovery_avahi_new (core->priv->io,
+	                                     core->priv->xmpp_manager,
+	                                     core->priv->certificate_credentials,
+	                                     gedit_collaboration_user_get_sasl_context (user),
+	                                     "ANONYMOUS PLAIN");
+
+	g_signal_connect (user,
+	                 "request-password",
+	                 G_CALLBACK (user_request_password),
+	                 core);
+
+	inf_gtk_browser_store_add_discovery (core->priv->browser_store,
+	                                     INF_DISCOVERY (discovery));
+
+	g_object_unref (discovery);
+}
+#endif
+
+/* Sessions */
+static gboolean
+close_unwanted_session (InfSession *session)
+{
+	if (inf_session_get_status (session) != INF_SESSION_CLOSED)
+	{
+		inf_session_close (session);
+	}
+
+	return FALSE;
+}
+
+static InfSession *
+create_unwanted_session (InfIo                       *io,
+                         InfCommunicationManager     *manager,
+                         InfSessionStatus             status,
+                         InfCommunicationJoinedGroup *sync_group,
+                         InfXmlConnection            *sync_connection)
+{
+	InfTextBuffer *buffer;
+	InfTextSession *session;
+
+	/* The browser needs a session, but it is not shown anywhere. It is
+	   closed (and thereby unsubscribed) once the browser has set it up */
+	buffer = INF_TEXT_BUFFER (inf_text_default_buffer_new ("UTF-8"));
+
+	session = inf_text_session_new (manager,
+	                                buffer,
+	                                io,
+	                                status,
+	                                INF_COMMUNICATION_GROUP (sync_group),
+	                                sync_connection);
+
+	g_object_unref (buffer);
+
+	g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+	                 (GSourceFunc)close_unwanted_session,
+	                 g_object_ref (session),
+	                 (GDestroyNotify)g_object_unref);
+
+	return INF_SESSION (session);
+}
+
+static InfSession *
+create_session_new (InfIo                       *io,
+                    InfCommunicationManager     *manager,
+                    InfSessionStatus             status,
+                    InfCommunicationJoinedGroup *sync_group,
+                    InfXmlConnection            *sync_connection,
+                    gpointer                     user_data)
+{
+	GeditCollaborationCore *core = user_data;
+	GeditCollaborationManager *target = NULL;
+	GQueue *queue;
+
+	/* Subscriptions are answered in the order they were requested on a
+	   connection, so the first manager waiting gets the session */
+	queue = g_hash_table_lookup (core->priv->pending_subscriptions,
+	                             sync_connection);
+
+	if (queue != NULL)
+	{
+		target = g_queue_pop_head (queue);
+
+		if (g_queue_is_empty (queue))
+		{
+			g_hash_table_remove (core->priv->pending_subscriptions,
+			                     sync_connection);
+		}
+	}
+
+	/* Not requested by any window, or the window that asked for it was
+	   closed in the meantime */
+	if (target == NULL)
+	{
+		return create_unwanted_session (io,
+		                                manager,
+		                                status,
+		                                sync_group,
+		                                sync_connection);
+	}
+
+	return gedit_collaboration_manager_create_session (target,
+	                                                   io,
+	                                                   manager,
+	                                                   status,
+	                                                   sync_group,
+	                                                   sync_connection);
+}
+
+static void
+on_set_browser (InfGtkBrowserModel     *model,
+                GtkTreePath            *path,
+                GtkTreeIter            *iter,
+                InfcBrowser            *browser,
+                GeditCollaborationCore *core)
+{
+	BookmarkConnection *bc;
+
+	if (browser == NULL)
+	{
+		return;
+	}
+
+	infc_browser_add_plugin (browser, &core->priv->note_plugin);
+
+	g_signal_connect (browser,
+	                  "notify::status",
+	                  G_CALLBACK (on_browser_status_changed),
+	                  core);
+
+	if (infc_browser_get_status (browser) == INFC_BROWSER_CONNECTED)
+	{
+		add_listing_cache (core, browser);
+		add_path_index_browser (core, browser);
+	}
+
+	bc = find_bookmark_connection (core,
+	                               infc_browser_get_connection (browser));
+
+	if (bc != NULL)
+	{
+		bookmark_connection_set_browser (bc, browser);
+	}
+}
+
+static void
+gedit_collaboration_core_constructed (GObject *object)
+{
+	GeditCollaborationCore *core = GEDIT_COLLABORATION_CORE (object);
+
+	core->priv->io = INF_IO (inf_gtk_io_new ());
+	core->priv->communication_manager = inf_communication_manager_new ();
+	core->priv->xmpp_manager = inf_xmpp_manager_new ();
+	core->priv->certificate_credentials = inf_certificate_credentials_new ();
+
+	core->priv->browser_store = inf_gtk_browser_store_new (core->priv->io,
+	                                                       core->priv->communication_manager);
+
+	core->priv->collation_cache = gedit_collaboration_collation_cache_new ();
+
+	core->priv->path_index = gedit_collaboration_path_index_new ();
+
+	g_signal_connect_after (core->priv->browser_store,
+	                        "set-browser",
+	                        G_CALLBACK (on_set_browser),
+	                        core);
+
+#ifdef LIBINFINITY_HAVE_AVAHI
+	init_discovery (core);
+#endif
+
+	init_bookmarks (core);
+}
+
+static GObject *
+gedit_collaboration_core_constructor (GType                  type,
+                                      guint                  n_parameters,
+                                      GObjectConstructParam *parameters)
+{
+	GObject *ret;
+
+	if (core_default != NULL)
+	{
+		return g_object_ref (core_default);
+	}
+
+	ret = G_OBJECT_CLASS (gedit_collaboration_core_parent_class)->constructor (type,
+	                                                                           n_parameters,
+	                                                                           parameters);
+
+	core_default = GEDIT_COLLABORATION_CORE (ret);
+	g_object_add_weak_pointer (ret, (gpointer *)&core_default);
+
+	return ret;
+}
+
+static void
+gedit_collaboration_core_class_init (GeditCollaborationCoreClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_core_dispose;
+	object_class->finalize = gedit_collaboration_core_finalize;
+	object_class->constructor = gedit_collaboration_core_constructor;
+	object_class->constructed = gedit_collaboration_core_constructed;
+
+	object_class->set_property = gedit_collaboration_core_set_property;
+	object_class->get_property = gedit_collaboration_core_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_DATA_DIR,
+	                                 g_param_spec_string ("data-dir",
+	                                                      "Data Dir",
+	                                                      "Data Dir",
+	                                                      NULL,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	signals[CHAT_ADDED] =
+		g_signal_new ("chat-added",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL,
+		              NULL,
+		              g_cclosure_marshal_VOID__OBJECT,
+		              G_TYPE_NONE,
+		              1,
+		              INFC_TYPE_BROWSER);
+
+	signals[CHAT_JOINED] =
+		g_signal_new ("chat-joined",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL,
+		              NULL,
+		              g_cclosure_marshal_VOID__OBJECT,
+		              G_TYPE_NONE,
+		              1,
+		              INFC_TYPE_BROWSER);
+
+	signals[CHAT_REMOVED] =
+		g_signal_new ("chat-removed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL,
+		              NULL,
+		              g_cclosure_marshal_VOID__OBJECT,
+		              G_TYPE_NONE,
+		              1,
+		              INFC_TYPE_BROWSER);
+
+	signals[CHAT_UNREAD_CHANGED] =
+		g_signal_new ("chat-unread-changed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL,
+		              NULL,
+		              g_cclosure_marshal_VOID__OBJECT,
+		              G_TYPE_NONE,
+		              1,
+		              INFC_TYPE_BROWSER);
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationCorePrivate));
+}
+
+static void
+gedit_collaboration_core_class_finalize (GeditCollaborationCoreClass *klass)
+{
+}
+
+static void
+gedit_collaboration_core_init (GeditCollaborationCore *self)
+{
+	self->priv = GEDIT_COLLABORATION_CORE_GET_PRIVATE (self);
+
+	self->priv->settings = g_settings_new (COLLABORATION_SETTINGS);
+
+	self->priv->note_plugin.user_data = self;
+	self->priv->note_plugin.note_type = "InfText";
+	self->priv->note_plugin.session_new = create_session_new;
+
+	self->priv->pending_subscriptions =
+		g_hash_table_new_full (g_direct_hash,
+		                       g_direct_equal,
+		                       NULL,
+		                       (GDestroyNotify)g_queue_free);
+
+	self->priv->chats =
+		g_hash_table_new_full (g_direct_hash,
+		                       g_direct_equal,
+		                       NULL,
+		                       (GDestroyNotify)chat_data_free);
+
+	self->priv->listing_caches =
+		g_hash_table_new_full (g_direct_hash,
+		                       g_direct_equal,
+		                       NULL,
+		                       (GDestroyNotify)g_object_unref);
+}
+
+GeditCollaborationCore *
+gedit_collaboration_core_new (const gchar *data_dir)
+{
+	return g_object_new (GEDIT_COLLABORATION_TYPE_CORE,
+	                     "data-dir", data_dir,
+	                     NULL);
+}
+
+GeditCollaborationCore *
+gedit_collaboration_core_get_default ()
+{
+	g_return_val_if_fail (core_default != NULL, NULL);
+	return core_default;
+}
+
+InfIo *
+gedit_collaboration_core_get_io (GeditCollaborationCore *core)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	return core->priv->io;
+}
+
+InfCertificateCredentials *
+gedit_collaboration_core_get_certificate_credentials (GeditCollaborationCore *core)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	return core->priv->certificate_credentials;
+}
+
+InfGtkBrowserStore *
+gedit_collaboration_core_get_browser_store (GeditCollaborationCore *core)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	return core->priv->browser_store;
+}
+
+GeditCollaborationCollationCache *
+gedit_collaboration_core_get_collation_cache (GeditCollaborationCore *core)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	return core->priv->collation_cache;
+}
+
+GeditCollaborationPathIndex *
+gedit_collaboration_core_get_path_index (GeditCollaborationCore *core)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	return core->priv->path_index;
+}
+
+GeditCollaborationListingCache *
+gedit_collaboration_core_get_listing_cache (GeditCollaborationCore *core,
+                                            InfcBrowser            *browser)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	return g_hash_table_lookup (core->priv->listing_caches, browser);
+}
+
+GSettings *
+gedit_collaboration_core_get_settings (GeditCollaborationCore *core)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	return core->priv->settings;
+}
+
+InfcNotePlugin *
+gedit_collaboration_core_get_note_plugin (GeditCollaborationCore *core)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	return &(core->priv->note_plugin);
+}
+
+void
+gedit_collaboration_core_open_connection (GeditCollaborationCore *core,
+                                          InfXmlConnection       *connection)
+{
+	BookmarkConnection *bc;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+	g_return_if_fail (INF_IS_XML_CONNECTION (connection));
+
+	bc = find_bookmark_connection (core, connection);
+
+	if (bc != NULL)
+	{
+		bookmark_connection_open (bc);
+	}
+}
+
+void
+gedit_collaboration_core_open_bookmark (GeditCollaborationCore     *core,
+                                        GeditCollaborationBookmark *bookmark)
+{
+	GSList *item;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+	g_return_if_fail (GEDIT_COLLABORATION_IS_BOOKMARK (bookmark));
+
+	for (item = core->priv->bookmark_connections; item; item = g_slist_next (item))
+	{
+		BookmarkConnection *bc = item->data;
+
+		if (bc->bookmark == bookmark)
+		{
+			bookmark_connection_open (bc);
+			break;
+		}
+	}
+}
+
+GeditCollaborationBookmark *
+gedit_collaboration_core_find_bookmark (GeditCollaborationCore *core,
+                                        const gchar            *host,
+                                        gint                    port)
+{
+	GSList *item;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	g_return_val_if_fail (host != NULL, NULL);
+
+	for (item = core->priv->bookmark_connections; item; item = g_slist_next (item))
+	{
+		BookmarkConnection *bc = item->data;
+
+		if (g_ascii_strcasecmp (gedit_collaboration_bookmark_get_host (bc->bookmark),
+		                        host) == 0 &&
+		    gedit_collaboration_bookmark_get_port (bc->bookmark) == port)
+		{
+			return bc->bookmark;
+		}
+	}
+
+	return NULL;
+}
+
+/* Adds a connection for a bookmark which is not in the saved bookmarks, it
+   stays in the browser until it is removed or the plugin is deactivated */
+void
+gedit_collaboration_core_add_temporary_bookmark (GeditCollaborationCore     *core,
+                                                 GeditCollaborationBookmark *bookmark)
+{
+	BookmarkConnection *bc;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+	g_return_if_fail (GEDIT_COLLABORATION_IS_BOOKMARK (bookmark));
+
+	bc = bookmark_added (core, bookmark);
+	bc->temporary = TRUE;
+}
+
+void
+gedit_collaboration_core_remove_temporary_bookmark (GeditCollaborationCore     *core,
+                                                    GeditCollaborationBookmark *bookmark)
+{
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+	g_return_if_fail (GEDIT_COLLABORATION_IS_BOOKMARK (bookmark));
+
+	bookmark_removed (core, bookmark, TRUE);
+}
+
+void
+gedit_collaboration_core_add_manager (GeditCollaborationCore    *core,
+                                      GeditCollaborationManager *manager)
+{
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+	g_return_if_fail (GEDIT_COLLABORATION_IS_MANAGER (manager));
+
+	core->priv->managers = g_slist_append (core->priv->managers, manager);
+}
+
+static void
+forget_pending_manager (gpointer                   key,
+                        GQueue                    *queue,
+                        GeditCollaborationManager *manager)
+{
+	GList *item;
+
+	for (item = queue->head; item; item = g_list_next (item))
+	{
+		if (item->data == manager)
+		{
+			item->data = NULL;
+		}
+	}
+}
+
+void
+gedit_collaboration_core_remove_manager (GeditCollaborationCore    *core,
+                                         GeditCollaborationManager *manager)
+{
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+
+	core->priv->managers = g_slist_remove (core->priv->managers, manager);
+
+	/* Sessions still on their way for this window are answered in order
+	   with the others, but are closed once they arrive */
+	g_hash_table_foreach (core->priv->pending_subscriptions,
+	                      (GHFunc)forget_pending_manager,
+	                      manager);
+}
+
+GSList *
+gedit_collaboration_core_get_managers (GeditCollaborationCore *core)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+	return core->priv->managers;
+}
+
+void
+gedit_collaboration_core_push_subscription (GeditCollaborationCore    *core,
+                                            InfXmlConnection          *connection,
+                                            GeditCollaborationManager *manager)
+{
+	GQueue *queue;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+	g_return_if_fail (INF_IS_XML_CONNECTION (connection));
+
+	queue = g_hash_table_lookup (core->priv->pending_subscriptions,
+	                             connection);
+
+	if (queue == NULL)
+	{
+		queue = g_queue_new ();
+		g_hash_table_insert (core->priv->pending_subscriptions,
+		                     connection,
+		                     queue);
+	}
+
+	g_queue_push_tail (queue, manager);
+}
+
+void
+gedit_collaboration_core_cancel_subscription (GeditCollaborationCore    *core,
+                                              InfXmlConnection          *connection,
+                                              GeditCollaborationManager *manager)
+{
+	GQueue *queue;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+
+	queue = g_hash_table_lookup (core->priv->pending_subscriptions,
+	                             connection);
+
+	if (queue == NULL)
+	{
+		return;
+	}
+
+	g_queue_remove (queue, manager);
+
+	if (g_queue_is_empty (queue))
+	{
+		g_hash_table_remove (core->priv->pending_subscriptions,
+		                     connection);
+	}
+}
+
+void
+gedit_collaboration_core_request_chat (GeditCollaborationCore *core,
+                                       InfcBrowser            *browser)
+{
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+	g_return_if_fail (INFC_IS_BROWSER (browser));
+
+	if (infc_browser_get_status (browser) != INFC_BROWSER_CONNECTED)
+	{
+		return;
+	}
+
+	request_chat (core, browser);
+}
+
+InfChatSession *
+gedit_collaboration_core_get_chat_session (GeditCollaborationCore *core,
+                                           InfcBrowser            *browser)
+{
+	ChatData *cdata;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+
+	cdata = g_hash_table_lookup (core->priv->chats, browser);
+
+	if (cdata == NULL || !cdata->synchronized)
+	{
+		return NULL;
+	}
+
+	return INF_CHAT_SESSION (infc_session_proxy_get_session (cdata->proxy));
+}
+
+InfUser *
+gedit_collaboration_core_get_chat_user (GeditCollaborationCore *core,
+                                        InfcBrowser            *browser)
+{
+	ChatData *cdata;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+
+	cdata = g_hash_table_lookup (core->priv->chats, browser);
+
+	return cdata != NULL ? cdata->user : NULL;
+}
+
+GeditCollaborationChatLog *
+gedit_collaboration_core_get_chat_log (GeditCollaborationCore *core,
+                                       InfcBrowser            *browser)
+{
+	ChatData *cdata;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), NULL);
+
+	cdata = g_hash_table_lookup (core->priv->chats, browser);
+
+	return cdata != NULL ? cdata->log : NULL;
+}
+
+/* Messages logged before this offset are from earlier subscriptions */
+goffset
+gedit_collaboration_core_get_chat_log_start (GeditCollaborationCore *core,
+                                             InfcBrowser            *browser)
+{
+	ChatData *cdata;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), 0);
+
+	cdata = g_hash_table_lookup (core->priv->chats, browser);
+
+	return cdata != NULL ? cdata->log_start : 0;
+}
+
+/* Infinote servers only send chat messages to members of the chat
+   session, so messages are counted from the moment the chat of the
+   browser is subscribed (the first time its panel is shown). Before that
+   the count is always 0 */
+guint
+gedit_collaboration_core_get_chat_unread (GeditCollaborationCore *core,
+                                          InfcBrowser            *browser)
+{
+	ChatData *cdata;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_CORE (core), 0);
+
+	cdata = g_hash_table_lookup (core->priv->chats, browser);
+
+	return cdata != NULL ? cdata->unread : 0;
+}
+
+void
+gedit_collaboration_core_mark_chat_read (GeditCollaborationCore *core,
+                                         InfcBrowser            *browser)
+{
+	ChatData *cdata;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_CORE (core));
+
+	cdata = g_hash_table_lookup (core->priv->chats, browser);
+
+	if (cdata != NULL && cdata->unread != 0)
+	{
+		cdata->unread = 0;
+		g_signal_emit (core, signals[CHAT_UNREAD_CHANGED], 0, browser);
+	}
+}
+
+void
+_gedit_collaboration_core_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_core_register_type (type_module);
+}
@@ -0,0 +1,108 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_CORE_H__
+#define __GEDIT_COLLABORATION_CORE_H__
+
+#include <glib-object.h>
+#include <libinfgtk/inf-gtk-browser-store.h>
+#include <libinfinity/common/inf-io.h>
+#include <libinfinity/common/inf-chat-session.h>
+#include <libinfinity/common/inf-certificate-credentials.h>
+#include <libinfinity/client/infc-browser.h>
+#include "gedit-collaboration-manager.h"
+#include "gedit-collaboration-chat-log.h"
+#include "gedit-collaboration-bookmark.h"
+#include "gedit-collaboration-collation-cache.h"
+#include "gedit-collaboration-listing-cache.h"
+#include "gedit-collaboration-path-index.h"
+
+#define BOOKMARK_DATA_KEY "GeditCollaborationBookmarkDataKey"
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_CORE			(gedit_collaboration_core_get_type ())
+#define GEDIT_COLLABORATION_CORE(obj)			(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_CORE, GeditCollaborationCore))
+#define GEDIT_COLLABORATION_CORE_CONST(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_CORE, GeditCollaborationCore const))
+#define GEDIT_COLLABORATION_CORE_CLASS(klass)		(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_CORE, GeditCollaborationCoreClass))
+#define GEDIT_COLLABORATION_IS_CORE(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_CORE))
+#define GEDIT_COLLABORATION_IS_CORE_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_CORE))
+#define GEDIT_COLLABORATION_CORE_GET_CLASS(obj)		(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_CORE, GeditCollaborationCoreClass))
+
+typedef struct _GeditCollaborationCore		GeditCollaborationCore;
+typedef struct _GeditCollaborationCoreClass	GeditCollaborationCoreClass;
+typedef struct _GeditCollaborationCorePrivate	GeditCollaborationCorePrivate;
+
+struct _GeditCollaborationCore
+{
+	GObject parent;
+
+	GeditCollaborationCorePrivate *priv;
+};
+
+struct _GeditCollaborationCoreClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_core_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_core_register_type (GTypeModule *type_module);
+
+GeditCollaborationCore *gedit_collaboration_core_new (const gchar *data_dir);
+GeditCollaborationCore *gedit_collaboration_core_get_default (void);
+
+InfIo *gedit_collaboration_core_get_io (GeditCollaborationCore *core);
+InfCertificateCredentials *gedit_collaboration_core_get_certificate_credentials (GeditCollaborationCore *core);
+InfGtkBrowserStore *gedit_collaboration_core_get_browser_store (GeditCollaborationCore *core);
+GeditCollaborationCollationCache *gedit_collaboration_core_get_collation_cache (GeditCollaborationCore *core);
+GeditCollaborationPathIndex *gedit_collaboration_core_get_path_index (GeditCollaborationCore *core);
+GeditCollaborationListingCache *gedit_collaboration_core_get_listing_cache (GeditCollaborationCore *core,
+                                                                            InfcBrowser            *browser);
+InfcNotePlugin *gedit_collaboration_core_get_note_plugin (GeditCollaborationCore *core);
+GSettings *gedit_collaboration_core_get_settings (GeditCollaborationCore *core);
+
+void gedit_collaboration_core_open_connection (GeditCollaborationCore *core,
+                                               InfXmlConnection       *connection);
+void gedit_collaboration_core_open_bookmark (GeditCollaborationCore     *core,
+                                             GeditCollaborationBookmark *bookmark);
+
+GeditCollaborationBookmark *gedit_collaboration_core_find_bookmark (GeditCollaborationCore *core,
+                                                                    const gchar            *host,
+                                                                    gint                    port);
+void gedit_collaboration_core_add_temporary_bookmark (GeditCollaborationCore     *core,
+                                                      GeditCollaborationBookmark *bookmark);
+void gedit_collaboration_core_remove_temporary_bookmark (GeditCollaborationCore     *core,
+                                                         GeditCollaborationBookmark *bookmark);
+
+void gedit_collaboration_core_add_manager (GeditCollaborationCore    *core,
+                                           GeditCollaborationManager *manager);
+void gedit_collaboration_core_remove_manager (GeditCollaborationCore    *core,
+                                              GeditCollaborationManager *manager);
+GSList *gedit_collaboration_core_get_managers (GeditCollaborationCore *core);
+
+void gedit_collaboration_core_push_subscription (GeditCollaborationCore    *core,
+                                                 InfXmlConnection          *connection,
+                                                 GeditCollaborationManager *manager);
+void gedit_collaboration_core_cancel_subscription (GeditCollaborationCore    *core,
+                                                   InfXmlConnection          *connection,
+                                                   GeditCollaborationManager *manager);
+
+void gedit_collaboration_core_request_chat (GeditCollaborationCore *core,
+                                            InfcBrowser            *browser);
+InfChatSession *gedit_collaboration_core_get_chat_session (GeditCollaborationCore *core,
+                                                           InfcBrowser            *browser);
+InfUser *gedit_collaboration_core_get_chat_user (GeditCollaborationCore *core,
+                                                 InfcBrowser            *browser);
+
+GeditCollaborationChatLog *gedit_collaboration_core_get_chat_log (GeditCollaborationCore *core,
+                                                                 InfcBrowser            *browser);
+goffset gedit_collaboration_core_get_chat_log_start (GeditCollaborationCore *core,
+                                                     InfcBrowser            *browser);
+
+guint gedit_collaboration_core_get_chat_unread (GeditCollaborationCore *core,
+                                                InfcBrowser            *browser);
+void gedit_collaboration_core_mark_chat_read (GeditCollaborationCore *core,
+                                              InfcBrowser            *browser);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_CORE_H__ */
@@ -239,6 +239,20 @@ gedit_collaboration_document_message_update (GeditCollaborationDocumentMessage *
 	                               fraction);
 }
 
+void
+gedit_collaboration_document_message_set_progress_text (GeditCollaborationDocumentMessage *document_message,
+                                                        const gchar                       *text)
+{
+	g_return_if_fail (GEDIT_COLLABORATION_IS_DOCUMENT_MESSAGE (document_message));
+	g_return_if_fail (document_message->priv->progress != NULL);
+
+	gtk_progress_bar_set_text (GTK_PROGRESS_BAR (document_message->priv->progress),
+	                           text);
+
+	gtk_progress_bar_set_show_text (GTK_PROGRESS_BAR (document_message->priv->progress),
+	                                text != NULL);
+}
+
 void
 _gedit_collaboration_document_message_register_type (GTypeModule *type_module)
 {
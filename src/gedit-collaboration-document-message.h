@@ -43,6 +43,9 @@ GtkWidget *gedit_collaboration_document_message_new_progress (const gchar *prima
 void gedit_collaboration_document_message_update (GeditCollaborationDocumentMessage *document_message,
                                                   gdouble                            fraction);
 
+void gedit_collaboration_document_message_set_progress_text (GeditCollaborationDocumentMessage *document_message,
+                                                             const gchar                       *text);
+
 gchar *gedit_collaboration_document_message_error_string (const GError *error);
 
 G_END_DECLS
@@ -5,24 +5,54 @@
 
 #define GEDIT_COLLABORATION_HUE_RENDERER_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_TYPE_COLLABORATION_HUE_RENDERER, GeditCollaborationHueRendererPrivate))
 
+/* Hues are cached with this precision, and the cache is cleared
+   when it grows beyond the maximum number of patterns */
+#define HUE_CACHE_STEPS 1000
+#define HUE_CACHE_MAX_SIZE 512
+
 struct _GeditCollaborationHueRendererPrivate
 {
 	gdouble hue;
+	gboolean flat;
+
+	/* Hue and height -> cairo_pattern_t, for the style and state
+	   the colors were computed for */
+	GHashTable *patterns;
+	GtkStyle *style;
+	GtkStateType state;
 };
 
 enum
 {
 	PROP_0,
-	PROP_HUE
+	PROP_HUE,
+	PROP_FLAT
 };
 
 G_DEFINE_DYNAMIC_TYPE (GeditCollaborationHueRenderer,
                        gedit_collaboration_hue_renderer,
                        GTK_TYPE_CELL_RENDERER)
 
+static void
+clear_patterns (GeditCollaborationHueRenderer *renderer)
+{
+	g_hash_table_remove_all (renderer->priv->patterns);
+
+	if (renderer->priv->style)
+	{
+		g_object_unref (renderer->priv->style);
+		renderer->priv->style = NULL;
+	}
+}
+
 static void
 gedit_collaboration_hue_renderer_finalize (GObject *object)
 {
+	GeditCollaborationHueRenderer *renderer = GEDIT_COLLABORATION_HUE_RENDERER (object);
+
+	clear_patterns (renderer);
+	g_hash_table_destroy (renderer->priv->patterns);
+
 	G_OBJECT_CLASS (gedit_collaboration_hue_renderer_parent_class)->finalize (object);
 }
 
@@ -39,6 +69,9 @@ gedit_collaboration_hue_renderer_set_property (GObject      *object,
 		case PROP_HUE:
 			self->priv->hue = g_value_get_double (value);
 		break;
+		case PROP_FLAT:
+			self->priv->flat = g_value_get_boolean (value);
+		break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -58,6 +91,9 @@ gedit_collaboration_hue_renderer_get_property (GObject    *object,
 		case PROP_HUE:
 			g_value_set_double (value, self->priv->hue);
 		break;
+		case PROP_FLAT:
+			g_value_set_boolean (value, self->priv->flat);
+		break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -89,22 +125,24 @@ gedit_collaboration_hue_renderer_get_size (GtkCellRenderer    *cell,
 	}
 }
 
-static void
-set_source_color_from_hue (GeditCollaborationHueRenderer *renderer,
-                           GtkWidget                     *widget,
-                           cairo_t                       *ctx,
-                           gdouble                        y,
-                           gdouble                        height)
+static cairo_pattern_t *
+create_pattern (GeditCollaborationHueRenderer *renderer,
+                GtkWidget                     *widget,
+                gdouble                        height)
 {
 	gdouble s, v;
 	gdouble r, g, b;
 	cairo_pattern_t *pattern;
 
 	gedit_collaboration_get_sv (widget, &s, &v);
+	gtk_hsv_to_rgb (renderer->priv->hue, s, v, &r, &g, &b);
 
-	pattern = cairo_pattern_create_linear (0, y, 0, y + height);
+	if (renderer->priv->flat)
+	{
+		return cairo_pattern_create_rgb (r, g, b);
+	}
 
-	gtk_hsv_to_rgb (renderer->priv->hue, s, v, &r, &g, &b);
+	pattern = cairo_pattern_create_linear (0, 0, 0, height);
 	cairo_pattern_add_color_stop_rgb (pattern, 0, r, g, b);
 
 	v *= v < 0.5 ? 1.2 : 0.8;
@@ -112,8 +150,53 @@ set_source_color_from_hue (GeditCollaborationHueRenderer *renderer,
 	gtk_hsv_to_rgb (renderer->priv->hue, s, v, &r, &g, &b);
 	cairo_pattern_add_color_stop_rgb (pattern, 1, r, g, b);
 
-	cairo_set_source (ctx, pattern);
-	cairo_pattern_destroy (pattern);
+	return pattern;
+}
+
+static cairo_pattern_t *
+get_pattern (GeditCollaborationHueRenderer *renderer,
+             GtkWidget                     *widget,
+             gdouble                        height)
+{
+	GtkStyle *style;
+	GtkStateType state;
+	cairo_pattern_t *pattern;
+	gpointer key;
+	guint hue;
+	guint size;
+
+	style = gtk_widget_get_style (widget);
+	state = gtk_widget_get_state (widget);
+
+	/* The colors are derived from the style, so they are computed
+	   again when it changes */
+	if (style != renderer->priv->style || state != renderer->priv->state)
+	{
+		clear_patterns (renderer);
+
+		renderer->priv->style = g_object_ref (style);
+		renderer->priv->state = state;
+	}
+
+	/* A flat fill does not depend on the height */
+	hue = (guint)(renderer->priv->hue * HUE_CACHE_STEPS + 0.5);
+	size = renderer->priv->flat ? 0 : (guint)height + 1;
+
+	key = GUINT_TO_POINTER ((hue << 16) | (size & 0xffff));
+	pattern = g_hash_table_lookup (renderer->priv->patterns, key);
+
+	if (pattern == NULL)
+	{
+		if (g_hash_table_size (renderer->priv->patterns) >= HUE_CACHE_MAX_SIZE)
+		{
+			g_hash_table_remove_all (renderer->priv->patterns);
+		}
+
+		pattern = create_pattern (renderer, widget, height);
+		g_hash_table_insert (renderer->priv->patterns, key, pattern);
+	}
+
+	return pattern;
 }
 
 static void
@@ -144,17 +227,20 @@ gedit_collaboration_hue_renderer_render (GtkCellRenderer      *cell,
 	width = cell_area->width - 2 * xpad - 1;
 	height = cell_area->height - 2 * ypad - 1;
 
-	cairo_rectangle (ctx, x, y, width, height);
+	/* Cached patterns start at the origin */
+	cairo_save (ctx);
+	cairo_translate (ctx, x, y);
 
-	set_source_color_from_hue (GEDIT_COLLABORATION_HUE_RENDERER (cell),
-	                           widget,
-	                           ctx,
-	                           y,
-	                           height);
+	cairo_rectangle (ctx, 0, 0, width, height);
 
-	cairo_set_line_width (ctx, 1);
+	cairo_set_source (ctx, get_pattern (GEDIT_COLLABORATION_HUE_RENDERER (cell),
+	                                    widget,
+	                                    height));
 
 	cairo_fill_preserve (ctx);
+	cairo_restore (ctx);
+
+	cairo_set_line_width (ctx, 1);
 
 	gdk_cairo_set_source_color (ctx, &style->fg[gtk_widget_get_state (widget)]);
 	cairo_stroke (ctx);
@@ -184,6 +270,14 @@ gedit_collaboration_hue_renderer_class_init (GeditCollaborationHueRendererClass
 	                                                      0.0,
 	                                                      G_PARAM_READWRITE));
 
+	g_object_class_install_property (object_class,
+	                                 PROP_FLAT,
+	                                 g_param_spec_boolean ("flat",
+	                                                       "Flat",
+	                                                       "Fill with a single color instead of a gradient",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+
 	g_type_class_add_private (object_class, sizeof(GeditCollaborationHueRendererPrivate));
 }
 
@@ -196,6 +290,11 @@ static void
 gedit_collaboration_hue_renderer_init (GeditCollaborationHueRenderer *self)
 {
 	self->priv = GEDIT_COLLABORATION_HUE_RENDERER_GET_PRIVATE (self);
+
+	self->priv->patterns = g_hash_table_new_full (g_direct_hash,
+	                                              g_direct_equal,
+	                                              NULL,
+	                                              (GDestroyNotify)cairo_pattern_destroy);
 }
 
 GtkCellRenderer *
@@ -0,0 +1,430 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-listing-cache.h"
+
+#include <string.h>
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#define GEDIT_COLLABORATION_LISTING_CACHE_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_LISTING_CACHE, GeditCollaborationListingCachePrivate))
+
+/* Changes are written out together, at most this often */
+#define SAVE_TIMEOUT 5
+
+struct _GeditCollaborationListingCachePrivate
+{
+	InfcBrowser *browser;
+	gchar *filename;
+
+	/* Paths of the directories expanded in the browser view, those are
+	   explored again right away on the next connect */
+	GHashTable *expanded;
+
+	guint save_id;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_BROWSER,
+	PROP_FILENAME
+};
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationListingCache,
+                       gedit_collaboration_listing_cache,
+                       G_TYPE_OBJECT)
+
+static void
+save_expanded (const gchar *path,
+               gpointer     value,
+               xmlNodePtr   root)
+{
+	xmlNodePtr expanded;
+
+	expanded = xmlNewChild (root, NULL, (xmlChar *)"expanded", NULL);
+	xmlSetProp (expanded, (xmlChar *)"path", (xmlChar *)path);
+}
+
+static void
+save_cache (GeditCollaborationListingCache *cache)
+{
+	xmlDocPtr doc;
+	xmlNodePtr root;
+	xmlChar *mem;
+	int size;
+	gchar *dirn;
+
+	doc = xmlNewDoc ((xmlChar *)"1.0");
+	root = xmlNewDocNode (doc, NULL, (xmlChar *)"infinote-listing", NULL);
+
+	xmlDocSetRootElement (doc, root);
+
+	g_hash_table_foreach (cache->priv->expanded,
+	                      (GHFunc)save_expanded,
+	                      root);
+
+	xmlDocDumpFormatMemoryEnc (doc,
+	                           &mem,
+	                           &size,
+	                           xmlGetCharEncodingName (XML_CHAR_ENCODING_UTF8),
+	                           1);
+
+	dirn = g_path_get_dirname (cache->priv->filename);
+	g_mkdir_with_parents (dirn, 0755);
+	g_free (dirn);
+
+	g_file_set_contents (cache->priv->filename,
+	                     (gchar const *)mem,
+	                     size,
+	                     NULL);
+
+	xmlFree (mem);
+	xmlFreeDoc (doc);
+}
+
+static gboolean
+cache_timeout_save (GeditCollaborationListingCache *cache)
+{
+	cache->priv->save_id = 0;
+	save_cache (cache);
+
+	return FALSE;
+}
+
+static void
+schedule_save (GeditCollaborationListingCache *cache)
+{
+	if (cache->priv->save_id == 0)
+	{
+		cache->priv->save_id = g_timeout_add_seconds (SAVE_TIMEOUT,
+		                                              (GSourceFunc)cache_timeout_save,
+		                                              cache);
+	}
+}
+
+static void
+load_cache (GeditCollaborationListingCache *cache)
+{
+	xmlDocPtr doc;
+	xmlNodePtr root;
+	xmlNodePtr node;
+
+	doc = xmlReadFile (cache->priv->filename, NULL, XML_PARSE_NOWARNING);
+
+	if (!doc)
+	{
+		return;
+	}
+
+	root = xmlDocGetRootElement (doc);
+
+	for (node = root ? root->children : NULL; node; node = node->next)
+	{
+		xmlChar *path;
+
+		if (node->type != XML_ELEMENT_NODE ||
+		    !xmlStrEqual (node->name, (xmlChar *)"expanded"))
+		{
+			continue;
+		}
+
+		path = xmlGetProp (node, (xmlChar *)"path");
+
+		if (path != NULL)
+		{
+			g_hash_table_insert (cache->priv->expanded,
+			                     g_strdup ((gchar *)path),
+			                     GINT_TO_POINTER (TRUE));
+		}
+
+		xmlFree (path);
+	}
+
+	xmlFreeDoc (doc);
+}
+
+static void
+prefetch (GeditCollaborationListingCache *cache,
+          InfcBrowserIter                *iter)
+{
+	gchar *path;
+
+	if (infc_browser_iter_get_explored (cache->priv->browser, iter) ||
+	    infc_browser_iter_get_explore_request (cache->priv->browser, iter) != NULL)
+	{
+		return;
+	}
+
+	/* Only directories that were expanded before, the others were
+	   never looked at */
+	path = infc_browser_iter_get_path (cache->priv->browser, iter);
+
+	if (g_hash_table_lookup (cache->priv->expanded, path) != NULL)
+	{
+		infc_browser_iter_explore (cache->priv->browser, iter);
+	}
+
+	g_free (path);
+}
+
+static void
+remove_paths_below (GHashTable  *paths,
+                    const gchar *path)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gchar *prefix;
+
+	prefix = g_str_has_suffix (path, "/") ? g_strdup (path) : g_strconcat (path, "/", NULL);
+	g_hash_table_iter_init (&iter, paths);
+
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+	{
+		if (strcmp (key, path) == 0 || g_str_has_prefix (key, prefix))
+		{
+			g_hash_table_iter_remove (&iter);
+		}
+	}
+
+	g_free (prefix);
+}
+
+static void
+on_node_added (InfcBrowser                    *browser,
+               InfcBrowserIter                *iter,
+               GeditCollaborationListingCache *cache)
+{
+	if (infc_browser_iter_is_subdirectory (browser, iter))
+	{
+		prefetch (cache, iter);
+	}
+}
+
+static void
+on_node_removed (InfcBrowser                    *browser,
+                 InfcBrowserIter                *iter,
+                 GeditCollaborationListingCache *cache)
+{
+	gchar *path;
+	guint size;
+
+	if (!infc_browser_iter_is_subdirectory (browser, iter))
+	{
+		return;
+	}
+
+	path = infc_browser_iter_get_path (browser, iter);
+	size = g_hash_table_size (cache->priv->expanded);
+
+	remove_paths_below (cache->priv->expanded, path);
+
+	if (g_hash_table_size (cache->priv->expanded) != size)
+	{
+		schedule_save (cache);
+	}
+
+	g_free (path);
+}
+
+static void
+gedit_collaboration_listing_cache_dispose (GObject *object)
+{
+	GeditCollaborationListingCache *cache = GEDIT_COLLABORATION_LISTING_CACHE (object);
+
+	if (cache->priv->save_id)
+	{
+		g_source_remove (cache->priv->save_id);
+		cache->priv->save_id = 0;
+
+		save_cache (cache);
+	}
+
+	if (cache->priv->browser)
+	{
+		g_signal_handlers_disconnect_by_func (cache->priv->browser,
+		                                      G_CALLBACK (on_node_added),
+		                                      cache);
+
+		g_signal_handlers_disconnect_by_func (cache->priv->browser,
+		                                      G_CALLBACK (on_node_removed),
+		                                      cache);
+
+		g_object_unref (cache->priv->browser);
+		cache->priv->browser = NULL;
+	}
+
+	G_OBJECT_CLASS (gedit_collaboration_listing_cache_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_listing_cache_finalize (GObject *object)
+{
+	GeditCollaborationListingCache *cache = GEDIT_COLLABORATION_LISTING_CACHE (object);
+
+	g_hash_table_destroy (cache->priv->expanded);
+	g_free (cache->priv->filename);
+
+	G_OBJECT_CLASS (gedit_collaboration_listing_cache_parent_class)->finalize (object);
+}
+
+static void
+gedit_collaboration_listing_cache_set_property (GObject      *object,
+                                                guint         prop_id,
+                                                const GValue *value,
+                                                GParamSpec   *pspec)
+{
+	GeditCollaborationListingCache *self = GEDIT_COLLABORATION_LISTING_CACHE (object);
+
+	switch (prop_id)
+	{
+		case PROP_BROWSER:
+			self->priv->browser = g_value_dup_object (value);
+		break;
+		case PROP_FILENAME:
+			g_free (self->priv->filename);
+			self->priv->filename = g_value_dup_string (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_listing_cache_get_property (GObject    *object,
+                                                guint       prop_id,
+                                                GValue     *value,
+                                                GParamSpec *pspec)
+{
+	GeditCollaborationListingCache *self = GEDIT_COLLABORATION_LISTING_CACHE (object);
+
+	switch (prop_id)
+	{
+		case PROP_BROWSER:
+			g_value_set_object (value, self->priv->browser);
+		break;
+		case PROP_FILENAME:
+			g_value_set_string (value, self->priv->filename);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_listing_cache_constructed (GObject *object)
+{
+	GeditCollaborationListingCache *cache = GEDIT_COLLABORATION_LISTING_CACHE (object);
+	InfcBrowserIter root;
+
+	load_cache (cache);
+
+	g_signal_connect (cache->priv->browser,
+	                  "node-added",
+	                  G_CALLBACK (on_node_added),
+	                  cache);
+
+	g_signal_connect (cache->priv->browser,
+	                  "node-removed",
+	                  G_CALLBACK (on_node_removed),
+	                  cache);
+
+	/* Explore everything that was expanded last time in the background,
+	   subdirectories follow as they are added */
+	infc_browser_iter_get_root (cache->priv->browser, &root);
+	prefetch (cache, &root);
+}
+
+static void
+gedit_collaboration_listing_cache_class_init (GeditCollaborationListingCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_listing_cache_dispose;
+	object_class->finalize = gedit_collaboration_listing_cache_finalize;
+	object_class->constructed = gedit_collaboration_listing_cache_constructed;
+
+	object_class->set_property = gedit_collaboration_listing_cache_set_property;
+	object_class->get_property = gedit_collaboration_listing_cache_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_BROWSER,
+	                                 g_param_spec_object ("browser",
+	                                                      "Browser",
+	                                                      "Browser",
+	                                                      INFC_TYPE_BROWSER,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_FILENAME,
+	                                 g_param_spec_string ("filename",
+	                                                      "Filename",
+	                                                      "Filename",
+	                                                      NULL,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationListingCachePrivate));
+}
+
+static void
+gedit_collaboration_listing_cache_class_finalize (GeditCollaborationListingCacheClass *klass)
+{
+}
+
+static void
+gedit_collaboration_listing_cache_init (GeditCollaborationListingCache *self)
+{
+	self->priv = GEDIT_COLLABORATION_LISTING_CACHE_GET_PRIVATE (self);
+
+	self->priv->expanded = g_hash_table_new_full (g_str_hash,
+	                                              g_str_equal,
+	                                              (GDestroyNotify)g_free,
+	                                              NULL);
+}
+
+GeditCollaborationListingCache *
+gedit_collaboration_listing_cache_new (InfcBrowser *browser,
+                                       const gchar *filename)
+{
+	return g_object_new (GEDIT_COLLABORATION_TYPE_LISTING_CACHE,
+	                     "browser", browser,
+	                     "filename", filename,
+	                     NULL);
+}
+
+/* Remembers whether the directory at path is expanded in the browser view,
+   collapsing a directory also collapses the ones below it */
+void
+gedit_collaboration_listing_cache_set_expanded (GeditCollaborationListingCache *cache,
+                                                const gchar                    *path,
+                                                gboolean                        expanded)
+{
+	g_return_if_fail (GEDIT_COLLABORATION_IS_LISTING_CACHE (cache));
+	g_return_if_fail (path != NULL);
+
+	if (expanded)
+	{
+		if (g_hash_table_lookup (cache->priv->expanded, path) != NULL)
+		{
+			return;
+		}
+
+		g_hash_table_insert (cache->priv->expanded,
+		                     g_strdup (path),
+		                     GINT_TO_POINTER (TRUE));
+	}
+	else
+	{
+		remove_paths_below (cache->priv->expanded, path);
+	}
+
+	schedule_save (cache);
+}
+
+void
+_gedit_collaboration_listing_cache_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_listing_cache_register_type (type_module);
+}
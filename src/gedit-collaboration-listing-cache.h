@@ -0,0 +1,47 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_LISTING_CACHE_H__
+#define __GEDIT_COLLABORATION_LISTING_CACHE_H__
+
+#include <glib-object.h>
+#include <libinfinity/client/infc-browser.h>
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_LISTING_CACHE		(gedit_collaboration_listing_cache_get_type ())
+#define GEDIT_COLLABORATION_LISTING_CACHE(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_LISTING_CACHE, GeditCollaborationListingCache))
+#define GEDIT_COLLABORATION_LISTING_CACHE_CONST(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_LISTING_CACHE, GeditCollaborationListingCache const))
+#define GEDIT_COLLABORATION_LISTING_CACHE_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_LISTING_CACHE, GeditCollaborationListingCacheClass))
+#define GEDIT_COLLABORATION_IS_LISTING_CACHE(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_LISTING_CACHE))
+#define GEDIT_COLLABORATION_IS_LISTING_CACHE_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_LISTING_CACHE))
+#define GEDIT_COLLABORATION_LISTING_CACHE_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_LISTING_CACHE, GeditCollaborationListingCacheClass))
+
+typedef struct _GeditCollaborationListingCache		GeditCollaborationListingCache;
+typedef struct _GeditCollaborationListingCacheClass	GeditCollaborationListingCacheClass;
+typedef struct _GeditCollaborationListingCachePrivate	GeditCollaborationListingCachePrivate;
+
+struct _GeditCollaborationListingCache
+{
+	GObject parent;
+
+	GeditCollaborationListingCachePrivate *priv;
+};
+
+struct _GeditCollaborationListingCacheClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_listing_cache_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_listing_cache_register_type (GTypeModule *type_module);
+
+GeditCollaborationListingCache *gedit_collaboration_listing_cache_new (InfcBrowser *browser,
+                                                                      const gchar *filename);
+
+void gedit_collaboration_listing_cache_set_expanded (GeditCollaborationListingCache *cache,
+                                                     const gchar                    *path,
+                                                     gboolean                        expanded);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_LISTING_CACHE_H__ */
@@ -0,0 +1,758 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-locator.h"
+
+#include <config.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glib/gi18n-lib.h>
+#include <libinfinity/client/infc-explore-request.h>
+
+#include "gedit-collaboration.h"
+#include "gedit-collaboration-core.h"
+
+#define GEDIT_COLLABORATION_LOCATOR_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_LOCATOR, GeditCollaborationLocatorPrivate))
+
+#define LOCATION_URI_PREFIX GEDIT_COLLABORATION_LOCATOR_SCHEME "://"
+
+/* Time to wait for the connection to the server (in seconds) */
+#define CONNECT_TIMEOUT 30
+
+struct _GeditCollaborationLocatorPrivate
+{
+	GeditCollaborationManager *manager;
+	gchar *location;
+
+	gchar *host;
+	guint port;
+	gchar **segments;
+	guint segment;
+
+	GeditCollaborationBookmark *bookmark;
+	InfGtkBrowserStore *store;
+	guint timeout_id;
+	gboolean running;
+
+	/* The directory of the current segment */
+	InfcBrowser *browser;
+	InfcBrowserIter iter;
+
+	InfcExploreRequest *request;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_MANAGER,
+	PROP_LOCATION
+};
+
+/* Signals */
+enum
+{
+	FAILED,
+	NUM_SIGNALS
+};
+
+static guint signals[NUM_SIGNALS] = {0,};
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationLocator,
+                       gedit_collaboration_locator,
+                       G_TYPE_OBJECT)
+
+static void walk (GeditCollaborationLocator *locator);
+
+/* Accepts infinote://host:port/path as well as host:port/path, the port
+   may be left out */
+static gboolean
+parse_location (GeditCollaborationLocator  *locator,
+                GError                    **error)
+{
+	const gchar *location = locator->priv->location;
+	const gchar *slash;
+	const gchar *colon;
+	gchar *hostport;
+	gchar *path;
+	gboolean is_uri = FALSE;
+
+	if (g_ascii_strncasecmp (location, LOCATION_URI_PREFIX, strlen (LOCATION_URI_PREFIX)) == 0)
+	{
+		location += strlen (LOCATION_URI_PREFIX);
+		is_uri = TRUE;
+	}
+
+	slash = strchr (location, '/');
+
+	if (slash == NULL || slash == location)
+	{
+		g_set_error (error,
+		             GEDIT_COLLABORATION_ERROR,
+		             GEDIT_COLLABORATION_ERROR_INVALID_LOCATION,
+		             _("The location should look like host:port/path/to/document"));
+		return FALSE;
+	}
+
+	hostport = g_strndup (location, slash - location);
+
+	/* IPv6 addresses come between brackets */
+	if (*hostport == '[')
+	{
+		gchar *end = strchr (hostport, ']');
+
+		colon = end ? strchr (end, ':') : NULL;
+		locator->priv->host = g_strndup (hostport + 1,
+		                                 end ? end - hostport - 1 : strlen (hostport + 1));
+	}
+	else
+	{
+		colon = strrchr (hostport, ':');
+		locator->priv->host = colon ? g_strndup (hostport, colon - hostport)
+		                            : g_strdup (hostport);
+	}
+
+	locator->priv->port = colon ? strtoul (colon + 1, NULL, 10)
+	                            : DEFAULT_INFINOTE_PORT;
+
+	g_free (hostport);
+
+	if (*locator->priv->host == '\0' ||
+	    locator->priv->port == 0 ||
+	    locator->priv->port > 65535)
+	{
+		g_set_error (error,
+		             GEDIT_COLLABORATION_ERROR,
+		             GEDIT_COLLABORATION_ERROR_INVALID_LOCATION,
+		             _("The location does not contain a valid host and port"));
+		return FALSE;
+	}
+
+	path = is_uri ? g_uri_unescape_string (slash, NULL) : g_strdup (slash);
+
+	if (path == NULL)
+	{
+		g_set_error (error,
+		             GEDIT_COLLABORATION_ERROR,
+		             GEDIT_COLLABORATION_ERROR_INVALID_LOCATION,
+		             _("The location contains an invalid path"));
+		return FALSE;
+	}
+
+	/* Skip empty segments, a/b and a//b/ are the same */
+	{
+		gchar **parts;
+		gchar **part;
+		GPtrArray *segments;
+
+		parts = g_strsplit (path, "/", -1);
+		segments = g_ptr_array_new ();
+
+		for (part = parts; *part; ++part)
+		{
+			if (**part != '\0')
+			{
+				g_ptr_array_add (segments, g_strdup (*part));
+			}
+		}
+
+		g_ptr_array_add (segments, NULL);
+		locator->priv->segments = (gchar **)g_ptr_array_free (segments, FALSE);
+
+		g_strfreev (parts);
+	}
+
+	g_free (path);
+
+	if (locator->priv->segments[0] == NULL)
+	{
+		g_set_error (error,
+		             GEDIT_COLLABORATION_ERROR,
+		             GEDIT_COLLABORATION_ERROR_INVALID_LOCATION,
+		             _("The location does not point to a document"));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static GeditCollaborationBookmark *
+find_bookmark (GeditCollaborationLocator *locator,
+               GeditCollaborationCore    *core)
+{
+	GeditCollaborationBookmark *bookmark;
+
+	bookmark = gedit_collaboration_core_find_bookmark (core,
+	                                                   locator->priv->host,
+	                                                   locator->priv->port);
+
+	if (bookmark != NULL)
+	{
+		return g_object_ref (bookmark);
+	}
+
+	/* Servers which are not bookmarked yet are connected to through a
+	   temporary bookmark, which is not saved in the bookmarks file */
+	bookmark = gedit_collaboration_bookmark_new ();
+
+	gedit_collaboration_bookmark_set_name (bookmark, locator->priv->host);
+	gedit_collaboration_bookmark_set_host (bookmark, locator->priv->host);
+	gedit_collaboration_bookmark_set_port (bookmark, locator->priv->port);
+
+	gedit_collaboration_core_add_temporary_bookmark (core, bookmark);
+
+	return bookmark;
+}
+
+static void
+stop_waiting (GeditCollaborationLocator *locator)
+{
+	if (locator->priv->request == NULL)
+	{
+		return;
+	}
+
+	g_signal_handlers_disconnect_matched (locator->priv->request,
+	                                      G_SIGNAL_MATCH_DATA,
+	                                      0,
+	                                      0,
+	                                      NULL,
+	                                      NULL,
+	                                      locator);
+
+	g_object_unref (locator->priv->request);
+	locator->priv->request = NULL;
+}
+
+static void
+finish (GeditCollaborationLocator *locator,
+        const GError              *error)
+{
+	if (!locator->priv->running)
+	{
+		return;
+	}
+
+	locator->priv->running = FALSE;
+
+	stop_waiting (locator);
+
+	if (locator->priv->timeout_id != 0)
+	{
+		g_source_remove (locator->priv->timeout_id);
+		locator->priv->timeout_id = 0;
+	}
+
+	if (locator->priv->store)
+	{
+		g_signal_handlers_disconnect_matched (locator->priv->store,
+		                                      G_SIGNAL_MATCH_DATA,
+		                                      0,
+		                                      0,
+		                                      NULL,
+		                                      NULL,
+		                                      locator);
+	}
+
+	if (locator->priv->browser)
+	{
+		g_signal_handlers_disconnect_matched (locator->priv->browser,
+		                                      G_SIGNAL_MATCH_DATA,
+		                                      0,
+		                                      0,
+		                                      NULL,
+		                                      NULL,
+		                                      locator);
+	}
+
+	if (error != NULL)
+	{
+		g_signal_emit (locator, signals[FAILED], 0, error);
+	}
+
+	/* Keeps itself alive while running */
+	g_object_unref (locator);
+}
+
+static void
+fail (GeditCollaborationLocator *locator,
+      gint                       code,
+      const gchar               *message)
+{
+	GError *error;
+
+	error = g_error_new_literal (GEDIT_COLLABORATION_ERROR, code, message);
+	finish (locator, error);
+	g_error_free (error);
+}
+
+static gboolean
+find_child (GeditCollaborationLocator *locator,
+            InfcBrowserIter           *child)
+{
+	const gchar *name = locator->priv->segments[locator->priv->segment];
+
+	*child = locator->priv->iter;
+
+	if (!infc_browser_iter_get_child (locator->priv->browser, child))
+	{
+		return FALSE;
+	}
+
+	do
+	{
+		if (strcmp (infc_browser_iter_get_name (locator->priv->browser, child), name) == 0)
+		{
+			return TRUE;
+		}
+	} while (infc_browser_iter_get_next (locator->priv->browser, child));
+
+	return FALSE;
+}
+
+static void
+advance (GeditCollaborationLocator *locator,
+         InfcBrowserIter           *child)
+{
+	/* There is no need to wait for the rest of the directory */
+	stop_waiting (locator);
+
+	locator->priv->iter = *child;
+	++locator->priv->segment;
+
+	walk (locator);
+}
+
+static void
+on_node_added (InfcBrowser               *browser,
+               InfcBrowserIter           *iter,
+               GeditCollaborationLocator *locator)
+{
+	InfcBrowserIter parent = *iter;
+
+	if (locator->priv->request == NULL ||
+	    !infc_browser_iter_get_parent (browser, &parent) ||
+	    parent.node_id != locator->priv->iter.node_id)
+	{
+		return;
+	}
+
+	if (strcmp (infc_browser_iter_get_name (browser, iter),
+	            locator->priv->segments[locator->priv->segment]) == 0)
+	{
+		advance (locator, iter);
+	}
+}
+
+static void
+on_explore_finished (InfcExploreRequest        *request,
+                     GeditCollaborationLocator *locator)
+{
+	InfcBrowserIter child;
+
+	if (find_child (locator, &child))
+	{
+		advance (locator, &child);
+	}
+	else
+	{
+		fail (locator,
+		      GEDIT_COLLABORATION_ERROR_NOT_FOUND,
+		      _("The document could not be found on the server"));
+	}
+}
+
+static void
+on_explore_failed (InfcRequest               *request,
+                   const GError              *error,
+                   GeditCollaborationLocator *locator)
+{
+	finish (locator, error);
+}
+
+static void
+wait_for_child (GeditCollaborationLocator *locator,
+                InfcExploreRequest        *request)
+{
+	locator->priv->request = g_object_ref (request);
+
+	g_signal_connect (request,
+	                  "finished",
+	                  G_CALLBACK (on_explore_finished),
+	                  locator);
+
+	g_signal_connect (request,
+	                  "failed",
+	                  G_CALLBACK (on_explore_failed),
+	                  locator);
+}
+
+/* Only the directories on the path are explored, one round trip each */
+static void
+walk (GeditCollaborationLocator *locator)
+{
+	InfcBrowser *browser = locator->priv->browser;
+	GeditCollaborationUser *user;
+
+	while (locator->priv->segments[locator->priv->segment] != NULL)
+	{
+		InfcExploreRequest *request;
+		InfcBrowserIter child;
+
+		if (!infc_browser_iter_is_subdirectory (browser, &locator->priv->iter))
+		{
+			fail (locator,
+			      GEDIT_COLLABORATION_ERROR_NOT_FOUND,
+			      _("The location passes through a document"));
+			return;
+		}
+
+		request = infc_browser_iter_get_explore_request (browser,
+		                                                 &locator->priv->iter);
+
+		if (infc_browser_iter_get_explored (browser, &locator->priv->iter) &&
+		    find_child (locator, &child))
+		{
+			locator->priv->iter = child;
+			++locator->priv->segment;
+		}
+		else if (request != NULL)
+		{
+			wait_for_child (locator, request);
+			return;
+		}
+		else if (!infc_browser_iter_get_explored (browser, &locator->priv->iter))
+		{
+			wait_for_child (locator,
+			                infc_browser_iter_explore (browser, &locator->priv->iter));
+			return;
+		}
+		else
+		{
+			fail (locator,
+			      GEDIT_COLLABORATION_ERROR_NOT_FOUND,
+			      _("The document could not be found on the server"));
+			return;
+		}
+	}
+
+	if (infc_browser_iter_is_subdirectory (browser, &locator->priv->iter))
+	{
+		fail (locator,
+		      GEDIT_COLLABORATION_ERROR_NOT_FOUND,
+		      _("The location points to a directory"));
+		return;
+	}
+
+	user = gedit_collaboration_bookmark_get_user (locator->priv->bookmark);
+
+	gedit_collaboration_manager_subscribe (locator->priv->manager,
+	                                       user,
+	                                       browser,
+	                                       &locator->priv->iter);
+
+	finish (locator, NULL);
+}
+
+static void
+start_walk (GeditCollaborationLocator *locator,
+            InfcBrowser               *browser)
+{
+	if (locator->priv->timeout_id != 0)
+	{
+		g_source_remove (locator->priv->timeout_id);
+		locator->priv->timeout_id = 0;
+	}
+
+	locator->priv->browser = g_object_ref (browser);
+	infc_browser_iter_get_root (browser, &locator->priv->iter);
+
+	g_signal_connect (browser,
+	                  "node-added",
+	                  G_CALLBACK (on_node_added),
+	                  locator);
+
+	walk (locator);
+}
+
+static void
+on_browser_status_changed (InfcBrowser               *browser,
+                           GParamSpec                *spec,
+                           GeditCollaborationLocator *locator)
+{
+	if (locator->priv->running &&
+	    locator->priv->browser == NULL &&
+	    infc_browser_get_status (browser) == INFC_BROWSER_CONNECTED)
+	{
+		start_walk (locator, browser);
+	}
+}
+
+static void
+check_browser (GeditCollaborationLocator *locator,
+               InfcBrowser               *browser)
+{
+	InfXmlConnection *connection;
+
+	if (locator->priv->browser != NULL)
+	{
+		return;
+	}
+
+	connection = infc_browser_get_connection (browser);
+
+	if (g_object_get_data (G_OBJECT (connection), BOOKMARK_DATA_KEY) != locator->priv->bookmark)
+	{
+		return;
+	}
+
+	if (infc_browser_get_status (browser) == INFC_BROWSER_CONNECTED)
+	{
+		start_walk (locator, browser);
+	}
+	else
+	{
+		/* Connecting replaces the browser of the bookmark, every
+		   browser of the bookmark is watched until one connects */
+		g_signal_connect_object (browser,
+		                         "notify::status",
+		                         G_CALLBACK (on_browser_status_changed),
+		                         locator,
+		                         0);
+	}
+}
+
+static void
+on_set_browser (InfGtkBrowserModel        *model,
+                GtkTreePath               *path,
+                GtkTreeIter               *iter,
+                InfcBrowser               *browser,
+                GeditCollaborationLocator *locator)
+{
+	if (browser != NULL)
+	{
+		check_browser (locator, browser);
+	}
+}
+
+static gboolean
+on_connect_timeout (GeditCollaborationLocator *locator)
+{
+	locator->priv->timeout_id = 0;
+
+	fail (locator,
+	      GEDIT_COLLABORATION_ERROR_CONNECTION_FAILED,
+	      _("Could not connect to the server"));
+
+	return FALSE;
+}
+
+static void
+gedit_collaboration_locator_finalize (GObject *object)
+{
+	GeditCollaborationLocator *locator = GEDIT_COLLABORATION_LOCATOR (object);
+
+	if (locator->priv->browser)
+	{
+		g_object_unref (locator->priv->browser);
+	}
+
+	if (locator->priv->store)
+	{
+		g_object_unref (locator->priv->store);
+	}
+
+	if (locator->priv->bookmark)
+	{
+		g_object_unref (locator->priv->bookmark);
+	}
+
+	if (locator->priv->manager)
+	{
+		g_object_unref (locator->priv->manager);
+	}
+
+	g_free (locator->priv->location);
+	g_free (locator->priv->host);
+	g_strfreev (locator->priv->segments);
+
+	G_OBJECT_CLASS (gedit_collaboration_locator_parent_class)->finalize (object);
+}
+
+static void
+gedit_collaboration_locator_set_property (GObject      *object,
+                                          guint         prop_id,
+                                          const GValue *value,
+                                          GParamSpec   *pspec)
+{
+	GeditCollaborationLocator *self = GEDIT_COLLABORATION_LOCATOR (object);
+
+	switch (prop_id)
+	{
+		case PROP_MANAGER:
+			self->priv->manager = g_value_dup_object (value);
+		break;
+		case PROP_LOCATION:
+			g_free (self->priv->location);
+			self->priv->location = g_value_dup_string (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_locator_get_property (GObject    *object,
+                                          guint       prop_id,
+                                          GValue     *value,
+                                          GParamSpec *pspec)
+{
+	GeditCollaborationLocator *self = GEDIT_COLLABORATION_LOCATOR (object);
+
+	switch (prop_id)
+	{
+		case PROP_MANAGER:
+			g_value_set_object (value, self->priv->manager);
+		break;
+		case PROP_LOCATION:
+			g_value_set_string (value, self->priv->location);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_locator_class_init (GeditCollaborationLocatorClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gedit_collaboration_locator_finalize;
+
+	object_class->set_property = gedit_collaboration_locator_set_property;
+	object_class->get_property = gedit_collaboration_locator_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_MANAGER,
+	                                 g_param_spec_object ("manager",
+	                                                      "Manager",
+	                                                      "Manager",
+	                                                      GEDIT_COLLABORATION_TYPE_MANAGER,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_LOCATION,
+	                                 g_param_spec_string ("location",
+	                                                      "Location",
+	                                                      "Location",
+	                                                      NULL,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	signals[FAILED] =
+		g_signal_new ("failed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL,
+		              NULL,
+		              g_cclosure_marshal_VOID__POINTER,
+		              G_TYPE_NONE,
+		              1,
+		              G_TYPE_POINTER);
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationLocatorPrivate));
+}
+
+static void
+gedit_collaboration_locator_class_finalize (GeditCollaborationLocatorClass *klass)
+{
+}
+
+static void
+gedit_collaboration_locator_init (GeditCollaborationLocator *self)
+{
+	self->priv = GEDIT_COLLABORATION_LOCATOR_GET_PRIVATE (self);
+}
+
+GeditCollaborationLocator *
+gedit_collaboration_locator_new (GeditCollaborationManager *manager,
+                                 const gchar               *location)
+{
+	return g_object_new (GEDIT_COLLABORATION_TYPE_LOCATOR,
+	                     "manager", manager,
+	                     "location", location,
+	                     NULL);
+}
+
+void
+gedit_collaboration_locator_start (GeditCollaborationLocator *locator)
+{
+	GeditCollaborationCore *core;
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	GError *error = NULL;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_LOCATOR (locator));
+	g_return_if_fail (!locator->priv->running);
+
+	locator->priv->running = TRUE;
+	g_object_ref (locator);
+
+	if (!parse_location (locator, &error))
+	{
+		finish (locator, error);
+		g_error_free (error);
+		return;
+	}
+
+	core = gedit_collaboration_core_get_default ();
+
+	locator->priv->bookmark = find_bookmark (locator, core);
+	locator->priv->store = g_object_ref (gedit_collaboration_core_get_browser_store (core));
+
+	locator->priv->timeout_id =
+		g_timeout_add_seconds (CONNECT_TIMEOUT,
+		                       (GSourceFunc)on_connect_timeout,
+		                       locator);
+
+	g_signal_connect_after (locator->priv->store,
+	                        "set-browser",
+	                        G_CALLBACK (on_set_browser),
+	                        locator);
+
+	model = GTK_TREE_MODEL (locator->priv->store);
+
+	if (gtk_tree_model_get_iter_first (model, &iter))
+	{
+		do
+		{
+			InfcBrowser *browser;
+
+			gtk_tree_model_get (model,
+			                    &iter,
+			                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
+			                    &browser,
+			                    -1);
+
+			if (browser != NULL)
+			{
+				check_browser (locator, browser);
+				g_object_unref (browser);
+			}
+		} while (locator->priv->running &&
+		         locator->priv->browser == NULL &&
+		         gtk_tree_model_iter_next (model, &iter));
+	}
+
+	if (locator->priv->running && locator->priv->browser == NULL)
+	{
+		gedit_collaboration_core_open_bookmark (core, locator->priv->bookmark);
+	}
+}
+
+void
+_gedit_collaboration_locator_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_locator_register_type (type_module);
+}
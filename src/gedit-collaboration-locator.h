@@ -0,0 +1,48 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_LOCATOR_H__
+#define __GEDIT_COLLABORATION_LOCATOR_H__
+
+#include <glib-object.h>
+#include "gedit-collaboration-manager.h"
+
+G_BEGIN_DECLS
+
+/* Scheme of the locations of documents on infinote servers */
+#define GEDIT_COLLABORATION_LOCATOR_SCHEME "infinote"
+
+#define GEDIT_COLLABORATION_TYPE_LOCATOR		(gedit_collaboration_locator_get_type ())
+#define GEDIT_COLLABORATION_LOCATOR(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_LOCATOR, GeditCollaborationLocator))
+#define GEDIT_COLLABORATION_LOCATOR_CONST(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_LOCATOR, GeditCollaborationLocator const))
+#define GEDIT_COLLABORATION_LOCATOR_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_LOCATOR, GeditCollaborationLocatorClass))
+#define GEDIT_COLLABORATION_IS_LOCATOR(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_LOCATOR))
+#define GEDIT_COLLABORATION_IS_LOCATOR_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_LOCATOR))
+#define GEDIT_COLLABORATION_LOCATOR_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_LOCATOR, GeditCollaborationLocatorClass))
+
+typedef struct _GeditCollaborationLocator		GeditCollaborationLocator;
+typedef struct _GeditCollaborationLocatorClass	GeditCollaborationLocatorClass;
+typedef struct _GeditCollaborationLocatorPrivate	GeditCollaborationLocatorPrivate;
+
+struct _GeditCollaborationLocator
+{
+	GObject parent;
+
+	GeditCollaborationLocatorPrivate *priv;
+};
+
+struct _GeditCollaborationLocatorClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_locator_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_locator_register_type (GTypeModule *type_module);
+
+GeditCollaborationLocator *gedit_collaboration_locator_new (GeditCollaborationManager *manager,
+                                                            const gchar               *location);
+
+void gedit_collaboration_locator_start (GeditCollaborationLocator *locator);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_LOCATOR_H__ */
@@ -4,26 +4,42 @@
 #include <libinfinity/adopted/inf-adopted-session.h>
 #include <libinftext/inf-text-session.h>
 #include <libinftext/inf-text-buffer.h>
+#include <libinftext/inf-text-default-insert-operation.h>
+#include <libinftext/inf-text-default-delete-operation.h>
 #include <libinftextgtk/inf-text-gtk-buffer.h>
 #include <gedit/gedit-view.h>
+#include <gtksourceview/gtksourcelanguagemanager.h>
 #include <libinfinity/common/inf-error.h>
 #include "gedit-collaboration.h"
 #include "gedit-collaboration-document-message.h"
 #include "gedit-collaboration-undo-manager.h"
+#include "gedit-collaboration-coalescer.h"
+#include "gedit-collaboration-caret-throttle.h"
+#include "gedit-collaboration-receive-throttle.h"
 #include "gedit-collaboration-user-store.h"
+#include "gedit-collaboration-core.h"
 
 #include <config.h>
 #include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
+#include <string.h>
 
 #define SESSION_TAB_DATA_KEY "GeditCollaborationManagerSessionTabDataKey"
 #define TAB_SUBSCRIPTION_DATA_KEY "GeditCollaborationManagerTabSubscriptionDataKey"
 
+/* Minimum interval between two progress bar updates, about one frame */
+#define PROGRESS_UPDATE_INTERVAL 16
+
+/* Snapshots not used for this long are removed, and the oldest ones go
+   first when together they are bigger than the maximum size */
+#define SNAPSHOT_MAX_AGE (30 * 24 * 60 * 60)
+#define SNAPSHOT_MAX_SIZE (64 * 1024 * 1024)
+
 #define GEDIT_COLLABORATION_MANAGER_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_MANAGER, GeditCollaborationManagerPrivate))
 
 struct _GeditCollaborationManagerPrivate
 {
 	GeditWindow *window;
-	InfcNotePlugin note_plugin;
 
 	GSList *subscriptions;
 	GHashTable *subscription_map;
@@ -38,6 +54,7 @@ enum
 	VIEW_DESTROYED,
 	SESSION_CLOSE,
 	CONNECTION_STATUS,
+	DOCUMENT_INSERT_TEXT,
 	NUM_EXTERNAL_SIGNALS
 };
 
@@ -56,11 +73,41 @@ struct _GeditCollaborationSubscription
 
 	GTimer *progress_timer;
 	gdouble progress_start;
+	gdouble progress_start_time;
+	gdouble progress_fraction;
+	guint64 progress_bytes;
+	guint64 progress_start_bytes;
+	guint progress_update_id;
 	GtkWidget *progress_area;
 
 	gboolean loading;
+	gboolean synchronized;
+
+	/* Buffer observers suspended during the initial synchronization */
+	gboolean bulk_sync;
+	gboolean highlight_syntax;
+	gboolean highlight_matching_brackets;
+	gchar *content_type;
+
+	/* Cached text shown until the synchronization completes */
+	gchar *snapshot_filename;
+	gchar *snapshot_checksum;
+	GCancellable *snapshot_cancellable;
+	GtkSourceBuffer *snapshot;
+	GtkWidget *snapshot_view;
+	GeditDocument *document;
 
 	GeditCollaborationUserStore *user_store;
+	GeditCollaborationCoalescer *coalescer;
+	GeditCollaborationCaretThrottle *caret_throttle;
+
+	/* How often the view is drawn for changes of other participants */
+	gboolean remote_tracking;
+	guint remote_operations;
+	guint redraws;
+
+	/* Budgeted processing of incoming data on the connection */
+	GeditCollaborationReceiveThrottle *receive_throttle;
 };
 
 /* Properties */
@@ -99,6 +146,9 @@ gedit_collaboration_manager_dispose (GObject *object)
 
 	if (manager->priv->window)
 	{
+		gedit_collaboration_core_remove_manager (gedit_collaboration_core_get_default (),
+		                                         manager);
+
 		g_object_unref (manager->priv->window);
 		manager->priv->window = NULL;
 
@@ -112,6 +162,20 @@ gedit_collaboration_manager_dispose (GObject *object)
 	}
 }
 
+static void
+gedit_collaboration_manager_constructed (GObject *object)
+{
+	GeditCollaborationManager *manager = GEDIT_COLLABORATION_MANAGER (object);
+
+	if (G_OBJECT_CLASS (gedit_collaboration_manager_parent_class)->constructed)
+	{
+		G_OBJECT_CLASS (gedit_collaboration_manager_parent_class)->constructed (object);
+	}
+
+	gedit_collaboration_core_add_manager (gedit_collaboration_core_get_default (),
+	                                      manager);
+}
+
 static void
 gedit_collaboration_manager_get_property (GObject    *object,
                                           guint       prop_id,
@@ -162,6 +226,7 @@ gedit_collaboration_manager_class_init (GeditCollaborationManagerClass *klass)
 
 	object_class->finalize = gedit_collaboration_manager_finalize;
 	object_class->dispose = gedit_collaboration_manager_dispose;
+	object_class->constructed = gedit_collaboration_manager_constructed;
 	object_class->set_property = gedit_collaboration_manager_set_property;
 	object_class->get_property = gedit_collaboration_manager_get_property;
 
@@ -213,9 +278,577 @@ on_style_set (GtkWidget        *widget,
 	update_saturation_value (widget, buffer);
 }
 
+static gchar *
+snapshot_filename (InfcBrowser           *browser,
+                   const InfcBrowserIter *iter)
+{
+	gchar *server;
+	gchar *path;
+	gchar *key;
+	gchar *checksum;
+	gchar *filename;
+
+	server = gedit_collaboration_get_server_key (infc_browser_get_connection (browser));
+
+	/* The node id changes when a document is removed and created again
+	   under the same path */
+	path = infc_browser_iter_get_path (browser, iter);
+	key = g_strdup_printf ("%s\n%u\n%s", server, iter->node_id, path);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+
+	filename = g_build_filename (g_get_user_cache_dir (),
+	                             "gedit",
+	                             "collaboration",
+	                             "snapshots",
+	                             checksum,
+	                             NULL);
+
+	g_free (checksum);
+	g_free (key);
+	g_free (path);
+	g_free (server);
+
+	return filename;
+}
+
+static gchar *
+get_document_text (GtkTextBuffer *buffer)
+{
+	GtkTextIter start;
+	GtkTextIter end;
+
+	gtk_text_buffer_get_bounds (buffer, &start, &end);
+	return gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+}
+
+static void
+on_snapshot_saved (GFile        *file,
+                   GAsyncResult *result,
+                   gchar        *contents)
+{
+	GError *error = NULL;
+
+	if (!g_file_replace_contents_finish (file, result, NULL, &error))
+	{
+		g_warning ("%s", error->message);
+		g_error_free (error);
+	}
+
+	g_free (contents);
+	g_object_unref (file);
+}
+
+typedef struct
+{
+	gchar *filename;
+	goffset size;
+	time_t mtime;
+} SnapshotFile;
+
+static gint
+compare_snapshot_age (SnapshotFile const *first,
+                      SnapshotFile const *second)
+{
+	return first->mtime < second->mtime ? -1 : (first->mtime > second->mtime ? 1 : 0);
+}
+
+/* Done once, the first time a snapshot is written */
+static void
+prune_snapshots (const gchar *dirname)
+{
+	static gboolean pruned = FALSE;
+	GDir *dir;
+	const gchar *name;
+	GSList *files = NULL;
+	GSList *item;
+	goffset total = 0;
+	time_t now;
+
+	if (pruned)
+	{
+		return;
+	}
+
+	pruned = TRUE;
+	dir = g_dir_open (dirname, 0, NULL);
+
+	if (dir == NULL)
+	{
+		return;
+	}
+
+	now = time (NULL);
+
+	while ((name = g_dir_read_name (dir)) != NULL)
+	{
+		SnapshotFile *file;
+		GStatBuf buf;
+		gchar *filename;
+
+		filename = g_build_filename (dirname, name, NULL);
+
+		if (g_stat (filename, &buf) != 0 || !S_ISREG (buf.st_mode))
+		{
+			g_free (filename);
+			continue;
+		}
+
+		if (now - buf.st_mtime > SNAPSHOT_MAX_AGE)
+		{
+			g_unlink (filename);
+			g_free (filename);
+			continue;
+		}
+
+		file = g_slice_new (SnapshotFile);
+		file->filename = filename;
+		file->size = buf.st_size;
+		file->mtime = buf.st_mtime;
+
+		total += file->size;
+		files = g_slist_prepend (files, file);
+	}
+
+	g_dir_close (dir);
+
+	files = g_slist_sort (files, (GCompareFunc)compare_snapshot_age);
+
+	for (item = files; item; item = g_slist_next (item))
+	{
+		SnapshotFile *file = item->data;
+
+		if (total > SNAPSHOT_MAX_SIZE)
+		{
+			g_unlink (file->filename);
+			total -= file->size;
+		}
+
+		g_free (file->filename);
+		g_slice_free (SnapshotFile, file);
+	}
+
+	g_slist_free (files);
+}
+
+static void
+save_snapshot (GeditCollaborationSubscription *subscription)
+{
+	GFile *file;
+	gchar *dirname;
+	gchar *contents;
+
+	dirname = g_path_get_dirname (subscription->snapshot_filename);
+	g_mkdir_with_parents (dirname, 0700);
+	prune_snapshots (dirname);
+	g_free (dirname);
+
+	contents = get_document_text (GTK_TEXT_BUFFER (subscription->document));
+	file = g_file_new_for_path (subscription->snapshot_filename);
+
+	g_file_replace_contents_async (file,
+	                               contents,
+	                               strlen (contents),
+	                               NULL,
+	                               FALSE,
+	                               G_FILE_CREATE_PRIVATE,
+	                               NULL,
+	                               (GAsyncReadyCallback)on_snapshot_saved,
+	                               contents);
+}
+
+/* A read-only view shown in the tab in place of the tab's own view, which
+   keeps showing the document */
+static GtkWidget *
+create_snapshot_view (GeditCollaborationSubscription *subscription)
+{
+	GeditView *view;
+	GtkWidget *view_window;
+	GtkWidget *sw;
+	GtkWidget *source_view;
+	gint position;
+
+	view = gedit_tab_get_view (subscription->tab);
+	view_window = gtk_widget_get_parent (GTK_WIDGET (view));
+
+	source_view = gtk_source_view_new_with_buffer (subscription->snapshot);
+
+	gtk_text_view_set_editable (GTK_TEXT_VIEW (source_view), FALSE);
+	gtk_source_view_set_show_line_numbers (GTK_SOURCE_VIEW (source_view),
+	                                       gtk_source_view_get_show_line_numbers (GTK_SOURCE_VIEW (view)));
+	gtk_widget_override_font (source_view,
+	                          pango_context_get_font_description (gtk_widget_get_pango_context (GTK_WIDGET (view))));
+
+	sw = gtk_scrolled_window_new (NULL, NULL);
+	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (sw),
+	                                GTK_POLICY_AUTOMATIC,
+	                                GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (sw),
+	                                     gtk_scrolled_window_get_shadow_type (GTK_SCROLLED_WINDOW (view_window)));
+
+	gtk_container_add (GTK_CONTAINER (sw), source_view);
+	gtk_widget_show_all (sw);
+
+	gtk_container_child_get (GTK_CONTAINER (subscription->tab),
+	                         view_window,
+	                         "position", &position,
+	                         NULL);
+
+	gtk_box_pack_start (GTK_BOX (subscription->tab), sw, TRUE, TRUE, 0);
+	gtk_box_reorder_child (GTK_BOX (subscription->tab), sw, position);
+
+	gtk_widget_hide (view_window);
+
+	return g_object_ref (sw);
+}
+
+static void
+show_snapshot (GeditCollaborationSubscription *subscription,
+               const gchar                    *contents,
+               gsize                           length)
+{
+	subscription->snapshot = gtk_source_buffer_new (NULL);
+
+	subscription->snapshot_checksum =
+		g_compute_checksum_for_string (G_CHECKSUM_SHA1, contents, length);
+
+	gtk_source_buffer_begin_not_undoable_action (subscription->snapshot);
+	gtk_text_buffer_set_text (GTK_TEXT_BUFFER (subscription->snapshot), contents, length);
+	gtk_source_buffer_end_not_undoable_action (subscription->snapshot);
+
+	gtk_source_buffer_set_language (subscription->snapshot,
+	                                gtk_source_language_manager_guess_language (gtk_source_language_manager_get_default (),
+	                                                                            NULL,
+	                                                                            subscription->content_type));
+
+	gtk_source_buffer_set_style_scheme (subscription->snapshot,
+	                                    gtk_source_buffer_get_style_scheme (GTK_SOURCE_BUFFER (subscription->document)));
+
+	/* The tab keeps its document, only what is shown changes */
+	subscription->snapshot_view = create_snapshot_view (subscription);
+}
+
+static void
+on_snapshot_loaded (GFile                          *file,
+                    GAsyncResult                   *result,
+                    GeditCollaborationSubscription *subscription)
+{
+	GError *error = NULL;
+	gchar *contents = NULL;
+	gsize length = 0;
+
+	/* Cancelled when the synchronization completed first or the
+	   subscription is gone, in which case it is not touched */
+	if (!g_file_load_contents_finish (file,
+	                                  result,
+	                                  &contents,
+	                                  &length,
+	                                  NULL,
+	                                  &error))
+	{
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			g_error_free (error);
+			return;
+		}
+
+		g_error_free (error);
+	}
+
+	g_object_unref (subscription->snapshot_cancellable);
+	subscription->snapshot_cancellable = NULL;
+
+	if (contents != NULL && !g_utf8_validate (contents, length, NULL))
+	{
+		g_free (contents);
+		contents = NULL;
+	}
+
+	/* Without a cached copy the document shows up as it comes in */
+	if (contents != NULL && subscription->tab != NULL)
+	{
+		show_snapshot (subscription, contents, length);
+	}
+
+	g_free (contents);
+}
+
+static void
+load_snapshot (GeditCollaborationSubscription *subscription)
+{
+	GFile *file;
+
+	file = g_file_new_for_path (subscription->snapshot_filename);
+	subscription->snapshot_cancellable = g_cancellable_new ();
+
+	g_file_load_contents_async (file,
+	                            subscription->snapshot_cancellable,
+	                            (GAsyncReadyCallback)on_snapshot_loaded,
+	                            subscription);
+
+	g_object_unref (file);
+}
+
+static void
+hide_snapshot (GeditCollaborationSubscription *subscription,
+               gboolean                        validate)
+{
+	GtkTextBuffer *buffer;
+	GtkTextIter iter;
+	gint offset;
+	gboolean had_focus;
+
+	if (subscription->snapshot_cancellable != NULL)
+	{
+		g_cancellable_cancel (subscription->snapshot_cancellable);
+		g_object_unref (subscription->snapshot_cancellable);
+		subscription->snapshot_cancellable = NULL;
+	}
+
+	if (subscription->snapshot == NULL)
+	{
+		return;
+	}
+
+	buffer = GTK_TEXT_BUFFER (subscription->snapshot);
+
+	gtk_text_buffer_get_iter_at_mark (buffer,
+	                                  &iter,
+	                                  gtk_text_buffer_get_insert (buffer));
+
+	offset = gtk_text_iter_get_offset (&iter);
+	had_focus = gtk_widget_has_focus (gtk_bin_get_child (GTK_BIN (subscription->snapshot_view)));
+
+	if (subscription->tab != NULL)
+	{
+		GtkWidget *view = GTK_WIDGET (gedit_tab_get_view (subscription->tab));
+
+		gtk_widget_show (gtk_widget_get_parent (view));
+
+		if (had_focus)
+		{
+			gtk_widget_grab_focus (view);
+		}
+	}
+
+	gtk_widget_destroy (subscription->snapshot_view);
+	g_object_unref (subscription->snapshot_view);
+	subscription->snapshot_view = NULL;
+
+	if (validate)
+	{
+		gchar *text;
+		gchar *checksum;
+
+		text = get_document_text (GTK_TEXT_BUFFER (subscription->document));
+		checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, text, -1);
+
+		if (g_strcmp0 (checksum, subscription->snapshot_checksum) == 0)
+		{
+			/* Unchanged, keep the position the user moved to */
+			gtk_text_buffer_get_iter_at_offset (GTK_TEXT_BUFFER (subscription->document),
+			                                    &iter,
+			                                    offset);
+
+			gtk_text_buffer_place_cursor (GTK_TEXT_BUFFER (subscription->document),
+			                              &iter);
+		}
+		else
+		{
+			/* Stale, refresh the cache right away */
+			save_snapshot (subscription);
+		}
+
+		g_free (checksum);
+		g_free (text);
+	}
+
+	g_object_unref (subscription->snapshot);
+	subscription->snapshot = NULL;
+
+	g_free (subscription->snapshot_checksum);
+	subscription->snapshot_checksum = NULL;
+}
+
+static void
+begin_bulk_sync (GeditCollaborationSubscription *subscription)
+{
+	GtkSourceBuffer *buffer = GTK_SOURCE_BUFFER (subscription->document);
+
+	/* Highlighting and bracket matching would otherwise rerun for every
+	   chunk inserted by the synchronization */
+	subscription->bulk_sync = TRUE;
+	subscription->highlight_syntax = gtk_source_buffer_get_highlight_syntax (buffer);
+	subscription->highlight_matching_brackets =
+		gtk_source_buffer_get_highlight_matching_brackets (buffer);
+
+	gtk_source_buffer_set_highlight_syntax (buffer, FALSE);
+	gtk_source_buffer_set_highlight_matching_brackets (buffer, FALSE);
+}
+
+static void
+end_bulk_sync (GeditCollaborationSubscription *subscription,
+               const gchar                    *content_type)
+{
+	GtkSourceBuffer *buffer = GTK_SOURCE_BUFFER (subscription->document);
+
+	if (!subscription->bulk_sync)
+	{
+		return;
+	}
+
+	subscription->bulk_sync = FALSE;
+
+	/* Setting the content type picks the language, everything is then
+	   highlighted once */
+	if (content_type != NULL)
+	{
+		gedit_document_set_content_type (subscription->document, content_type);
+	}
+
+	gtk_source_buffer_set_highlight_matching_brackets (buffer,
+	                                                   subscription->highlight_matching_brackets);
+	gtk_source_buffer_set_highlight_syntax (buffer,
+	                                        subscription->highlight_syntax);
+}
+
+static void
+on_remote_text_changed (InfTextBuffer                  *buffer,
+                        guint                           pos,
+                        InfTextChunk                   *chunk,
+                        InfUser                        *user,
+                        GeditCollaborationSubscription *subscription)
+{
+	if (user != INF_USER (inf_text_gtk_buffer_get_active_user (INF_TEXT_GTK_BUFFER (buffer))))
+	{
+		++subscription->remote_operations;
+	}
+}
+
+/* GTK+ already lays out lazily and draws at most once per frame, the
+   count shows how well remote changes are folded into those frames */
+static gboolean
+on_view_draw (GtkWidget                      *widget,
+              cairo_t                        *cr,
+              GeditCollaborationSubscription *subscription)
+{
+	++subscription->redraws;
+	return FALSE;
+}
+
+static void
+on_receive_throttle_behind (GeditCollaborationReceiveThrottle *throttle,
+                            GParamSpec                        *spec,
+                            GeditCollaborationSubscription    *subscription)
+{
+	GtkWidget *view = GTK_WIDGET (gedit_tab_get_view (subscription->tab));
+	GdkCursor *cursor = NULL;
+
+	if (!gtk_widget_get_realized (view))
+	{
+		return;
+	}
+
+	/* Show that the document is lagging behind the other participants */
+	if (gedit_collaboration_receive_throttle_get_behind (throttle))
+	{
+		cursor = gdk_cursor_new_for_display (gtk_widget_get_display (view),
+		                                     GDK_WATCH);
+	}
+
+	gdk_window_set_cursor (gtk_text_view_get_window (GTK_TEXT_VIEW (view),
+	                                                 GTK_TEXT_WINDOW_TEXT),
+	                       cursor);
+
+	if (cursor != NULL)
+	{
+		gdk_cursor_unref (cursor);
+	}
+}
+
+static void
+install_remote_tracking (GeditCollaborationSubscription *subscription)
+{
+	InfBuffer *buffer;
+
+	buffer = inf_session_get_buffer (infc_session_proxy_get_session (subscription->proxy));
+
+	subscription->remote_tracking = TRUE;
+
+	g_signal_connect (buffer,
+	                  "text-inserted",
+	                  G_CALLBACK (on_remote_text_changed),
+	                  subscription);
+
+	g_signal_connect (buffer,
+	                  "text-erased",
+	                  G_CALLBACK (on_remote_text_changed),
+	                  subscription);
+
+	g_signal_connect (gedit_tab_get_view (subscription->tab),
+	                  "draw",
+	                  G_CALLBACK (on_view_draw),
+	                  subscription);
+
+	subscription->receive_throttle =
+		gedit_collaboration_receive_throttle_get (infc_session_proxy_get_connection (subscription->proxy));
+
+	if (subscription->receive_throttle != NULL)
+	{
+		g_object_ref (subscription->receive_throttle);
+
+		g_signal_connect (subscription->receive_throttle,
+		                  "notify::behind",
+		                  G_CALLBACK (on_receive_throttle_behind),
+		                  subscription);
+	}
+}
+
+static void
+uninstall_remote_tracking (GeditCollaborationSubscription *subscription)
+{
+	InfBuffer *buffer;
+
+	subscription->remote_tracking = FALSE;
+
+	buffer = inf_session_get_buffer (infc_session_proxy_get_session (subscription->proxy));
+
+	g_signal_handlers_disconnect_by_func (buffer,
+	                                      G_CALLBACK (on_remote_text_changed),
+	                                      subscription);
+
+	if (subscription->tab != NULL)
+	{
+		g_signal_handlers_disconnect_by_func (gedit_tab_get_view (subscription->tab),
+		                                      G_CALLBACK (on_view_draw),
+		                                      subscription);
+	}
+
+	if (subscription->receive_throttle != NULL)
+	{
+		g_signal_handlers_disconnect_by_func (subscription->receive_throttle,
+		                                      G_CALLBACK (on_receive_throttle_behind),
+		                                      subscription);
+
+		g_object_unref (subscription->receive_throttle);
+		subscription->receive_throttle = NULL;
+	}
+}
+
 static void
 gedit_collaboration_subscription_free (GeditCollaborationSubscription *subscription)
 {
+	hide_snapshot (subscription, FALSE);
+
+	if (subscription->document != NULL)
+	{
+		end_bulk_sync (subscription, NULL);
+	}
+
+	if (subscription->synchronized)
+	{
+		save_snapshot (subscription);
+	}
+
 	if (subscription->tab)
 	{
 		gedit_collaboration_manager_clear_colors (subscription->manager,
@@ -227,6 +860,22 @@ gedit_collaboration_subscription_free (GeditCollaborationSubscription *subscript
 		g_object_unref (subscription->user_store);
 	}
 
+	/* Sends whatever is still pending, so before closing the session */
+	if (subscription->coalescer)
+	{
+		g_object_unref (subscription->coalescer);
+	}
+
+	if (subscription->caret_throttle)
+	{
+		g_object_unref (subscription->caret_throttle);
+	}
+
+	if (subscription->remote_tracking)
+	{
+		uninstall_remote_tracking (subscription);
+	}
+
 	if (subscription->proxy != NULL)
 	{
 		InfXmlConnection *connection;
@@ -306,11 +955,31 @@ gedit_collaboration_subscription_free (GeditCollaborationSubscription *subscript
 		g_timer_destroy (subscription->progress_timer);
 	}
 
+	if (subscription->progress_update_id != 0)
+	{
+		g_source_remove (subscription->progress_update_id);
+	}
+
+	if (subscription->document != NULL &&
+	    subscription->signal_handlers[DOCUMENT_INSERT_TEXT] != 0)
+	{
+		g_signal_handler_disconnect (subscription->document,
+		                             subscription->signal_handlers[DOCUMENT_INSERT_TEXT]);
+	}
+
 	if (subscription->browser != NULL)
 	{
 		g_object_unref (subscription->browser);
 	}
 
+	if (subscription->document != NULL)
+	{
+		g_object_unref (subscription->document);
+	}
+
+	g_free (subscription->snapshot_filename);
+	g_free (subscription->content_type);
+
 	if (subscription->tab)
 	{
 		g_signal_emit (subscription->manager, signals[CHANGED], 0, subscription->tab);
@@ -344,15 +1013,14 @@ on_view_destroyed (GtkWidget    *tab,
 	close_subscription (subscription);
 }
 
-static InfSession *
-create_session_new (InfIo                       *io,
-                    InfCommunicationManager     *manager,
-                    InfSessionStatus             status,
-                    InfCommunicationJoinedGroup *sync_group,
-                    InfXmlConnection            *sync_connection,
-                    gpointer                     user_data)
+InfSession *
+gedit_collaboration_manager_create_session (GeditCollaborationManager   *man,
+                                            InfIo                       *io,
+                                            InfCommunicationManager     *manager,
+                                            InfSessionStatus             status,
+                                            InfCommunicationJoinedGroup *sync_group,
+                                            InfXmlConnection            *sync_connection)
 {
-	GeditCollaborationManager *man = user_data;
 	InfTextSession *session;
 	InfUserTable *user_table;
 	InfTextBuffer *buffer;
@@ -402,10 +1070,6 @@ gedit_collaboration_manager_init (GeditCollaborationManager *self)
 {
 	self->priv = GEDIT_COLLABORATION_MANAGER_GET_PRIVATE (self);
 
-	self->priv->note_plugin.user_data = self;
-	self->priv->note_plugin.note_type = "InfText";
-	self->priv->note_plugin.session_new = create_session_new;
-
 	self->priv->subscription_map = g_hash_table_new_full (g_direct_hash,
 	                                                      g_direct_equal,
 	                                                      (GDestroyNotify)g_object_unref,
@@ -420,14 +1084,6 @@ gedit_collaboration_manager_new (GeditWindow *window)
 	                     NULL);
 }
 
-InfcNotePlugin *
-gedit_collaboration_manager_get_note_plugin (GeditCollaborationManager *manager)
-{
-	g_return_val_if_fail (GEDIT_COLLABORATION_IS_MANAGER (manager), NULL);
-
-	return &(manager->priv->note_plugin);
-}
-
 static void
 on_join_user_request_finished (InfcUserRequest *request,
                                InfUser         *user,
@@ -438,6 +1094,7 @@ on_join_user_request_finished (InfcUserRequest *request,
 	GeditView *view;
 	GeditDocument *doc;
 	GeditCollaborationUndoManager *undo_manager;
+	guint latency;
 
 	session = infc_session_proxy_get_session (subscription->proxy);
 	buffer = inf_session_get_buffer (session);
@@ -464,6 +1121,23 @@ on_join_user_request_finished (InfcUserRequest *request,
 
 	g_object_unref (undo_manager);
 
+	/* Merge fast typing into fewer requests */
+	latency = g_settings_get_uint (gedit_collaboration_core_get_settings (gedit_collaboration_core_get_default ()),
+	                               "coalesce-latency");
+
+	if (latency > 0)
+	{
+		subscription->coalescer =
+			gedit_collaboration_coalescer_new (session,
+			                                   infc_session_proxy_get_connection (subscription->proxy),
+			                                   latency);
+	}
+
+	/* Do not flood the other participants with caret moves */
+	subscription->caret_throttle = gedit_collaboration_caret_throttle_new (session);
+
+	install_remote_tracking (subscription);
+
 	gtk_text_view_set_editable (GTK_TEXT_VIEW (view), TRUE);
 	gdk_window_set_cursor (gtk_widget_get_window (GTK_WIDGET (view)),
 	                       NULL);
@@ -473,6 +1147,16 @@ static void
 handle_error (GeditCollaborationSubscription *subscription,
               const GError *error)
 {
+	/* The progress area is replaced by the error below, make sure no
+	   pending update touches it anymore */
+	if (subscription->progress_update_id != 0)
+	{
+		g_source_remove (subscription->progress_update_id);
+		subscription->progress_update_id = 0;
+	}
+
+	subscription->progress_area = NULL;
+
 	/* Show the error nicely in the document, and cancel the session,
 	   cleanup, etc */
 	if (subscription->tab)
@@ -690,10 +1374,12 @@ on_synchronization_complete (InfSession       *session,
 
 	gedit_tab_set_info_bar (subscription->tab, NULL);
 
+	subscription->synchronized = TRUE;
+	hide_snapshot (subscription, TRUE);
+
 	/* Now guess with the content too */
 	content_type = guess_content_type (subscription);
-	gedit_document_set_content_type (gedit_tab_get_document (subscription->tab),
-	                                 content_type);
+	end_bulk_sync (subscription, content_type);
 	g_free (content_type);
 
 	subscription->progress_area = NULL;
@@ -701,6 +1387,16 @@ on_synchronization_complete (InfSession       *session,
 	g_timer_destroy (subscription->progress_timer);
 	subscription->progress_timer = NULL;
 
+	if (subscription->progress_update_id != 0)
+	{
+		g_source_remove (subscription->progress_update_id);
+		subscription->progress_update_id = 0;
+	}
+
+	g_signal_handler_disconnect (subscription->document,
+	                             subscription->signal_handlers[DOCUMENT_INSERT_TEXT]);
+	subscription->signal_handlers[DOCUMENT_INSERT_TEXT] = 0;
+
 	subscription->user_store = gedit_collaboration_user_store_new (inf_session_get_user_table (session),
 	                                                               TRUE);
 	request_join (subscription, NULL);
@@ -715,6 +1411,88 @@ on_progress_response (GeditCollaborationSubscription *subscription)
 	                        subscription->tab);
 }
 
+static gchar *
+format_remaining_time (gdouble seconds)
+{
+	gint remaining = (gint)(seconds + 0.5);
+
+	if (remaining < 60)
+	{
+		return g_strdup_printf (ngettext ("about %d second remaining",
+		                                  "about %d seconds remaining",
+		                                  remaining),
+		                        remaining);
+	}
+	else
+	{
+		remaining = (remaining + 30) / 60;
+
+		return g_strdup_printf (ngettext ("about %d minute remaining",
+		                                  "about %d minutes remaining",
+		                                  remaining),
+		                        remaining);
+	}
+}
+
+static gboolean
+update_progress (GeditCollaborationSubscription *subscription)
+{
+	GeditCollaborationDocumentMessage *msg;
+	gdouble fraction = subscription->progress_fraction;
+	gdouble elapsed;
+	guint64 bytes;
+	gchar *text = NULL;
+
+	subscription->progress_update_id = 0;
+
+	msg = GEDIT_COLLABORATION_DOCUMENT_MESSAGE (subscription->progress_area);
+	gedit_collaboration_document_message_update (msg, fraction);
+
+	elapsed = g_timer_elapsed (subscription->progress_timer, NULL) -
+	          subscription->progress_start_time;
+
+	bytes = subscription->progress_bytes - subscription->progress_start_bytes;
+
+	if (elapsed > 0 && bytes > 0)
+	{
+		gchar *size;
+		gchar *remaining;
+
+		size = g_format_size_for_display ((goffset)(bytes / elapsed));
+
+		if (fraction > 0)
+		{
+			remaining = format_remaining_time (elapsed * (1 - fraction) / fraction);
+
+			/* Translators: the first %s is a transfer rate (e.g. 120 kB),
+			   the second the remaining time */
+			text = g_strdup_printf (_("%s/s, %s"), size, remaining);
+			g_free (remaining);
+		}
+		else
+		{
+			text = g_strdup_printf (_("%s/s"), size);
+		}
+
+		g_free (size);
+	}
+
+	gedit_collaboration_document_message_set_progress_text (msg, text);
+	g_free (text);
+
+	return FALSE;
+}
+
+static void
+on_document_insert_text (GtkTextBuffer                  *buffer,
+                         GtkTextIter                    *location,
+                         gchar                          *text,
+                         gint                            len,
+                         GeditCollaborationSubscription *subscription)
+{
+	subscription->progress_bytes += len;
+}
+
 static void
 on_synchronization_progress (InfSession       *session,
                              InfXmlConnection *connection,
@@ -723,17 +1501,24 @@ on_synchronization_progress (InfSession       *session,
 {
 	if (subscription->progress_area != NULL)
 	{
-		GeditCollaborationDocumentMessage *msg;
-		gdouble fraction;
-
-		fraction = (progress - subscription->progress_start) / (1 - subscription->progress_start);
+		subscription->progress_fraction =
+			(progress - subscription->progress_start) / (1 - subscription->progress_start);
 
-		msg = GEDIT_COLLABORATION_DOCUMENT_MESSAGE (subscription->progress_area);
-		gedit_collaboration_document_message_update (msg, fraction);
+		/* Progress can be reported thousands of times per second, only
+		   redraw the progress bar at most once per frame */
+		if (subscription->progress_update_id == 0)
+		{
+			subscription->progress_update_id =
+				g_timeout_add (PROGRESS_UPDATE_INTERVAL,
+				               (GSourceFunc)update_progress,
+				               subscription);
+		}
 	}
 	else if (g_timer_elapsed (subscription->progress_timer, NULL) > 0.5 && progress < 0.5)
 	{
 		subscription->progress_start = progress;
+		subscription->progress_start_time = g_timer_elapsed (subscription->progress_timer, NULL);
+		subscription->progress_start_bytes = subscription->progress_bytes;
 		subscription->progress_area =
 			gedit_collaboration_document_message_new_progress (_("Synchronizing document"),
 			                                                   _("Please wait while the shared document is being synchronized"));
@@ -754,6 +1539,10 @@ on_subscribe_request_failed (InfcNodeRequest *request,
                              const GError    *error,
                              GeditCollaborationSubscription    *subscription)
 {
+	gedit_collaboration_core_cancel_subscription (gedit_collaboration_core_get_default (),
+	                                              infc_browser_get_connection (subscription->browser),
+	                                              subscription->manager);
+
 	handle_error (subscription, error);
 }
 
@@ -799,7 +1588,6 @@ on_subscribe_request_finished (InfcNodeRequest *request,
 	GeditCollaborationManager *manager = subscription->manager;
 	GeditView *view;
 	GeditDocument *doc;
-	gchar *content_type;
 	const gchar *name;
 
 	proxy = infc_browser_iter_get_session (subscription->browser, iter);
@@ -818,10 +1606,9 @@ on_subscribe_request_finished (InfcNodeRequest *request,
 
 	name = infc_browser_iter_get_name (subscription->browser, &subscription->iter);
 
-	/* First guess the content type just from the name */
-	content_type = g_content_type_guess (name, NULL, 0, NULL);
-	gedit_document_set_content_type (doc, content_type);
-	g_free (content_type);
+	/* First guess the content type just from the name, it is only
+	   applied once the synchronization is done */
+	subscription->content_type = g_content_type_guess (name, NULL, 0, NULL);
 
 	gtk_source_buffer_begin_not_undoable_action (GTK_SOURCE_BUFFER (doc));
 	gtk_text_buffer_begin_user_action (GTK_TEXT_BUFFER (doc));
@@ -830,6 +1617,21 @@ on_subscribe_request_finished (InfcNodeRequest *request,
 
 	gedit_document_set_short_name_for_display (doc, name);
 
+	subscription->document = g_object_ref (doc);
+	begin_bulk_sync (subscription);
+
+	subscription->signal_handlers[DOCUMENT_INSERT_TEXT] =
+		g_signal_connect (doc,
+		                  "insert-text",
+		                  G_CALLBACK (on_document_insert_text),
+		                  subscription);
+
+	subscription->snapshot_filename = snapshot_filename (subscription->browser,
+	                                                     &subscription->iter);
+
+	/* Show what we had last time while the real content comes in */
+	load_snapshot (subscription);
+
 	subscription->signal_handlers[STYLE_SET] =
 		g_signal_connect (view,
 		                  "style-set",
@@ -873,6 +1675,30 @@ on_subscribe_request_finished (InfcNodeRequest *request,
 		                   subscription);
 }
 
+static GeditCollaborationSubscription *
+find_subscription (InfcSessionProxy *proxy)
+{
+	GSList *item;
+
+	item = gedit_collaboration_core_get_managers (gedit_collaboration_core_get_default ());
+
+	for (; item; item = g_slist_next (item))
+	{
+		GeditCollaborationManager *manager = item->data;
+		GeditCollaborationSubscription *subscription;
+
+		subscription = g_hash_table_lookup (manager->priv->subscription_map,
+		                                    proxy);
+
+		if (subscription != NULL)
+		{
+			return subscription;
+		}
+	}
+
+	return NULL;
+}
+
 InfcNodeRequest *
 gedit_collaboration_manager_subscribe (GeditCollaborationManager *manager,
                                        GeditCollaborationUser    *user,
@@ -893,14 +1719,15 @@ gedit_collaboration_manager_subscribe (GeditCollaborationManager *manager,
 
 	if (proxy != NULL)
 	{
-		/* Is already subscribed */
-		subscription = g_hash_table_lookup (manager->priv->subscription_map,
-		                                    proxy);
+		/* Is already subscribed, possibly in another window */
+		subscription = find_subscription (proxy);
 
 		if (subscription)
 		{
-			gedit_window_set_active_tab (manager->priv->window,
-			                             subscription->tab);
+			GeditWindow *window = subscription->manager->priv->window;
+
+			gedit_window_set_active_tab (window, subscription->tab);
+			gtk_window_present (GTK_WINDOW (window));
 		}
 
 		return NULL;
@@ -913,6 +1740,12 @@ gedit_collaboration_manager_subscribe (GeditCollaborationManager *manager,
 	}
 
 	connection = infc_browser_get_connection (browser);
+
+	/* Make sure the session ends up in this window */
+	gedit_collaboration_core_push_subscription (gedit_collaboration_core_get_default (),
+	                                            connection,
+	                                            manager);
+
 	request = infc_browser_iter_subscribe_session (browser, iter);
 
 	subscription = g_slice_new0 (GeditCollaborationSubscription);
@@ -996,6 +1829,180 @@ gedit_collaboration_subscription_get_user_store (GeditCollaborationSubscription
 	return subscription->user_store;
 }
 
+typedef struct
+{
+	guint users;
+	guint available_users;
+	guint requests;
+	gsize text_size;
+} MemoryReport;
+
+/* Size in bytes of the text held by an operation */
+static gsize
+get_operation_text_size (InfAdoptedOperation *operation)
+{
+	InfTextChunk *chunk = NULL;
+	InfTextChunkIter iter;
+	gsize size = 0;
+
+	if (INF_TEXT_IS_DEFAULT_INSERT_OPERATION (operation))
+	{
+		chunk = inf_text_default_insert_operation_get_chunk (INF_TEXT_DEFAULT_INSERT_OPERATION (operation));
+	}
+	else if (INF_TEXT_IS_DEFAULT_DELETE_OPERATION (operation))
+	{
+		chunk = inf_text_default_delete_operation_get_chunk (INF_TEXT_DEFAULT_DELETE_OPERATION (operation));
+	}
+
+	if (chunk != NULL && inf_text_chunk_iter_init (chunk, &iter))
+	{
+		do
+		{
+			size += inf_text_chunk_iter_get_bytes (&iter);
+		} while (inf_text_chunk_iter_next (&iter));
+	}
+
+	return size;
+}
+
+static void
+add_user_to_report (InfUser  *user,
+                    gpointer  data)
+{
+	MemoryReport *report = data;
+	InfAdoptedRequestLog *log;
+	guint begin;
+	guint end;
+	guint i;
+
+	++report->users;
+
+	if (inf_user_get_status (user) != INF_USER_UNAVAILABLE)
+	{
+		++report->available_users;
+	}
+
+	log = inf_adopted_user_get_request_log (INF_ADOPTED_USER (user));
+
+	begin = inf_adopted_request_log_get_begin (log);
+	end = inf_adopted_request_log_get_end (log);
+
+	report->requests += end - begin;
+
+	for (i = begin; i < end; ++i)
+	{
+		InfAdoptedRequest *request = inf_adopted_request_log_get_request (log, i);
+
+		if (inf_adopted_request_get_request_type (request) == INF_ADOPTED_REQUEST_DO)
+		{
+			report->text_size += get_operation_text_size (inf_adopted_request_get_operation (request));
+		}
+	}
+}
+
+/**
+ * gedit_collaboration_subscription_get_memory_report:
+ * @subscription: a #GeditCollaborationSubscription
+ *
+ * Describes what the session of @subscription keeps in memory: the users,
+ * the requests in their logs and the text those hold, the document, and
+ * how often incoming data was held back.
+ *
+ * Returns: a newly allocated, human readable report
+ */
+gchar *
+gedit_collaboration_subscription_get_memory_report (GeditCollaborationSubscription *subscription)
+{
+	InfSession *session;
+	MemoryReport report = {0,};
+	guint max_log_size;
+	gint chars;
+	gchar *size;
+	GString *text;
+
+	session = infc_session_proxy_get_session (subscription->proxy);
+
+	inf_user_table_foreach_user (inf_session_get_user_table (session),
+	                             add_user_to_report,
+	                             &report);
+
+	g_object_get (session, "max-total-log-size", &max_log_size, NULL);
+	chars = gtk_text_buffer_get_char_count (GTK_TEXT_BUFFER (subscription->document));
+
+	text = g_string_new (NULL);
+
+	g_string_append_printf (text,
+	                        ngettext ("%u user (%u available)",
+	                                  "%u users (%u available)",
+	                                  report.users),
+	                        report.users,
+	                        report.available_users);
+
+	/* Caret and selection changes are not counted, the user list does not
+	   show them */
+	if (subscription->user_store != NULL)
+	{
+		guint changes;
+
+		changes = gedit_collaboration_user_store_get_notify_count (subscription->user_store);
+
+		g_string_append_c (text, '\n');
+		g_string_append_printf (text,
+		                        ngettext ("%u user change shown in the user list",
+		                                  "%u user changes shown in the user list",
+		                                  changes),
+		                        changes);
+	}
+
+	size = g_format_size_for_display (report.text_size);
+
+	/* Translators: the %s is a size, e.g. 12 kB */
+	g_string_append_c (text, '\n');
+	g_string_append_printf (text,
+	                        ngettext ("%u request in the log (at most %u), holding %s of text",
+	                                  "%u requests in the log (at most %u), holding %s of text",
+	                                  report.requests),
+	                        report.requests,
+	                        max_log_size,
+	                        size);
+
+	g_free (size);
+
+	g_string_append_c (text, '\n');
+	g_string_append_printf (text,
+	                        ngettext ("%u redraw for %u changes of other users",
+	                                  "%u redraws for %u changes of other users",
+	                                  subscription->redraws),
+	                        subscription->redraws,
+	                        subscription->remote_operations);
+
+	g_string_append_c (text, '\n');
+	g_string_append_printf (text,
+	                        ngettext ("%d character in the document",
+	                                  "%d characters in the document",
+	                                  chars),
+	                        chars);
+
+	if (subscription->receive_throttle != NULL)
+	{
+		guint deferred;
+
+		deferred = gedit_collaboration_receive_throttle_get_n_deferred (subscription->receive_throttle);
+
+		/* Translators: the %.1f is the longest time in milliseconds
+		   incoming data was handled without a break */
+		g_string_append_c (text, '\n');
+		g_string_append_printf (text,
+		                        ngettext ("Incoming data deferred %u time, longest stall %.1f ms",
+		                                  "Incoming data deferred %u times, longest stall %.1f ms",
+		                                  deferred),
+		                        deferred,
+		                        gedit_collaboration_receive_throttle_get_max_stall (subscription->receive_throttle));
+	}
+
+	return g_string_free (text, FALSE);
+}
+
 void
 _gedit_collaboration_manager_register_type (GTypeModule *type_module)
 {
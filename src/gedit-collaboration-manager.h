@@ -43,7 +43,13 @@ void _gedit_collaboration_manager_register_type (GTypeModule *type_module);
 
 GeditCollaborationManager *gedit_collaboration_manager_new (GeditWindow *window);
 
-InfcNotePlugin *gedit_collaboration_manager_get_note_plugin (GeditCollaborationManager *manager);
+InfSession *gedit_collaboration_manager_create_session (GeditCollaborationManager   *manager,
+                                                        InfIo                       *io,
+                                                        InfCommunicationManager     *communication_manager,
+                                                        InfSessionStatus             status,
+                                                        InfCommunicationJoinedGroup *sync_group,
+                                                        InfXmlConnection            *sync_connection);
+
 InfcNodeRequest *gedit_collaboration_manager_subscribe (GeditCollaborationManager *manager,
                                                         GeditCollaborationUser    *user,
                                                         InfcBrowser               *browser,
@@ -59,6 +65,8 @@ gedit_collaboration_manager_tab_get_subscription (GeditCollaborationManager *man
 GeditCollaborationUserStore *
 gedit_collaboration_subscription_get_user_store (GeditCollaborationSubscription *subscription);
 
+gchar *gedit_collaboration_subscription_get_memory_report (GeditCollaborationSubscription *subscription);
+
 G_END_DECLS
 
 #endif /* __GEDIT_COLLABORATION_MANAGER_H__ */
@@ -0,0 +1,658 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-path-index.h"
+
+#include <string.h>
+
+#define GEDIT_COLLABORATION_PATH_INDEX_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_PATH_INDEX, GeditCollaborationPathIndexPrivate))
+
+/* Scores of a matching query character */
+#define SCORE_MATCH 1
+#define SCORE_CONSECUTIVE 5
+#define SCORE_BOUNDARY 3
+
+/* Bonus when the whole query matches in the document name */
+#define SCORE_NAME 20
+
+typedef struct
+{
+	InfcBrowser *browser;
+	gchar *server;
+
+	/* node id -> PathEntry */
+	GHashTable *nodes;
+} IndexedBrowser;
+
+typedef struct
+{
+	IndexedBrowser *indexed;
+	InfcBrowserIter iter;
+
+	gchar *path;
+	gchar *folded;
+	guint length;
+	guint name_offset;
+
+	/* Bytes occurring in the folded path, to reject most entries
+	   without looking at the path */
+	guint64 mask;
+
+	/* Position in the entries array */
+	guint position;
+} PathEntry;
+
+typedef struct
+{
+	PathEntry *entry;
+	gint score;
+} PathMatch;
+
+struct _GeditCollaborationPathIndexPrivate
+{
+	/* InfcBrowser -> IndexedBrowser */
+	GHashTable *browsers;
+
+	/* All documents, unordered */
+	GPtrArray *entries;
+	guint generation;
+
+	/* Everything matching the last query, a query extending it only
+	   needs to look at these */
+	gchar *last_query;
+	guint last_generation;
+	GPtrArray *last_matches;
+};
+
+G_DEFINE_DYNAMIC_TYPE (GeditCollaborationPathIndex,
+                       gedit_collaboration_path_index,
+                       G_TYPE_OBJECT)
+
+static guint64
+make_mask (const gchar *text)
+{
+	guint64 mask = 0;
+
+	for (; *text; ++text)
+	{
+		mask |= G_GUINT64_CONSTANT (1) << ((guchar)*text & 63);
+	}
+
+	return mask;
+}
+
+static void
+path_entry_free (PathEntry *entry)
+{
+	g_free (entry->path);
+	g_free (entry->folded);
+
+	g_slice_free (PathEntry, entry);
+}
+
+static void
+add_entry (GeditCollaborationPathIndex *index,
+           IndexedBrowser              *indexed,
+           InfcBrowserIter             *iter)
+{
+	PathEntry *entry;
+	gchar *name;
+
+	if (g_hash_table_lookup (indexed->nodes, GUINT_TO_POINTER (iter->node_id)) != NULL)
+	{
+		return;
+	}
+
+	entry = g_slice_new0 (PathEntry);
+
+	entry->indexed = indexed;
+	entry->iter = *iter;
+	entry->path = infc_browser_iter_get_path (indexed->browser, iter);
+	entry->folded = g_utf8_casefold (entry->path, -1);
+	entry->length = strlen (entry->folded);
+	entry->mask = make_mask (entry->folded);
+
+	name = strrchr (entry->folded, '/');
+	entry->name_offset = name ? name - entry->folded + 1 : 0;
+
+	entry->position = index->priv->entries->len;
+	g_ptr_array_add (index->priv->entries, entry);
+
+	g_hash_table_insert (indexed->nodes,
+	                     GUINT_TO_POINTER (iter->node_id),
+	                     entry);
+
+	++index->priv->generation;
+}
+
+static void
+unlink_entry (GeditCollaborationPathIndex *index,
+              PathEntry                   *entry)
+{
+	GPtrArray *entries = index->priv->entries;
+	PathEntry *last;
+
+	/* The last entry takes its place */
+	last = g_ptr_array_index (entries, entries->len - 1);
+	last->position = entry->position;
+
+	g_ptr_array_remove_index_fast (entries, entry->position);
+
+	++index->priv->generation;
+}
+
+static void
+add_tree (GeditCollaborationPathIndex *index,
+          IndexedBrowser              *indexed,
+          InfcBrowserIter             *iter)
+{
+	InfcBrowserIter child;
+
+	if (!infc_browser_iter_is_subdirectory (indexed->browser, iter))
+	{
+		add_entry (index, indexed, iter);
+		return;
+	}
+
+	if (!infc_browser_iter_get_explored (indexed->browser, iter))
+	{
+		return;
+	}
+
+	child = *iter;
+
+	if (!infc_browser_iter_get_child (indexed->browser, &child))
+	{
+		return;
+	}
+
+	do
+	{
+		add_tree (index, indexed, &child);
+	} while (infc_browser_iter_get_next (indexed->browser, &child));
+}
+
+static void
+on_node_added (InfcBrowser                 *browser,
+               InfcBrowserIter             *iter,
+               GeditCollaborationPathIndex *index)
+{
+	IndexedBrowser *indexed;
+
+	indexed = g_hash_table_lookup (index->priv->browsers, browser);
+
+	/* Only documents can be opened, directories are part of their path */
+	if (indexed != NULL && !infc_browser_iter_is_subdirectory (browser, iter))
+	{
+		add_entry (index, indexed, iter);
+	}
+}
+
+static void
+on_node_removed (InfcBrowser                 *browser,
+                 InfcBrowserIter             *iter,
+                 GeditCollaborationPathIndex *index)
+{
+	IndexedBrowser *indexed;
+	PathEntry *entry;
+
+	indexed = g_hash_table_lookup (index->priv->browsers, browser);
+
+	if (indexed == NULL)
+	{
+		return;
+	}
+
+	if (infc_browser_iter_is_subdirectory (browser, iter))
+	{
+		GHashTableIter hiter;
+		gchar *path;
+		gchar *prefix;
+
+		/* Only the directory itself is announced, its documents go
+		   with it */
+		path = infc_browser_iter_get_path (browser, iter);
+		prefix = g_strconcat (path, "/", NULL);
+
+		g_hash_table_iter_init (&hiter, indexed->nodes);
+
+		while (g_hash_table_iter_next (&hiter, NULL, (gpointer *)&entry))
+		{
+			if (g_str_has_prefix (entry->path, prefix))
+			{
+				unlink_entry (index, entry);
+				g_hash_table_iter_remove (&hiter);
+			}
+		}
+
+		g_free (prefix);
+		g_free (path);
+
+		return;
+	}
+
+	entry = g_hash_table_lookup (indexed->nodes,
+	                             GUINT_TO_POINTER (iter->node_id));
+
+	if (entry != NULL)
+	{
+		unlink_entry (index, entry);
+		g_hash_table_remove (indexed->nodes, GUINT_TO_POINTER (iter->node_id));
+	}
+}
+
+static void
+indexed_browser_free (IndexedBrowser *indexed)
+{
+	g_hash_table_destroy (indexed->nodes);
+	g_object_unref (indexed->browser);
+	g_free (indexed->server);
+
+	g_slice_free (IndexedBrowser, indexed);
+}
+
+static void
+remove_indexed_browser (GeditCollaborationPathIndex *index,
+                        IndexedBrowser              *indexed)
+{
+	GHashTableIter hiter;
+	PathEntry *entry;
+
+	g_signal_handlers_disconnect_matched (indexed->browser,
+	                                      G_SIGNAL_MATCH_DATA,
+	                                      0,
+	                                      0,
+	                                      NULL,
+	                                      NULL,
+	                                      index);
+
+	g_hash_table_iter_init (&hiter, indexed->nodes);
+
+	while (g_hash_table_iter_next (&hiter, NULL, (gpointer *)&entry))
+	{
+		unlink_entry (index, entry);
+	}
+
+	g_hash_table_remove (index->priv->browsers, indexed->browser);
+}
+
+/* Greedy subsequence match of query in text, starting at start */
+static gboolean
+match_from (const gchar *text,
+            const gchar *start,
+            const gchar *query,
+            gint        *score)
+{
+	const gchar *p = start;
+	const gchar *previous = NULL;
+	gint s = 0;
+
+	for (; *query; ++query)
+	{
+		p = strchr (p, *query);
+
+		if (p == NULL)
+		{
+			return FALSE;
+		}
+
+		s += SCORE_MATCH;
+
+		if (previous != NULL && p == previous + 1)
+		{
+			s += SCORE_CONSECUTIVE;
+		}
+		else if (p == text || strchr ("/_-. ", p[-1]) != NULL)
+		{
+			s += SCORE_BOUNDARY;
+		}
+
+		previous = p++;
+	}
+
+	*score = s;
+	return TRUE;
+}
+
+static gboolean
+match_entry (PathEntry   *entry,
+             const gchar *query,
+             gint        *score)
+{
+	if (match_from (entry->folded,
+	                entry->folded + entry->name_offset,
+	                query,
+	                score))
+	{
+		*score += SCORE_NAME;
+	}
+	else if (!match_from (entry->folded, entry->folded, query, score))
+	{
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Higher scores first, shorter paths first on equal scores */
+static gboolean
+is_better_match (PathEntry *entry,
+                 gint       score,
+                 PathMatch *match)
+{
+	if (score != match->score)
+	{
+		return score > match->score;
+	}
+
+	return entry->length < match->entry->length;
+}
+
+/* Keeps the best max_results matches, best first */
+static void
+insert_match (PathMatch *best,
+              guint     *n_best,
+              guint      max_results,
+              PathEntry *entry,
+              gint       score)
+{
+	guint i;
+
+	if (*n_best == max_results)
+	{
+		if (!is_better_match (entry, score, &best[max_results - 1]))
+		{
+			return;
+		}
+
+		i = max_results - 1;
+	}
+	else
+	{
+		i = (*n_best)++;
+	}
+
+	for (; i > 0 && is_better_match (entry, score, &best[i - 1]); --i)
+	{
+		best[i] = best[i - 1];
+	}
+
+	best[i].entry = entry;
+	best[i].score = score;
+}
+
+static void
+gedit_collaboration_path_index_dispose (GObject *object)
+{
+	GeditCollaborationPathIndex *index = GEDIT_COLLABORATION_PATH_INDEX (object);
+
+	if (index->priv->browsers)
+	{
+		GList *browsers;
+		GList *item;
+
+		browsers = g_hash_table_get_values (index->priv->browsers);
+
+		for (item = browsers; item; item = g_list_next (item))
+		{
+			remove_indexed_browser (index, item->data);
+		}
+
+		g_list_free (browsers);
+
+		g_hash_table_destroy (index->priv->browsers);
+		index->priv->browsers = NULL;
+	}
+
+	G_OBJECT_CLASS (gedit_collaboration_path_index_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_path_index_finalize (GObject *object)
+{
+	GeditCollaborationPathIndex *index = GEDIT_COLLABORATION_PATH_INDEX (object);
+
+	g_ptr_array_free (index->priv->entries, TRUE);
+	g_ptr_array_free (index->priv->last_matches, TRUE);
+	g_free (index->priv->last_query);
+
+	G_OBJECT_CLASS (gedit_collaboration_path_index_parent_class)->finalize (object);
+}
+
+static void
+gedit_collaboration_path_index_class_init (GeditCollaborationPathIndexClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_path_index_dispose;
+	object_class->finalize = gedit_collaboration_path_index_finalize;
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationPathIndexPrivate));
+}
+
+static void
+gedit_collaboration_path_index_class_finalize (GeditCollaborationPathIndexClass *klass)
+{
+}
+
+static void
+gedit_collaboration_path_index_init (GeditCollaborationPathIndex *self)
+{
+	self->priv = GEDIT_COLLABORATION_PATH_INDEX_GET_PRIVATE (self);
+
+	self->priv->browsers = g_hash_table_new_full (g_direct_hash,
+	                                              g_direct_equal,
+	                                              NULL,
+	                                              (GDestroyNotify)indexed_browser_free);
+
+	self->priv->entries = g_ptr_array_new ();
+	self->priv->last_matches = g_ptr_array_new ();
+}
+
+GeditCollaborationPathIndex *
+gedit_collaboration_path_index_new (void)
+{
+	return g_object_new (GEDIT_COLLABORATION_TYPE_PATH_INDEX, NULL);
+}
+
+/* Indexes the documents of the browser, the ones already explored and the
+   ones added later on */
+void
+gedit_collaboration_path_index_add_browser (GeditCollaborationPathIndex *index,
+                                            InfcBrowser                 *browser,
+                                            const gchar                 *server)
+{
+	IndexedBrowser *indexed;
+	InfcBrowserIter root;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_PATH_INDEX (index));
+	g_return_if_fail (INFC_IS_BROWSER (browser));
+
+	if (g_hash_table_lookup (index->priv->browsers, browser) != NULL)
+	{
+		return;
+	}
+
+	indexed = g_slice_new0 (IndexedBrowser);
+
+	indexed->browser = g_object_ref (browser);
+	indexed->server = g_strdup (server);
+	indexed->nodes = g_hash_table_new_full (g_direct_hash,
+	                                        g_direct_equal,
+	                                        NULL,
+	                                        (GDestroyNotify)path_entry_free);
+
+	g_hash_table_insert (index->priv->browsers, browser, indexed);
+
+	infc_browser_iter_get_root (browser, &root);
+	add_tree (index, indexed, &root);
+
+	g_signal_connect (browser,
+	                  "node-added",
+	                  G_CALLBACK (on_node_added),
+	                  index);
+
+	g_signal_connect (browser,
+	                  "node-removed",
+	                  G_CALLBACK (on_node_removed),
+	                  index);
+}
+
+void
+gedit_collaboration_path_index_remove_browser (GeditCollaborationPathIndex *index,
+                                               InfcBrowser                 *browser)
+{
+	IndexedBrowser *indexed;
+
+	g_return_if_fail (GEDIT_COLLABORATION_IS_PATH_INDEX (index));
+
+	indexed = g_hash_table_lookup (index->priv->browsers, browser);
+
+	if (indexed != NULL)
+	{
+		remove_indexed_browser (index, indexed);
+	}
+}
+
+guint
+gedit_collaboration_path_index_get_size (GeditCollaborationPathIndex *index)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_PATH_INDEX (index), 0);
+
+	return index->priv->entries->len;
+}
+
+/* Calls func for the best max_results documents matching query, best
+   first, and returns the total number of matching documents. The
+   characters of the query have to appear in the path in order, spaces
+   are ignored */
+guint
+gedit_collaboration_path_index_query (GeditCollaborationPathIndex    *index,
+                                      const gchar                    *query,
+                                      guint                           max_results,
+                                      GeditCollaborationPathIndexFunc func,
+                                      gpointer                        user_data)
+{
+	GeditCollaborationPathIndexPrivate *priv;
+	GPtrArray *candidates;
+	GPtrArray *matches;
+	PathMatch *best;
+	guint n_best = 0;
+	gchar *folded;
+	gchar *dest;
+	gchar *src;
+	guint64 mask;
+	guint i;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_PATH_INDEX (index), 0);
+	g_return_val_if_fail (query != NULL, 0);
+
+	priv = index->priv;
+	folded = g_utf8_casefold (query, -1);
+
+	for (src = dest = folded; *src; ++src)
+	{
+		if (*src != ' ')
+		{
+			*dest++ = *src;
+		}
+	}
+
+	*dest = '\0';
+
+	if (*folded == '\0' || max_results == 0)
+	{
+		g_free (folded);
+		return 0;
+	}
+
+	/* While typing, every query extends the previous one and can only
+	   match fewer documents */
+	if (priv->last_query != NULL &&
+	    priv->last_generation == priv->generation &&
+	    g_str_has_prefix (folded, priv->last_query))
+	{
+		candidates = priv->last_matches;
+	}
+	else
+	{
+		candidates = priv->entries;
+	}
+
+	mask = make_mask (folded);
+	matches = g_ptr_array_new ();
+	best = g_new (PathMatch, max_results);
+
+	for (i = 0; i < candidates->len; ++i)
+	{
+		PathEntry *entry = g_ptr_array_index (candidates, i);
+		gint score;
+
+		if ((entry->mask & mask) != mask ||
+		    !match_entry (entry, folded, &score))
+		{
+			continue;
+		}
+
+		g_ptr_array_add (matches, entry);
+		insert_match (best, &n_best, max_results, entry, score);
+	}
+
+	g_ptr_array_free (priv->last_matches, TRUE);
+	priv->last_matches = matches;
+
+	g_free (priv->last_query);
+	priv->last_query = folded;
+	priv->last_generation = priv->generation;
+
+	for (i = 0; i < n_best; ++i)
+	{
+		PathEntry *entry = best[i].entry;
+
+		func (entry->indexed->browser,
+		      entry->iter.node_id,
+		      entry->indexed->server,
+		      entry->path,
+		      user_data);
+	}
+
+	g_free (best);
+
+	return matches->len;
+}
+
+/* Documents can be removed after they were found, so the iter is only
+   handed out while the document is still there */
+gboolean
+gedit_collaboration_path_index_lookup (GeditCollaborationPathIndex *index,
+                                       InfcBrowser                 *browser,
+                                       guint                        node_id,
+                                       InfcBrowserIter             *iter)
+{
+	IndexedBrowser *indexed;
+	PathEntry *entry;
+
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_PATH_INDEX (index), FALSE);
+
+	indexed = g_hash_table_lookup (index->priv->browsers, browser);
+
+	if (indexed == NULL)
+	{
+		return FALSE;
+	}
+
+	entry = g_hash_table_lookup (indexed->nodes, GUINT_TO_POINTER (node_id));
+
+	if (entry == NULL)
+	{
+		return FALSE;
+	}
+
+	*iter = entry->iter;
+	return TRUE;
+}
+
+void
+_gedit_collaboration_path_index_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_path_index_register_type (type_module);
+}
@@ -0,0 +1,67 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_PATH_INDEX_H__
+#define __GEDIT_COLLABORATION_PATH_INDEX_H__
+
+#include <glib-object.h>
+#include <libinfinity/client/infc-browser.h>
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_PATH_INDEX		(gedit_collaboration_path_index_get_type ())
+#define GEDIT_COLLABORATION_PATH_INDEX(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_PATH_INDEX, GeditCollaborationPathIndex))
+#define GEDIT_COLLABORATION_PATH_INDEX_CONST(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_PATH_INDEX, GeditCollaborationPathIndex const))
+#define GEDIT_COLLABORATION_PATH_INDEX_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_PATH_INDEX, GeditCollaborationPathIndexClass))
+#define GEDIT_COLLABORATION_IS_PATH_INDEX(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_PATH_INDEX))
+#define GEDIT_COLLABORATION_IS_PATH_INDEX_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_PATH_INDEX))
+#define GEDIT_COLLABORATION_PATH_INDEX_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_PATH_INDEX, GeditCollaborationPathIndexClass))
+
+typedef struct _GeditCollaborationPathIndex		GeditCollaborationPathIndex;
+typedef struct _GeditCollaborationPathIndexClass	GeditCollaborationPathIndexClass;
+typedef struct _GeditCollaborationPathIndexPrivate	GeditCollaborationPathIndexPrivate;
+
+struct _GeditCollaborationPathIndex
+{
+	GObject parent;
+
+	GeditCollaborationPathIndexPrivate *priv;
+};
+
+struct _GeditCollaborationPathIndexClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_path_index_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_path_typedef void (*GeditCollaborationPathIndexFunc) (InfcBrowser *browser,
+                                                guint        node_id,
+                                                const gchar *server,
+                                                const gchar *path,
+                                                gpointer     user_data);
+
+GeditCollaborationPathIndex *gedit_collaboration_path_index_new (void);
+
+void gedit_collaboration_path_index_add_browser (GeditCollaborationPathIndex *index,
+                                                 InfcBrowser                 *browser,
+                                                 const gchar                 *server);
+void gedit_collaboration_path_index_remove_browser (GeditCollaborationPathIndex *index,
+                                                    InfcBrowser                 *browser);
+
+guint gedit_collaboration_path_index_get_size (GeditCollaborationPathIndex *index);
+
+guint gedit_collaboration_path_index_query (GeditCollaborationPathIndex    *index,
+                                            const gchar                    *query,
+                                            guint                           max_results,
+                                            GeditCollaborationPathIndexFunc func,
+                                            gpointer                        user_data);
+
+gboolean gedit_collaboration_path_index_lookup (GeditCollaborationPathIndex *index,
+                                                InfcBrowser                 *browser,
+                                                guint                        node_id,
+                                                InfcBrowserIter             *iter);
+
+     GtkTreeIter                      *second);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_PATH_INDEX_H__ */
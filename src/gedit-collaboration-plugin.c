@@ -32,13 +32,24 @@
 #include "gedit-collaboration-bookmarks.h"
 #include "gedit-collaboration-bookmark.h"
 #include "gedit-collaboration-bookmark-dialog.h"
+#include "gedit-collaboration-connector.h"
+#include "gedit-collaboration-core.h"
+#include "gedit-collaboration-chat-log.h"
 #include "gedit-collaboration-manager.h"
 #include "gedit-collaboration-color-button.h"
 #include "gedit-collaboration-document-message.h"
 #include "gedit-collaboration.h"
 #include "gedit-collaboration-undo-manager.h"
+#include "gedit-collaboration-coalescer.h"
+#include "gedit-collaboration-caret-throttle.h"
+#include "gedit-collaboration-receive-throttle.h"
 #include "gedit-collaboration-user-store.h"
 #include "gedit-collaboration-hue-renderer.h"
+#include "gedit-collaboration-collation-cache.h"
+#include "gedit-collaboration-browser-model.h"
+#include "gedit-collaboration-listing-cache.h"
+#include "gedit-collaboration-locator.h"
+#include "gedit-collaboration-path-index.h"
 
 #include <libinfinity/common/inf-init.h>
 
@@ -51,6 +62,7 @@ static GeditCollaborationPlugin *plugin_instance = 0;
 struct _GeditCollaborationPluginPrivate
 {
 	GeditApp *app;
+	GeditCollaborationCore *core;
 
 	GtkWidget *dialog_configuration;
 	GtkEntry *entry_name;
@@ -80,11 +92,22 @@ G_DEFINE_DYNAMIC_TYPE_EXTENDED (GeditCollaborationPlugin,
                                 _gedit_collaboration_bookmark_register_type (type_module); \
                                 _gedit_collaboration_bookmarks_register_type (type_module); \
                                 _gedit_collaboration_bookmark_dialog_register_type (type_module); \
+                                _gedit_collaboration_connector_register_type (type_module); \
+                                _gedit_collaboration_core_register_type (type_module); \
+                                _gedit_collaboration_chat_log_register_type (type_module); \
                                 _gedit_collaboration_color_button_register_type (type_module); \
                                 _gedit_collaboration_document_message_register_type (type_module); \
                                 _gedit_collaboration_undo_manager_register_type (type_module); \
+                                _gedit_collaboration_coalescer_register_type (type_module); \
+                                _gedit_collaboration_caret_throttle_register_type (type_module); \
+                                _gedit_collaboration_receive_throttle_register_type (type_module); \
                                 _gedit_collaboration_user_store_register_type (type_module); \
                                 _gedit_collaboration_hue_renderer_register_type (type_module); \
+                                _gedit_collaboration_collation_cache_register_type (type_module); \
+                                _gedit_collaboration_browser_model_register_type (type_module); \
+                                _gedit_collaboration_listing_cache_register_type (type_module); \
+                                _gedit_collaboration_locator_register_type (type_module); \
+                                _gedit_collaboration_path_index_register_type (type_module); \
 )
 
 static void
@@ -165,13 +188,22 @@ peas_gtk_configurable_iface_init (PeasGtkConfigurableInterface *iface)
 static void
 gedit_collaboration_plugin_finalize (GObject *object)
 {
+	GeditCollaborationPlugin *plugin = GEDIT_COLLABORATION_PLUGIN (object);
+
+	if (plugin->priv->core)
+	{
+		g_object_unref (plugin->priv->core);
+	}
+
 	G_OBJECT_CLASS (gedit_collaboration_plugin_parent_class)->finalize (object);
 }
 
 static void
 gedit_collaboration_plugin_constructed (GObject *object)
 {
+	GeditCollaborationPlugin *plugin = GEDIT_COLLABORATION_PLUGIN (object);
 	gchar *filename;
+	gchar *datadir;
 
 	filename = g_build_filename (g_get_user_config_dir (),
 	                             "gedit",
@@ -181,6 +213,11 @@ gedit_collaboration_plugin_constructed (GObject *object)
 	                             NULL);
 
 	gedit_collaboration_bookmarks_initialize (filename);
+
+	/* Connections are shared by all windows */
+	datadir = peas_extension_base_get_data_dir (PEAS_EXTENSION_BASE (plugin));
+	plugin->priv->core = gedit_collaboration_core_new (datadir);
+	g_free (datadir);
 }
 
 static GObject *
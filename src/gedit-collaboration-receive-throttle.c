@@ -0,0 +1,521 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#include "gedit-collaboration-receive-throttle.h"
+
+#include <libinfinity/common/inf-xmpp-connection.h>
+#include <libinfinity/common/inf-tcp-connection.h>
+
+#define GEDIT_COLLABORATION_RECEIVE_THROTTLE_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_RECEIVE_THROTTLE, GeditCollaborationReceiveThrottlePrivate))
+
+/* Time (in microseconds) incoming data may be processed before the main
+   loop gets to handle anything else */
+#define RECEIVE_BUDGET (8 * G_USEC_PER_SEC / 1000)
+
+typedef struct
+{
+	GeditCollaborationReceiveThrottle *throttle;
+	InfIoWatch *watch;
+	InfIoEvent events;
+
+	InfIoWatchFunc func;
+	gpointer user_data;
+	GDestroyNotify notify;
+} Watch;
+
+struct _GeditCollaborationReceiveThrottlePrivate
+{
+	InfIo *io;
+	GSList *watches;
+
+	gboolean behind;
+	gint64 spent;
+	guint reset_id;
+	guint resume_id;
+
+	guint n_deferred;
+	gint64 max_stall;
+};
+
+/* Properties */
+enum
+{
+	PROP_0,
+	PROP_IO,
+	PROP_BEHIND
+};
+
+static void gedit_collaboration_receive_throttle_iface_init (InfIoIface *iface);
+
+G_DEFINE_DYNAMIC_TYPE_EXTENDED (GeditCollaborationReceiveThrottle,
+                                gedit_collaboration_receive_throttle,
+                                G_TYPE_OBJECT,
+                                0,
+                                G_IMPLEMENT_INTERFACE_DYNAMIC (INF_TYPE_IO,
+                                                               gedit_collaboration_receive_throttle_iface_init))
+
+static InfIoEvent
+watch_events (Watch *watch)
+{
+	/* Data left in the socket holds back the server through the tcp
+	   window, and is read in order once the throttle lets go */
+	if (watch->throttle->priv->behind)
+	{
+		return watch->events & ~INF_IO_INCOMING;
+	}
+
+	return watch->events;
+}
+
+static void
+update_watches (GeditCollaborationReceiveThrottle *throttle)
+{
+	GSList *item;
+
+	for (item = throttle->priv->watches; item; item = g_slist_next (item))
+	{
+		Watch *watch = item->data;
+
+		inf_io_update_watch (throttle->priv->io,
+		                     watch->watch,
+		                     watch_events (watch));
+	}
+}
+
+static gboolean on_resume (GeditCollaborationReceiveThrottle *throttle);
+
+static void
+set_behind (GeditCollaborationReceiveThrottle *throttle,
+            gboolean                           behind)
+{
+	if (throttle->priv->behind == behind)
+	{
+		return;
+	}
+
+	throttle->priv->behind = behind;
+	update_watches (throttle);
+
+	if (behind)
+	{
+		++throttle->priv->n_deferred;
+
+		/* Let input and drawing go first */
+		throttle->priv->resume_id =
+			g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+			                 (GSourceFunc)on_resume,
+			                 throttle,
+			                 NULL);
+	}
+	else if (throttle->priv->resume_id != 0)
+	{
+		g_source_remove (throttle->priv->resume_id);
+		throttle->priv->resume_id = 0;
+	}
+
+	g_object_notify (G_OBJECT (throttle), "behind");
+}
+
+static gboolean
+on_resume (GeditCollaborationReceiveThrottle *throttle)
+{
+	/* The main loop went idle, so a new budget starts */
+	throttle->priv->resume_id = 0;
+	throttle->priv->spent = 0;
+
+	set_behind (throttle, FALSE);
+
+	return FALSE;
+}
+
+static gboolean
+on_reset (GeditCollaborationReceiveThrottle *throttle)
+{
+	throttle->priv->reset_id = 0;
+	throttle->priv->spent = 0;
+
+	return FALSE;
+}
+
+static void
+on_watch (InfNativeSocket *socket,
+          InfIoEvent       event,
+          gpointer         user_data)
+{
+	Watch *watch = user_data;
+	GeditCollaborationReceiveThrottle *throttle = watch->throttle;
+	gint64 start;
+
+	if (throttle->priv->behind && (event & INF_IO_ERROR))
+	{
+		/* The connection is going away, let it read the rest of the
+		   stream first. The error is reported again along with it */
+		set_behind (throttle, FALSE);
+		return;
+	}
+
+	if (!(event & INF_IO_INCOMING))
+	{
+		watch->func (socket, event, watch->user_data);
+		return;
+	}
+
+	/* The watch may be removed meanwhile, and the tcp connection holding
+	   the throttle may go away with it */
+	g_object_ref (throttle);
+
+	start = g_get_monotonic_time ();
+	watch->func (socket, event, watch->user_data);
+
+	throttle->priv->spent += g_get_monotonic_time () - start;
+	throttle->priv->max_stall = MAX (throttle->priv->max_stall,
+	                                 throttle->priv->spent);
+
+	if (throttle->priv->spent >= RECEIVE_BUDGET)
+	{
+		/* Out of budget, stop reading until the main loop went idle */
+		set_behind (throttle, TRUE);
+	}
+	else if (throttle->priv->reset_id == 0)
+	{
+		throttle->priv->reset_id =
+			g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+			                 (GSourceFunc)on_reset,
+			                 throttle,
+			                 NULL);
+	}
+
+	g_object_unref (throttle);
+}
+
+static void
+watch_free (Watch *watch)
+{
+	inf_io_remove_watch (watch->throttle->priv->io, watch->watch);
+
+	if (watch->notify)
+	{
+		watch->notify (watch->user_data);
+	}
+
+	g_slice_free (Watch, watch);
+}
+
+static InfIoWatch *
+receive_throttle_add_watch_impl (InfIo           *io,
+                                 InfNativeSocket *socket,
+                                 InfIoEvent       events,
+                                 InfIoWatchFunc   func,
+                                 gpointer         user_data,
+                                 GDestroyNotify   notify)
+{
+	GeditCollaborationReceiveThrottle *throttle = GEDIT_COLLABORATION_RECEIVE_THROTTLE (io);
+	Watch *watch;
+
+	watch = g_slice_new (Watch);
+
+	watch->throttle = throttle;
+	watch->events = events;
+	watch->func = func;
+	watch->user_data = user_data;
+	watch->notify = notify;
+
+	watch->watch = inf_io_add_watch (throttle->priv->io,
+	                                 socket,
+	                                 watch_events (watch),
+	                                 on_watch,
+	                                 watch,
+	                                 NULL);
+
+	if (watch->watch == NULL)
+	{
+		g_slice_free (Watch, watch);
+		return NULL;
+	}
+
+	throttle->priv->watches = g_slist_prepend (throttle->priv->watches,
+	                                           watch);
+
+	return (InfIoWatch *)watch;
+}
+
+static void
+receive_throttle_update_watch_impl (InfIo      *io,
+                                    InfIoWatch *io_watch,
+                                    InfIoEvent  events)
+{
+	Watch *watch = (Watch *)io_watch;
+
+	watch->events = events;
+
+	inf_io_update_watch (watch->throttle->priv->io,
+	                     watch->watch,
+	                     watch_events (watch));
+}
+
+static void
+receive_throttle_remove_watch_impl (InfIo      *io,
+                                    InfIoWatch *io_watch)
+{
+	GeditCollaborationReceiveThrottle *throttle = GEDIT_COLLABORATION_RECEIVE_THROTTLE (io);
+
+	throttle->priv->watches = g_slist_remove (throttle->priv->watches,
+	                                          io_watch);
+
+	watch_free ((Watch *)io_watch);
+}
+
+/* Timeouts and dispatches are not throttled */
+static InfIoTimeout *
+receive_throttle_add_timeout_impl (InfIo            *io,
+                                   guint             msecs,
+                                   InfIoTimeoutFunc  func,
+                                   gpointer          user_data,
+                                   GDestroyNotify    notify)
+{
+	return inf_io_add_timeout (GEDIT_COLLABORATION_RECEIVE_THROTTLE (io)->priv->io,
+	                           msecs,
+	                           func,
+	                           user_data,
+	                           notify);
+}
+
+static void
+receive_throttle_remove_timeout_impl (InfIo        *io,
+                                      InfIoTimeout *timeout)
+{
+	inf_io_remove_timeout (GEDIT_COLLABORATION_RECEIVE_THROTTLE (io)->priv->io,
+	                       timeout);
+}
+
+static InfIoDispatch *
+receive_throttle_add_dispatch_impl (InfIo             *io,
+                                    InfIoDispatchFunc  func,
+                                    gpointer           user_data,
+                                    GDestroyNotify     notify)
+{
+	return inf_io_add_dispatch (GEDIT_COLLABORATION_RECEIVE_THROTTLE (io)->priv->io,
+	                            func,
+	                            user_data,
+	                            notify);
+}
+
+static void
+receive_throttle_remove_dispatch_impl (InfIo         *io,
+                                       InfIoDispatch *dispatch)
+{
+	inf_io_remove_dispatch (GEDIT_COLLABORATION_RECEIVE_THROTTLE (io)->priv->io,
+	                        dispatch);
+}
+
+static void
+gedit_collaboration_receive_throttle_dispose (GObject *object)
+{
+	GeditCollaborationReceiveThrottle *throttle = GEDIT_COLLABORATION_RECEIVE_THROTTLE (object);
+
+	if (throttle->priv->resume_id != 0)
+	{
+		g_source_remove (throttle->priv->resume_id);
+		throttle->priv->resume_id = 0;
+	}
+
+	if (throttle->priv->reset_id != 0)
+	{
+		g_source_remove (throttle->priv->reset_id);
+		throttle->priv->reset_id = 0;
+	}
+
+	if (throttle->priv->io != NULL)
+	{
+		g_slist_foreach (throttle->priv->watches, (GFunc)watch_free, NULL);
+		g_slist_free (throttle->priv->watches);
+		throttle->priv->watches = NULL;
+
+		g_object_unref (throttle->priv->io);
+		throttle->priv->io = NULL;
+	}
+
+	G_OBJECT_CLASS (gedit_collaboration_receive_throttle_parent_class)->dispose (object);
+}
+
+static void
+gedit_collaboration_receive_throttle_set_property (GObject      *object,
+                                                   guint         prop_id,
+                                                   const GValue *value,
+                                                   GParamSpec   *pspec)
+{
+	GeditCollaborationReceiveThrottle *self = GEDIT_COLLABORATION_RECEIVE_THROTTLE (object);
+
+	switch (prop_id)
+	{
+		case PROP_IO:
+			self->priv->io = g_value_dup_object (value);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_receive_throttle_get_property (GObject    *object,
+                                                   guint       prop_id,
+                                                   GValue     *value,
+                                                   GParamSpec *pspec)
+{
+	GeditCollaborationReceiveThrottle *self = GEDIT_COLLABORATION_RECEIVE_THROTTLE (object);
+
+	switch (prop_id)
+	{
+		case PROP_IO:
+			g_value_set_object (value, self->priv->io);
+		break;
+		case PROP_BEHIND:
+			g_value_set_boolean (value, self->priv->behind);
+		break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gedit_collaboration_receive_throttle_class_init (GeditCollaborationReceiveThrottleClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gedit_collaboration_receive_throttle_dispose;
+
+	object_class->set_property = gedit_collaboration_receive_throttle_set_property;
+	object_class->get_property = gedit_collaboration_receive_throttle_get_property;
+
+	g_object_class_install_property (object_class,
+	                                 PROP_IO,
+	                                 g_param_spec_object ("io",
+	                                                      "IO",
+	                                                      "IO",
+	                                                      INF_TYPE_IO,
+	                                                      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_BEHIND,
+	                                 g_param_spec_boolean ("behind",
+	                                                       "Behind",
+	                                                       "Behind",
+	                                                       FALSE,
+	                                                       G_PARAM_READABLE));
+
+	g_type_class_add_private (object_class, sizeof (GeditCollaborationReceiveThrottlePrivate));
+}
+
+static void
+gedit_collaboration_receive_throttle_class_finalize (GeditCollaborationReceiveThrottleClass *klass)
+{
+}
+
+static void
+gedit_collaboration_receive_throttle_iface_init (InfIoIface *iface)
+{
+	iface->add_watch = receive_throttle_add_watch_impl;
+	iface->update_watch = receive_throttle_update_watch_impl;
+	iface->remove_watch = receive_throttle_remove_watch_impl;
+
+	iface->add_timeout = receive_throttle_add_timeout_impl;
+	iface->remove_timeout = receive_throttle_remove_timeout_impl;
+
+	iface->add_dispatch = receive_throttle_add_dispatch_impl;
+	iface->remove_dispatch = receive_throttle_remove_dispatch_impl;
+}
+
+static void
+gedit_collaboration_receive_throttle_init (GeditCollaborationReceiveThrottle *self)
+{
+	self->priv = GEDIT_COLLABORATION_RECEIVE_THROTTLE_GET_PRIVATE (self);
+}
+
+/**
+ * gedit_collaboration_receive_throttle_new:
+ * @io: the #InfIo to watch sockets with
+ *
+ * Creates an #InfIo for a single tcp connection. Once handling the incoming
+ * data of the connection took up its time budget, the socket is not read
+ * until the main loop went idle.
+ *
+ * Returns: a new #GeditCollaborationReceiveThrottle
+ */
+GeditCollaborationReceiveThrottle *
+gedit_collaboration_receive_throttle_new (InfIo *io)
+{
+	g_return_val_if_fail (INF_IS_IO (io), NULL);
+
+	return g_object_new (GEDIT_COLLABORATION_TYPE_RECEIVE_THROTTLE,
+	                     "io", io,
+	                     NULL);
+}
+
+/**
+ * gedit_collaboration_receive_throttle_get:
+ * @connection: a #InfXmlConnection
+ *
+ * Gets the throttle the tcp connection of @connection was created with.
+ *
+ * Returns: (transfer none): the throttle, or %NULL if @connection is not
+ *          throttled
+ */
+GeditCollaborationReceiveThrottle *
+gedit_collaboration_receive_throttle_get (InfXmlConnection *connection)
+{
+	InfTcpConnection *tcp = NULL;
+	InfIo *io = NULL;
+
+	if (!INF_IS_XMPP_CONNECTION (connection))
+	{
+		return NULL;
+	}
+
+	g_object_get (connection, "tcp-connection", &tcp, NULL);
+
+	if (tcp == NULL)
+	{
+		return NULL;
+	}
+
+	g_object_get (tcp, "io", &io, NULL);
+	g_object_unref (tcp);
+
+	if (io == NULL)
+	{
+		return NULL;
+	}
+
+	/* Not a reference, the tcp connection keeps the throttle alive */
+	g_object_unref (io);
+
+	return GEDIT_COLLABORATION_IS_RECEIVE_THROTTLE (io) ? GEDIT_COLLABORATION_RECEIVE_THROTTLE (io) : NULL;
+}
+
+gboolean
+gedit_collaboration_receive_throttle_get_behind (GeditCollaborationReceiveThrottle *throttle)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_RECEIVE_THROTTLE (throttle), FALSE);
+	return throttle->priv->behind;
+}
+
+guint
+gedit_collaboration_receive_throttle_get_n_deferred (GeditCollaborationReceiveThrottle *throttle)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_RECEIVE_THROTTLE (throttle), 0);
+	return throttle->priv->n_deferred;
+}
+
+gdouble
+gedit_collaboration_receive_throttle_get_max_stall (GeditCollaborationReceiveThrottle *throttle)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_RECEIVE_THROTTLE (throttle), 0);
+	return throttle->priv->max_stall / 1000.0;
+}
+
+void
+_gedit_collaboration_receive_throttle_register_type (GTypeModule *type_module)
+{
+	gedit_collaboration_receive_throttle_register_type (type_module);
+}
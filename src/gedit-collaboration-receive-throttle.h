@@ -0,0 +1,48 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+#ifndef __GEDIT_COLLABORATION_RECEIVE_THROTTLE_H__
+#define __GEDIT_COLLABORATION_RECEIVE_THROTTLE_H__
+
+#include <glib-object.h>
+#include <libinfinity/common/inf-io.h>
+#include <libinfinity/common/inf-xml-connection.h>
+
+G_BEGIN_DECLS
+
+#define GEDIT_COLLABORATION_TYPE_RECEIVE_THROTTLE		(gedit_collaboration_receive_throttle_get_type ())
+#define GEDIT_COLLABORATION_RECEIVE_THROTTLE(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_RECEIVE_THROTTLE, GeditCollaborationReceiveThrottle))
+#define GEDIT_COLLABORATION_RECEIVE_THROTTLE_CONST(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), GEDIT_COLLABORATION_TYPE_RECEIVE_THROTTLE, GeditCollaborationReceiveThrottle const))
+#define GEDIT_COLLABORATION_RECEIVE_THROTTLE_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), GEDIT_COLLABORATION_TYPE_RECEIVE_THROTTLE, GeditCollaborationReceiveThrottleClass))
+#define GEDIT_COLLABORATION_IS_RECEIVE_THROTTLE(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEDIT_COLLABORATION_TYPE_RECEIVE_THROTTLE))
+#define GEDIT_COLLABORATION_IS_RECEIVE_THROTTLE_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), GEDIT_COLLABORATION_TYPE_RECEIVE_THROTTLE))
+#define GEDIT_COLLABORATION_RECEIVE_THROTTLE_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), GEDIT_COLLABORATION_TYPE_RECEIVE_THROTTLE, GeditCollaborationReceiveThrottleClass))
+
+typedef struct _GeditCollaborationReceiveThrottle		GeditCollaborationReceiveThrottle;
+typedef struct _GeditCollaborationReceiveThrottleClass	GeditCollaborationReceiveThrottleClass;
+typedef struct _GeditCollaborationReceiveThrottlePrivate	GeditCollaborationReceiveThrottlePrivate;
+
+struct _GeditCollaborationReceiveThrottle
+{
+	GObject parent;
+
+	GeditCollaborationReceiveThrottlePrivate *priv;
+};
+
+struct _GeditCollaborationReceiveThrottleClass
+{
+	GObjectClass parent_class;
+};
+
+GType gedit_collaboration_receive_throttle_get_type (void) G_GNUC_CONST;
+void _gedit_collaboration_receive_throttle_register_type (GTypeModule *type_module);
+
+GeditCollaborationReceiveThrottle *gedit_collaboration_receive_throttle_new (InfIo *io);
+GeditCollaborationReceiveThrottle *gedit_collaboration_receive_throttle_get (InfXmlConnection *connection);
+
+gboolean gedit_collaboration_receive_throttle_get_behind (GeditCollaborationReceiveThrottle *throttle);
+guint gedit_collaboration_receive_throttle_get_n_deferred (GeditCollaborationReceiveThrottle *throttle);
+gdouble gedit_collaboration_receive_throttle_get_max_stall (GeditCollaborationReceiveThrottle *throttle);
+
+G_END_DECLS
+
+#endif /* __GEDIT_COLLABORATION_RECEIVE_THROTTLE_H__ */
@@ -9,6 +9,10 @@
 
 #define GEDIT_COLLABORATION_UNDO_MANAGER_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_COLLABORATION_TYPE_UNDO_MANAGER, GeditCollaborationUndoManagerPrivate))
 
+/* User actions following each other within this time (in microseconds)
+   may be merged into a single undo step */
+#define UNDO_GROUP_TIMEOUT (1 * G_USEC_PER_SEC)
+
 enum
 {
 	BEGIN_USER_ACTION,
@@ -26,6 +30,10 @@ struct _GeditCollaborationUndoManagerPrivate
 	InfAdoptedUser *user;
 	InfAdoptedUndoGrouping *grouping;
 
+	/* Nesting of user actions, only the outermost one makes a group */
+	guint user_action_depth;
+	gint64 last_user_action;
+
 	guint signals[NUM_SIGNALS];
 };
 
@@ -97,16 +105,35 @@ static void
 on_begin_user_action (GtkTextBuffer                 *buffer,
                       GeditCollaborationUndoManager *manager)
 {
-	/*inf_adopted_undo_grouping_start_group (manager->priv->grouping,
-	                                       TRUE);*/
+	gboolean allow_with_prev;
+
+	if (manager->priv->user_action_depth++ > 0)
+	{
+		return;
+	}
+
+	allow_with_prev = g_get_monotonic_time () - manager->priv->last_user_action <
+	                  UNDO_GROUP_TIMEOUT;
+
+	inf_adopted_undo_grouping_start_group (manager->priv->grouping,
+	                                       allow_with_prev);
 }
 
 static void
 on_end_user_action (GtkTextBuffer                 *buffer,
                     GeditCollaborationUndoManager *manager)
 {
-	/*inf_adopted_undo_grouping_end_group (manager->priv->grouping,
-	                                     TRUE);*/
+	/* Unbalanced, the action started before the manager was installed */
+	if (manager->priv->user_action_depth == 0 ||
+	    --manager->priv->user_action_depth > 0)
+	{
+		return;
+	}
+
+	manager->priv->last_user_action = g_get_monotonic_time ();
+
+	inf_adopted_undo_grouping_end_group (manager->priv->grouping,
+	                                     TRUE);
 }
 
 static void
@@ -155,6 +182,13 @@ set_session (GeditCollaborationUndoManager *manager,
 
 		uninstall_buffer_handlers (manager);
 
+		if (manager->priv->user_action_depth > 0)
+		{
+			inf_adopted_undo_grouping_end_group (manager->priv->grouping,
+			                                     FALSE);
+			manager->priv->user_action_depth = 0;
+		}
+
 		g_object_unref (manager->priv->grouping);
 		manager->priv->grouping = NULL;
 
@@ -8,18 +8,28 @@ struct _GeditCollaborationUserStorePrivate
 {
 	InfUserTable *user_table;
 	gboolean show_unavailable;
+	gboolean expand_past;
+
+	/* InfUser -> GtkTreeIter, list store iters persist */
+	GHashTable *rows;
+
+	/* Unavailable users are counted in a single row, they are only listed
+	   below it when expanded */
+	GHashTable *past;
+	GtkTreeIter past_iter;
+
+	/* Number of user property notifications handled */
+	guint notify_count;
 };
 
 enum
 {
 	PROP_0,
 	PROP_USER_TABLE,
-	PROP_SHOW_UNAVAILABLE
+	PROP_SHOW_UNAVAILABLE,
+	PROP_EXPAND_PAST
 };
 
-static void remove_user (GeditCollaborationUserStore *store, InfUser *user, gboolean disconnect_status);
-static void add_user (GeditCollaborationUserStore *store, InfUser *user);
-
 G_DEFINE_DYNAMIC_TYPE (GeditCollaborationUserStore,
                        gedit_collaboration_user_store,
                        GTK_TYPE_LIST_STORE)
@@ -27,6 +37,11 @@ G_DEFINE_DYNAMIC_TYPE (GeditCollaborationUserStore,
 static void
 gedit_collaboration_user_store_finalize (GObject *object)
 {
+	GeditCollaborationUserStore *store = GEDIT_COLLABORATION_USER_STORE (object);
+
+	g_hash_table_destroy (store->priv->rows);
+	g_hash_table_destroy (store->priv->past);
+
 	G_OBJECT_CLASS (gedit_collaboration_user_store_parent_class)->finalize (object);
 }
 
@@ -35,34 +50,136 @@ find_user (GeditCollaborationUserStore *store,
            InfUser                     *user,
            GtkTreeIter                 *iter)
 {
-	GtkTreeIter found;
-	InfUser *other;
+	GtkTreeIter *found;
+
+	found = g_hash_table_lookup (store->priv->rows, user);
 
-	if (!gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &found))
+	if (found == NULL)
 	{
 		return FALSE;
 	}
 
-	do
+	*iter = *found;
+	return TRUE;
+}
+
+static gboolean
+is_past (GeditCollaborationUserStore *store,
+         InfUser                     *user)
+{
+	return store->priv->show_unavailable &&
+	       inf_user_get_status (user) == INF_USER_UNAVAILABLE;
+}
+
+static gboolean
+is_listed (GeditCollaborationUserStore *store,
+           InfUser                     *user)
+{
+	if (inf_user_get_status (user) != INF_USER_UNAVAILABLE)
 	{
-		gtk_tree_model_get (GTK_TREE_MODEL (store),
-		                    &found,
-		                    GEDIT_COLLABORATION_USER_STORE_COLUMN_USER,
-		                    &other,
-		                    -1);
+		return TRUE;
+	}
 
-		if (user == other)
-		{
-			g_object_unref (other);
-			*iter = found;
+	return store->priv->show_unavailable && store->priv->expand_past;
+}
+
+static void
+update_past_row (GeditCollaborationUserStore *store,
+                 guint                        n_past_before)
+{
+	guint n_past = g_hash_table_size (store->priv->past);
 
-			return TRUE;
+	if (n_past == 0)
+	{
+		/* No past participant is listed anymore at this point */
+		if (n_past_before != 0)
+		{
+			gtk_list_store_remove (GTK_LIST_STORE (store),
+			                       &store->priv->past_iter);
 		}
 
-		g_object_unref (other);
-	} while (gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &found));
+		return;
+	}
+
+	/* The aggregate row has no user and goes between the available users
+	   and the listed past participants */
+	if (n_past_before == 0)
+	{
+		gtk_list_store_append (GTK_LIST_STORE (store),
+		                       &store->priv->past_iter);
+	}
+
+	gtk_list_store_set (GTK_LIST_STORE (store),
+	                    &store->priv->past_iter,
+	                    GEDIT_COLLABORATION_USER_STORE_COLUMN_PAST_PARTICIPANTS,
+	                    n_past,
+	                    -1);
+}
+
+static void
+set_past (GeditCollaborationUserStore *store,
+          InfUser                     *user,
+          gboolean                     past)
+{
+	guint n_past = g_hash_table_size (store->priv->past);
 
-	return FALSE;
+	if (past == (g_hash_table_lookup (store->priv->past, user) != NULL))
+	{
+		return;
+	}
+
+	if (past)
+	{
+		g_hash_table_insert (store->priv->past, user, user);
+	}
+	else
+	{
+		g_hash_table_remove (store->priv->past, user);
+	}
+
+	update_past_row (store, n_past);
+}
+
+static void
+add_row (GeditCollaborationUserStore *store,
+         InfUser                     *user)
+{
+	GtkTreeIter iter;
+
+	if (g_hash_table_lookup (store->priv->past, user) != NULL ||
+	    g_hash_table_size (store->priv->past) == 0)
+	{
+		gtk_list_store_append (GTK_LIST_STORE (store), &iter);
+	}
+	else
+	{
+		gtk_list_store_insert_before (GTK_LIST_STORE (store),
+		                              &iter,
+		                              &store->priv->past_iter);
+	}
+
+	gtk_list_store_set (GTK_LIST_STORE (store),
+	                    &iter,
+	                    GEDIT_COLLABORATION_USER_STORE_COLUMN_USER,
+	                    user,
+	                    -1);
+
+	g_hash_table_insert (store->priv->rows,
+	                     user,
+	                     gtk_tree_iter_copy (&iter));
+}
+
+static void
+remove_row (GeditCollaborationUserStore *store,
+            InfUser                     *user)
+{
+	GtkTreeIter iter;
+
+	if (find_user (store, user, &iter))
+	{
+		gtk_list_store_remove (GTK_LIST_STORE (store), &iter);
+		g_hash_table_remove (store->priv->rows, user);
+	}
 }
 
 static void
@@ -70,11 +187,37 @@ user_changed (GeditCollaborationUserStore *store,
               InfUser                     *user)
 {
 	GtkTreeIter iter;
+	gboolean past;
 
-	if (find_user (store, user, &iter))
+	past = is_past (store, user);
+
+	if (past != (g_hash_table_lookup (store->priv->past, user) != NULL))
+	{
+		/* Moves between the available users and the past participants */
+		remove_row (store, user);
+		set_past (store, user, past);
+
+		if (is_listed (store, user))
+		{
+			add_row (store, user);
+		}
+	}
+	else if (!find_user (store, user, &iter))
+	{
+		if (is_listed (store, user))
+		{
+			add_row (store, user);
+		}
+	}
+	else if (!is_listed (store, user))
+	{
+		remove_row (store, user);
+	}
+	else
 	{
 		GtkTreePath *path;
 
+		/* List store paths do not need a walk over the rows */
 		path = gtk_tree_model_get_path (GTK_TREE_MODEL (store),
 		                                &iter);
 
@@ -83,10 +226,6 @@ user_changed (GeditCollaborationUserStore *store,
 		                            &iter);
 		gtk_tree_path_free (path);
 	}
-	else
-	{
-		add_user (store, user);
-	}
 }
 
 static void
@@ -94,78 +233,105 @@ on_user_notify (InfUser                     *user,
                 GParamSpec                  *spec,
                 GeditCollaborationUserStore *store)
 {
-	const gchar *name = g_param_spec_get_name (spec);
+	++store->priv->notify_count;
+	user_changed (store, user);
+}
 
-	if (g_strcmp0 (name, "name") == 0 ||
-	    g_strcmp0 (name, "hue") == 0)
-	{
-		user_changed (store, user);
-	}
-	else if (g_strcmp0 (name, "status") == 0)
-	{
-		if (!store->priv->show_unavailable)
-		{
-			if (inf_user_get_status (user) == INF_USER_UNAVAILABLE)
-			{
-				remove_user (store, user, FALSE);
-			}
-			else
-			{
-				user_changed (store, user);
-			}
-		}
-		else
-		{
-			user_changed (store, user);
-		}
-	}
+static void
+disconnect_user (InfUser  *user,
+                 gpointer  data)
+{
+	g_signal_handlers_disconnect_by_func (user,
+	                                      G_CALLBACK (on_user_notify),
+	                                      data);
 }
 
 static void
 remove_user (GeditCollaborationUserStore *store,
-             InfUser                     *user,
-             gboolean                     disconnect_status)
+             InfUser                     *user)
 {
-	GtkTreeIter iter;
-
-	if (find_user (store, user, &iter))
-	{
-		if (disconnect_status)
-		{
-			g_signal_handlers_disconnect_by_func (user,
-			                                      G_CALLBACK (on_user_notify),
-			                                      store);
-		}
+	disconnect_user (user, store);
 
-		gtk_list_store_remove (GTK_LIST_STORE (store), &iter);
-	}
+	remove_row (store, user);
+	set_past (store, user, FALSE);
 }
 
 static void
 add_user (GeditCollaborationUserStore *store,
           InfUser                     *user)
 {
-	GtkTreeIter iter;
+	set_past (store, user, is_past (store, user));
 
-	if (store->priv->show_unavailable ||
-	    inf_user_get_status (user) != INF_USER_UNAVAILABLE)
+	if (is_listed (store, user))
 	{
-		gtk_list_store_append (GTK_LIST_STORE (store),
-			               &iter);
-
-		gtk_list_store_set (GTK_LIST_STORE (store),
-			            &iter,
-			            GEDIT_COLLABORATION_USER_STORE_COLUMN_USER,
-			            user,
-			            -1);
+		add_row (store, user);
 	}
 
+	/* Only what is shown, the caret moves all the time */
+	g_signal_connect (user,
+	                  "notify::name",
+	                  G_CALLBACK (on_user_notify),
+	                  store);
+
+	g_signal_connect (user,
+	                  "notify::hue",
+	                  G_CALLBACK (on_user_notify),
+	                  store);
+
 	g_signal_connect (user,
-	                  "notify",
+	                  "notify::status",
 	                  G_CALLBACK (on_user_notify),
 	                  store);
 }
 
+static void
+list_past_user (InfUser                     *user,
+                GeditCollaborationUserStore *store)
+{
+	if (g_hash_table_lookup (store->priv->past, user) != NULL)
+	{
+		add_row (store, user);
+	}
+}
+
+static void
+unlist_past_user (InfUser                     *user,
+                  gpointer                     value,
+                  GeditCollaborationUserStore *store)
+{
+	remove_row (store, user);
+}
+
+static void
+set_expand_past (GeditCollaborationUserStore *store,
+                 gboolean                     expand)
+{
+	if (store->priv->expand_past == expand)
+	{
+		return;
+	}
+
+	store->priv->expand_past = expand;
+
+	if (store->priv->user_table == NULL)
+	{
+		return;
+	}
+
+	if (expand)
+	{
+		inf_user_table_foreach_user (store->priv->user_table,
+		                             (InfUserTableForeachUserFunc)list_past_user,
+		                             store);
+	}
+	else
+	{
+		g_hash_table_foreach (store->priv->past,
+		                      (GHFunc)unlist_past_user,
+		                      store);
+	}
+}
+
 static void
 on_add_user (InfUserTable                *table,
              InfUser                     *user,
@@ -179,16 +345,7 @@ on_remove_user (InfUserTable                *table,
                 InfUser                     *user,
                 GeditCollaborationUserStore *store)
 {
-	remove_user (store, user, TRUE);
-}
-
-static void
-disconnect_user (InfUser  *user,
-                 gpointer  data)
-{
-	g_signal_handlers_disconnect_by_func (user,
-	                                      G_CALLBACK (on_user_notify),
-	                                      data);
+	remove_user (store, user);
 }
 
 static void
@@ -246,6 +403,9 @@ gedit_collaboration_user_store_set_property (GObject      *object,
 
 			refresh (self);
 		break;
+		case PROP_EXPAND_PAST:
+			set_expand_past (self, g_value_get_boolean (value));
+		break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -265,6 +425,9 @@ gedit_collaboration_user_store_get_property (GObject *object, guint prop_id, GVa
 		case PROP_SHOW_UNAVAILABLE:
 			g_value_set_boolean (value, self->priv->show_unavailable);
 		break;
+		case PROP_EXPAND_PAST:
+			g_value_set_boolean (value, self->priv->expand_past);
+		break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -332,6 +495,14 @@ gedit_collaboration_user_store_class_init (GeditCollaborationUserStoreClass *kla
 	                                                       TRUE,
 	                                                       G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
 
+	g_object_class_install_property (object_class,
+	                                 PROP_EXPAND_PAST,
+	                                 g_param_spec_boolean ("expand-past",
+	                                                       "Expand Past",
+	                                                       "List the past participants",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE));
+
 	g_type_class_add_private (object_class, sizeof(GeditCollaborationUserStorePrivate));
 }
 
@@ -364,6 +535,24 @@ iter_compare_func (GtkTreeModel *model,
 	                    &buser,
 	                    -1);
 
+	/* The past participants go below the active users */
+	if (auser == NULL || buser == NULL)
+	{
+		ret = (auser == NULL) - (buser == NULL);
+
+		if (auser)
+		{
+			g_object_unref (auser);
+		}
+
+		if (buser)
+		{
+			g_object_unref (buser);
+		}
+
+		return ret;
+	}
+
 	aname = g_utf8_casefold (inf_user_get_name (auser), -1);
 	bname = g_utf8_casefold (inf_user_get_name (buser), -1);
 
@@ -382,11 +571,19 @@ static void
 gedit_collaboration_user_store_init (GeditCollaborationUserStore *self)
 {
 	GType column_types[] = {
-		INF_TYPE_USER
+		INF_TYPE_USER,
+		G_TYPE_UINT
 	};
 
 	self->priv = GEDIT_COLLABORATION_USER_STORE_GET_PRIVATE (self);
 
+	self->priv->rows = g_hash_table_new_full (g_direct_hash,
+	                                          g_direct_equal,
+	                                          NULL,
+	                                          (GDestroyNotify)gtk_tree_iter_free);
+
+	self->priv->past = g_hash_table_new (g_direct_hash, g_direct_equal);
+
 	gtk_list_store_set_column_types (GTK_LIST_STORE (self),
 	                                 sizeof (column_types) / sizeof (GType),
 	                                 column_types);
@@ -425,6 +622,14 @@ gedit_collaboration_user_store_get_user (GeditCollaborationUserStore *store,
 	return user;
 }
 
+guint
+gedit_collaboration_user_store_get_notify_count (GeditCollaborationUserStore *store)
+{
+	g_return_val_if_fail (GEDIT_COLLABORATION_IS_USER_STORE (store), 0);
+
+	return store->priv->notify_count;
+}
+
 void
 _gedit_collaboration_user_store_register_type (GTypeModule *type_module)
 {
@@ -22,7 +22,8 @@ typedef struct _GeditCollaborationUserStorePrivate	GeditCollaborationUserStorePr
 
 typedef enum
 {
-	GEDIT_COLLABORATION_USER_STORE_COLUMN_USER
+	GEDIT_COLLABORATION_USER_STORE_COLUMN_USER,
+	GEDIT_COLLABORATION_USER_STORE_COLUMN_PAST_PARTICIPANTS
 } GeditCollaborationUserStoreColumn;
 
 struct _GeditCollaborationUserStore
@@ -44,6 +45,7 @@ GeditCollaborationUserStore *gedit_collaboration_user_store_new (InfUserTable *u
                                                                  gboolean      show_unavailable);
 InfUser *gedit_collaboration_user_store_get_user (GeditCollaborationUserStore *store,
                                                   GtkTreeIter                 *iter);
+guint gedit_collaboration_user_store_get_notify_count (GeditCollaborationUserStore *store);
 
 G_END_DECLS
 
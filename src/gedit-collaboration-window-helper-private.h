@@ -9,17 +9,9 @@
 
 #include <libinfgtk/inf-gtk-browser-view.h>
 #include <libinfgtk/inf-gtk-browser-store.h>
-#include <libinfgtk/inf-gtk-io.h>
-#include <libinfinity/common/inf-xmpp-manager.h>
-#include <libinfinity/inf-config.h>
-
-#ifdef LIBINFINITY_HAVE_AVAHI
-#include <libinfinity/common/inf-discovery-avahi.h>
-#endif
 
 #include "gedit-collaboration-manager.h"
-
-#define BOOKMARK_DATA_KEY "GeditCollaborationBookmarkDataKey"
+#include "gedit-collaboration-core.h"
 
 G_BEGIN_DECLS
 
@@ -28,14 +20,13 @@ struct _GeditCollaborationWindowHelperPrivate
 	GeditWindow *window;
 	gchar *data_dir;
 
-	InfIo *io;
-	InfCertificateCredentials *certificate_credentials;
+	GeditCollaborationCore *core;
 	InfGtkBrowserStore *browser_store;
 	GtkWidget *browser_view;
 	GeditCollaborationManager *manager;
 
-	guint added_handler_id;
-	guint removed_handler_id;
+	/* InfcBrowser -> chat panel item */
+	GHashTable *chats;
 
 	GtkBuilder *builder;
 	GtkUIManager *uimanager;
@@ -45,11 +36,15 @@ struct _GeditCollaborationWindowHelperPrivate
 	GtkActionGroup *action_group;
 
 	guint active_tab_changed_handler_id;
+	guint tab_added_handler_id;
 	GtkWidget *scrolled_window_user_view;
 	GtkWidget *tree_view_user_view;
+
+	/* Dialogs refer to the helper, so they are destroyed with it */
+	GtkWidget *open_location_dialog;
+	GtkWidget *quick_open_dialog;
 };
 
 G_END_DECLS
 
 #endif /* __GEDIT_COLLABORATION_WINDOW_HELPER_PRIVATE_H__ */
-
@@ -10,15 +10,26 @@
 #include "gedit-collaboration.h"
 #include "gedit-collaboration-hue-renderer.h"
 #include "gedit-collaboration-user-store.h"
+#include "gedit-collaboration-browser-model.h"
+#include "gedit-collaboration-locator.h"
 
 #include <libinfgtk/inf-gtk-browser-model-sort.h>
 #include <libinfgtk/inf-gtk-chat.h>
 #include <libinftext/inf-text-user.h>
-#include <libinfinity/common/inf-error.h>
+#include <string.h>
 
 #define XML_UI_FILE "gedit-collaboration-window-helper.ui"
 #define DIALOG_BUILDER_KEY "GeditCollaborationBookmarkDialogKey"
 #define CHAT_DATA_KEY "GeditCollaborationChatDataKey"
+#define CHAT_BROWSER_KEY "GeditCollaborationChatBrowserKey"
+#define CHAT_HISTORY_KEY "GeditCollaborationChatHistoryKey"
+#define QUICK_OPEN_DATA_KEY "GeditCollaborationQuickOpenDataKey"
+
+/* Number of documents shown in the quick open dialog */
+#define QUICK_OPEN_MAX_RESULTS 100
+
+/* Number of lines brought back from the log when scrolling the history */
+#define CHAT_LOAD_LINES 50
 
 #define GEDIT_COLLABORATION_WINDOW_HELPER_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE((object), GEDIT_TYPE_COLLABORATION_WINDOW_HELPER, GeditCollaborationWindowHelperPrivate))
 
@@ -29,7 +40,28 @@ enum
 	PROP_WINDOW
 };
 
+enum
+{
+	QUICK_OPEN_COLUMN_PATH,
+	QUICK_OPEN_COLUMN_SERVER,
+	QUICK_OPEN_COLUMN_BROWSER,
+	QUICK_OPEN_COLUMN_NODE_ID,
+	QUICK_OPEN_NUM_COLUMNS
+};
+
+typedef struct
+{
+	GeditCollaborationWindowHelper *helper;
+	GtkWidget *entry;
+	GtkWidget *view;
+	GtkListStore *store;
+} QuickOpen;
+
 static void gedit_window_activatable_iface_init (GeditWindowActivatableInterface *iface);
+static void shutdown_infinity (GeditCollaborationWindowHelper *helper);
+static void on_tab_added (GeditWindow                    *window,
+                          GeditTab                       *tab,
+                          GeditCollaborationWindowHelper *helper);
 
 G_DEFINE_DYNAMIC_TYPE_EXTENDED (GeditCollaborationWindowHelper,
                                 gedit_collaboration_window_helper,
@@ -58,6 +90,11 @@ gedit_collaboration_window_helper_update_state (GeditWindowActivatable *activata
 	                                      "CollaborationClearColorsAction");
 
 	gtk_action_set_sensitive (action, sensitive);
+
+	action = gtk_action_group_get_action (helper->priv->action_group,
+	                                      "CollaborationMemoryUsageAction");
+
+	gtk_action_set_sensitive (action, sensitive);
 }
 
 static void
@@ -123,7 +160,18 @@ user_hue_data_func (GtkTreeViewColumn              *tree_column,
 	                    &user,
 	                    -1);
 
-	g_object_set (cell, "hue", inf_text_user_get_hue (user), NULL);
+	/* The past participants row has no color */
+	if (user == NULL)
+	{
+		g_object_set (cell, "visible", FALSE, NULL);
+		return;
+	}
+
+	g_object_set (cell,
+	              "visible", TRUE,
+	              "hue", inf_text_user_get_hue (user),
+	              NULL);
+
 	g_object_unref (user);
 }
 
@@ -140,18 +188,40 @@ user_name_data_func (GtkTreeViewColumn              *tree_column,
 	GtkStyle *style;
 	GdkColor *color;
 	PangoStyle user_style;
+	guint n_past;
 
 	gtk_tree_model_get (tree_model,
 	                    iter,
 	                    GEDIT_COLLABORATION_USER_STORE_COLUMN_USER,
 	                    &user,
+	                    GEDIT_COLLABORATION_USER_STORE_COLUMN_PAST_PARTICIPANTS,
+	                    &n_past,
 	                    -1);
 
+	style = gtk_widget_get_style (helper->priv->tree_view_user_view);
+
+	if (user == NULL)
+	{
+		gchar *text;
+
+		text = g_strdup_printf (ngettext ("%u past participant",
+		                                  "%u past participants",
+		                                  n_past),
+		                        n_past);
+
+		g_object_set (cell,
+		              "text", text,
+		              "style", PANGO_STYLE_ITALIC,
+		              "foreground-gdk", &style->fg[GTK_STATE_INSENSITIVE],
+		              NULL);
+
+		g_free (text);
+		return;
+	}
+
 	name = inf_user_get_name (user);
 	status = inf_user_get_status (user);
 
-	style = gtk_widget_get_style (helper->priv->tree_view_user_view);
-
 	if (status == INF_USER_ACTIVE)
 	{
 		color = &style->fg[GTK_STATE_NORMAL];
@@ -172,6 +242,38 @@ user_name_data_func (GtkTreeViewColumn              *tree_column,
 	g_object_unref (user);
 }
 
+static void
+on_user_view_row_activated (GtkTreeView       *tree_view,
+                            GtkTreePath       *path,
+                            GtkTreeViewColumn *column,
+                            gpointer           data)
+{
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	InfUser *user;
+	gboolean expand;
+
+	model = gtk_tree_view_get_model (tree_view);
+
+	if (!gtk_tree_model_get_iter (model, &iter, path))
+	{
+		return;
+	}
+
+	user = gedit_collaboration_user_store_get_user (GEDIT_COLLABORATION_USER_STORE (model),
+	                                                &iter);
+
+	/* Activating the past participants row lists or hides them */
+	if (user != NULL)
+	{
+		g_object_unref (user);
+		return;
+	}
+
+	g_object_get (model, "expand-past", &expand, NULL);
+	g_object_set (model, "expand-past", !expand, NULL);
+}
+
 static void
 build_user_view (GeditCollaborationWindowHelper  *helper,
                  GtkWidget                      **tree_view,
@@ -193,9 +295,20 @@ build_user_view (GeditCollaborationWindowHelper  *helper,
 	gtk_widget_show (*tree_view);
 	gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (*tree_view), FALSE);
 
+	/* Rows all have the same height, only the visible ones are measured
+	   which keeps long lists of past participants cheap */
 	column = gtk_tree_view_column_new ();
+	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+	gtk_tree_view_column_set_expand (column, TRUE);
 	gtk_tree_view_append_column (GTK_TREE_VIEW (*tree_view), column);
 
+	gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (*tree_view), TRUE);
+
+	g_signal_connect (*tree_view,
+	                  "row-activated",
+	                  G_CALLBACK (on_user_view_row_activated),
+	                  NULL);
+
 	if (show_colors)
 	{
 		renderer = gedit_collaboration_hue_renderer_new ();
@@ -224,36 +337,16 @@ static void
 gedit_collaboration_window_helper_finalize (GObject *object)
 {
 	GeditCollaborationWindowHelper *helper;
-	GeditCollaborationBookmarks *bookmarks;
 
 	helper = GEDIT_COLLABORATION_WINDOW_HELPER (object);
-	bookmarks = gedit_collaboration_bookmarks_get_default ();
-
-	if (helper->priv->added_handler_id)
-	{
-		g_signal_handler_disconnect (bookmarks, helper->priv->added_handler_id);
-	}
-
-	if (helper->priv->removed_handler_id)
-	{
-		g_signal_handler_disconnect (bookmarks, helper->priv->removed_handler_id);
-	}
-
-	if (helper->priv->io)
-	{
-		g_object_unref (helper->priv->io);
-	}
-
-	if (helper->priv->certificate_credentials)
-	{
-		inf_certificate_credentials_unref (helper->priv->certificate_credentials);
-	}
 
 	if (helper->priv->builder)
 	{
 		g_object_unref (helper->priv->builder);
 	}
 
+	g_hash_table_destroy (helper->priv->chats);
+
 	G_OBJECT_CLASS (gedit_collaboration_window_helper_parent_class)->finalize (object);
 }
 
@@ -316,6 +409,9 @@ set_window (GeditCollaborationWindowHelper *helper,
 		g_signal_handler_disconnect (helper->priv->window,
 		                             helper->priv->active_tab_changed_handler_id);
 
+		g_signal_handler_disconnect (helper->priv->window,
+		                             helper->priv->tab_added_handler_id);
+
 		g_object_unref (helper->priv->window);
 		helper->priv->window = NULL;
 	}
@@ -329,6 +425,12 @@ set_window (GeditCollaborationWindowHelper *helper,
 			                          "active-tab-changed",
 			                          G_CALLBACK (update_active_tab),
 			                          helper);
+
+		helper->priv->tab_added_handler_id =
+			g_signal_connect (window,
+			                  "tab-added",
+			                  G_CALLBACK (on_tab_added),
+			                  helper);
 	}
 }
 
@@ -337,6 +439,23 @@ gedit_collaboration_window_helper_dispose (GObject *object)
 {
 	GeditCollaborationWindowHelper *helper = GEDIT_COLLABORATION_WINDOW_HELPER (object);
 
+	if (helper->priv->open_location_dialog)
+	{
+		gtk_widget_destroy (helper->priv->open_location_dialog);
+	}
+
+	if (helper->priv->quick_open_dialog)
+	{
+		gtk_widget_destroy (helper->priv->quick_open_dialog);
+	}
+
+	/* The browsers are shared with other windows, so drop our handlers
+	   and chat panels while the window is still around */
+	if (helper->priv->core)
+	{
+		shutdown_infinity (helper);
+	}
+
 	if (helper->priv->window)
 	{
 		set_window (helper, NULL);
@@ -494,107 +613,10 @@ on_selection_changed (InfGtkBrowserView              *browser_view,
 	update_sensitivity (helper);
 }
 
-typedef struct _ChatData
-{
-	GeditCollaborationWindowHelper *helper;
-	InfcBrowser *browser;
-	InfcSessionProxy *proxy;
-	GtkWidget *tree_view;
-	GtkWidget *chat;
-	const gchar *user;
-	gint name_failed_counter;
-} ChatData;
-
-static void request_join (ChatData *data, const gchar *name);
-
-static void
-free_chat_data (gpointer data)
-{
-	g_slice_free (ChatData, data);
-}
-
-static void
-on_join_user_request_finished (InfcUserRequest *request,
-                               InfUser         *user,
-                               gpointer         data)
-{
-	ChatData *cdata = (ChatData *)data;
-
-	inf_gtk_chat_set_active_user (INF_GTK_CHAT (cdata->chat),
-	                              user);
-
-	free_chat_data (cdata);
-}
-
-static void
-on_join_user_request_failed (InfcRequest  *request,
-                             const GError *error,
-                             gpointer      data)
-{
-	if (error->domain == inf_user_error_quark () &&
-	    error->code == INF_USER_ERROR_NAME_IN_USE)
-	{
-		gchar *new_name;
-		ChatData *cdata = (ChatData *)data;
-
-		new_name = gedit_collaboration_generate_new_name (
-			cdata->user,
-			&cdata->name_failed_counter);
-
-		request_join (cdata, new_name);
-
-		g_free (new_name);
-	}
-	else if (error)
-	{
-		g_warning ("%s", error->message);
-	}
-}
-
-static void
-request_join (ChatData    *data,
-              const gchar *name)
-{
-	InfcUserRequest *request;
-	GError *error = NULL;
-
-	GParameter parameters[] = {
-		{"name", {0,}}
-	};
-
-	g_value_init (&parameters[0].value, G_TYPE_STRING);
-	g_value_set_string (&parameters[0].value,
-	                    name);
-
-	request = infc_session_proxy_join_user (data->proxy,
-	                                        parameters,
-	                                        1,
-	                                        &error);
-
-	g_value_unset (&parameters[0].value);
-
-	if (error != NULL)
-	{
-		g_warning ("%s", error->message);
-		g_error_free (error);
-	}
-	else
-	{
-		g_signal_connect_after (request,
-		                        "failed",
-		                        G_CALLBACK (on_join_user_request_failed),
-		                        data);
-
-		g_signal_connect_after (request,
-		                        "finished",
-		                        G_CALLBACK (on_join_user_request_finished),
-		                        data);
-	}
-}
 
 static gchar *
 get_chat_name (GeditCollaborationWindowHelper *helper,
-               InfXmlConnection               *connection)
+               InfcBrowser                    *browser)
 {
 	GtkTreeIter iter;
 	GtkTreeModel *model = GTK_TREE_MODEL (helper->priv->browser_store);
@@ -607,856 +629,1690 @@ get_chat_name (GeditCollaborationWindowHelper *helper,
 	do
 	{
 		gchar *name;
-		InfcBrowser *browser;
+		InfcBrowser *row_browser;
 
 		gtk_tree_model_get (model,
 		                    &iter,
 		                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
-		                    &browser,
+		                    &row_browser,
 		                    INF_GTK_BROWSER_MODEL_COL_NAME,
 		                    &name,
 		                    -1);
 
-		if (browser != NULL &&
-		    infc_browser_get_connection (browser) == connection)
+		if (row_browser != NULL)
 		{
-			g_object_unref (browser);
-			return name;
+			g_object_unref (row_browser);
+
+			if (row_browser == browser)
+			{
+				return name;
+			}
 		}
 
-		g_object_unref (browser);
 		g_free (name);
 	} while (gtk_tree_model_iter_next (model, &iter));
 
 	return NULL;
 }
 
-static void
-sync_failed (InfSession       *session,
-             InfXmlConnection *connection,
-             GError           *error,
-             gpointer          user_data)
+typedef struct
 {
-	ChatData *cdata = user_data;
+	GeditCollaborationChatLog *log;
+	GtkTextBuffer *buffer;
+	GtkAdjustment *vadjustment;
 
-	if (error != NULL)
-	{
-		g_warning ("%s", error->message);
-	}
+	/* Log offset of every message shown, one buffer line each */
+	GArray *offsets;
 
-	gtk_widget_destroy (cdata->chat);
-	inf_session_close (session);
+	/* Offset after the last message shown and where the messages of
+	   the current subscription start */
+	goffset end;
+	goffset limit;
 
-	free_chat_data (user_data);
-}
+	guint history_size;
+} ChatHistory;
+
+static void on_chat_history_scrolled (GtkAdjustment *adjustment,
+                                      ChatHistory   *history);
+
+static void on_chat_log_rotated (GeditCollaborationChatLog *log,
+                                 ChatHistory               *history);
 
 static void
-sync_completed (InfSession       *session,
-                InfXmlConnection *connection,
-                gpointer          data)
+chat_history_free (ChatHistory *history)
 {
-	ChatData *cdata = (ChatData *)data;
-	GeditPanel *panel;
-	GeditCollaborationBookmark *bookmark;
-	GeditCollaborationUser *user;
-	GtkWidget *image;
-	GtkWidget *hpaned;
-	GtkWidget *sw;
-	GtkWidget *tree_view;
-	GeditCollaborationUserStore *store;
-	InfUserTable *user_table;
-	gchar *chat_name;
+	g_signal_handlers_disconnect_by_func (history->vadjustment,
+	                                      G_CALLBACK (on_chat_history_scrolled),
+	                                      history);
 
-	g_signal_handlers_disconnect_by_func (session,
-	                                      G_CALLBACK (sync_failed),
-	                                      data);
+	g_signal_handlers_disconnect_by_func (history->log,
+	                                      G_CALLBACK (on_chat_log_rotated),
+	                                      history);
 
-	g_signal_handlers_disconnect_by_func (session,
-	                                      G_CALLBACK (sync_completed),
-	                                      data);
+	g_array_free (history->offsets, TRUE);
 
-	bookmark = g_object_get_data (G_OBJECT (connection),
-	                              BOOKMARK_DATA_KEY);
+	g_object_unref (history->log);
+	g_object_unref (history->buffer);
+	g_object_unref (history->vadjustment);
 
-	if (bookmark)
-	{
-		user = gedit_collaboration_bookmark_get_user (bookmark);
-	}
-	else
+	g_slice_free (ChatHistory, history);
+}
+
+/* Renders a line of the log for display. The log itself is never
+   translated, line breaks in a message become line separators so that
+   every message is a single buffer line */
+static gchar *
+format_chat_line (const gchar *line)
+{
+	InfChatBufferMessageType type;
+	GDateTime *date;
+	gint64 time;
+	gchar *stamp;
+	gchar *name;
+	gchar *text;
+	gchar **parts;
+	gchar *ret;
+
+	if (!gedit_collaboration_chat_log_parse_message (line, &time, &type, &name, &text))
 	{
-		user = gedit_collaboration_user_get_default ();
+		return g_strdup (line);
 	}
 
-	chat_name = get_chat_name (cdata->helper, connection);
+	parts = g_strsplit_set (text, "\r\n", -1);
+	g_free (text);
+	text = g_strjoinv ("\342\200\250", parts);
+	g_strfreev (parts);
 
-	hpaned = gtk_hpaned_new ();
-	gtk_widget_show (hpaned);
+	date = g_date_time_new_from_unix_local (time);
+	stamp = g_date_time_format (date, "%x %X");
+	g_date_time_unref (date);
+
+	switch (type)
+	{
+		case INF_CHAT_BUFFER_MESSAGE_EMOTE:
+			ret = g_strdup_printf ("[%s] * %s %s", stamp, name, text);
+		break;
+		case INF_CHAT_BUFFER_MESSAGE_USERJOIN:
+			ret = g_strdup_printf (_("[%s] %s has joined"), stamp, name);
+		break;
+		case INF_CHAT_BUFFER_MESSAGE_USERPART:
+			ret = g_strdup_printf (_("[%s] %s has left"), stamp, name);
+		break;
+		default:
+			ret = g_strdup_printf ("[%s] <%s> %s", stamp, name, text);
+		break;
+	}
 
-	gtk_paned_pack1 (GTK_PANED (hpaned), cdata->chat, TRUE, TRUE);
-	gtk_widget_show (cdata->chat);
+	g_free (stamp);
+	g_free (name);
+	g_free (text);
 
-	build_user_view (cdata->helper, &tree_view, &sw, FALSE);
-	gtk_widget_show (sw);
-	user_table = inf_session_get_user_table (session);
+	return ret;
+}
 
-	store = gedit_collaboration_user_store_new (user_table, FALSE);
+static void
+chat_history_insert (ChatHistory  *history,
+                     gchar       **lines,
+                     goffset      *offsets,
+                     guint         n,
+                     gboolean      head)
+{
+	GtkTextIter iter;
+	GString *text;
+	guint i;
 
-	gtk_tree_view_set_model (GTK_TREE_VIEW (tree_view),
-				 GTK_TREE_MODEL (store));
+	text = g_string_new ("");
 
-	gtk_paned_pack2 (GTK_PANED (hpaned), sw, TRUE, TRUE);
+	for (i = 0; i < n; ++i)
+	{
+		gchar *formatted = format_chat_line (lines[i]);
 
-	panel = gedit_window_get_bottom_panel (cdata->helper->priv->window);
+		g_string_append (text, formatted);
+		g_string_append_c (text, '\n');
 
-	image = create_collaboration_image (cdata->helper);
-	gedit_panel_add_item (panel,
-	                      hpaned,
-			      "GeditCollaborationChat",
-			      chat_name ? chat_name : _("Chat"),
-			      image);
-	g_object_set_data (G_OBJECT (connection), CHAT_DATA_KEY, hpaned);
+		g_free (formatted);
+	}
 
-	cdata->user = gedit_collaboration_user_get_name (user);
+	if (head)
+	{
+		gtk_text_buffer_get_start_iter (history->buffer, &iter);
+		g_array_prepend_vals (history->offsets, offsets, n);
+	}
+	else
+	{
+		gtk_text_buffer_get_end_iter (history->buffer, &iter);
+		g_array_append_vals (history->offsets, offsets, n);
+	}
 
-	g_free (chat_name);
-	request_join (cdata, cdata->user);
+	gtk_text_buffer_insert (history->buffer, &iter, text->str, text->len);
+	g_string_free (text, TRUE);
 }
 
+/* Drops the messages on the other side of the ones just loaded */
 static void
-subscribe_chat_cb (InfcNodeRequest *infcnoderequest,
-                   InfcBrowserIter *iter,
-                   gpointer         data)
+chat_history_trim (ChatHistory *history,
+                   gboolean     head)
 {
-	InfcSessionProxy *proxy;
-	InfSession *session;
-	ChatData *cdata = (ChatData *) data;
-	GtkWidget *chat;
-
-	proxy = infc_browser_get_chat_session (cdata->browser);
+	GtkTextIter start;
+	GtkTextIter end;
+	guint n;
 
-	if (proxy == NULL)
+	if (history->offsets->len <= history->history_size)
 	{
-		free_chat_data (data);
 		return;
 	}
 
-	session = infc_session_proxy_get_session (proxy);
-	cdata->proxy = proxy;
+	n = history->offsets->len - history->history_size;
 
-	chat = inf_gtk_chat_new ();
-	cdata->chat = chat;
-
-	inf_gtk_chat_set_session (INF_GTK_CHAT (chat),
-	                          INF_CHAT_SESSION (session));
+	if (head)
+	{
+		gtk_text_buffer_get_start_iter (history->buffer, &start);
+		gtk_text_buffer_get_iter_at_line (history->buffer, &end, n);
 
-	g_signal_connect_after (session,
-	                        "synchronization-failed",
-	                        G_CALLBACK (sync_failed),
-	                        data);
+		g_array_remove_range (history->offsets, 0, n);
+	}
+	else
+	{
+		gtk_text_buffer_get_iter_at_line (history->buffer,
+		                                  &start,
+		                                  history->history_size);
+		gtk_text_buffer_get_end_iter (history->buffer, &end);
 
-	g_signal_connect_after (session,
-	                        "synchronization-complete",
-	                        G_CALLBACK (sync_completed),
-	                        data);
-}
+		history->end = g_array_index (history->offsets,
+		                              goffset,
+		                              history->history_size);
 
-static void
-subscribe_chat_failed_cb (InfcRequest *request,
-                          GError      *error,
-                          gpointer     user_data)
-{
-	if (error != NULL)
-	{
-		g_warning ("%s", error->message);
+		g_array_set_size (history->offsets, history->history_size);
 	}
 
-	free_chat_data (user_data);
+	gtk_text_buffer_delete (history->buffer, &start, &end);
 }
 
 static void
-request_chat (InfcBrowser                    *browser,
-              GeditCollaborationWindowHelper *helper)
+chat_history_load_before (ChatHistory *history)
 {
-	InfcNodeRequest *request;
-	ChatData *data;
+	gchar **lines;
+	goffset *offsets;
+	goffset first;
 
-	request = infc_browser_subscribe_chat (browser);
+	first = history->offsets->len > 0 ? g_array_index (history->offsets, goffset, 0)
+	                                  : history->end;
 
-	data = g_slice_new (ChatData);
-	data->helper = helper;
-	data->browser = browser;
-	data->proxy = NULL;
-	data->chat = NULL;
-	data->user = NULL;
-	data->name_failed_counter = 0;
+	lines = gedit_collaboration_chat_log_read_before (history->log,
+	                                                  first,
+	                                                  CHAT_LOAD_LINES,
+	                                                  &offsets);
 
-	g_signal_connect (request,
-	                  "failed",
-	                  G_CALLBACK (subscribe_chat_failed_cb),
-	                  data);
+	if (lines != NULL)
+	{
+		chat_history_insert (history, lines, offsets, g_strv_length (lines), TRUE);
+		chat_history_trim (history, FALSE);
+	}
 
-	g_signal_connect (request,
-	                  "finished",
-	                  G_CALLBACK (subscribe_chat_cb),
-	                  data);
+	g_strfreev (lines);
+	g_free (offsets);
 }
 
 static void
-remove_chat (InfcBrowser                    *browser,
-             GeditCollaborationWindowHelper *helper)
+chat_history_load_after (ChatHistory *history)
 {
-	GtkWidget *chat;
-	GeditPanel *panel;
-	InfXmlConnection *connection;
-	InfcSessionProxy *proxy;
+	gchar **lines;
+	goffset *offsets;
+	guint n;
 
-	proxy = infc_browser_get_chat_session (browser);
+	lines = gedit_collaboration_chat_log_read_after (history->log,
+	                                                 history->end,
+	                                                 CHAT_LOAD_LINES,
+	                                                 &offsets);
 
-	if (proxy != NULL)
+	if (lines == NULL)
 	{
-		InfSession *session;
+		return;
+	}
 
-		session = infc_session_proxy_get_session (proxy);
-		inf_session_close (session);
+	/* The live chat shows the messages of the current subscription */
+	for (n = 0; lines[n] != NULL && offsets[n] < history->limit; ++n)
+	{
+		history->end = offsets[n] + strlen (lines[n]) + 1;
 	}
 
-	connection = infc_browser_get_connection (browser);
+	chat_history_insert (history, lines, offsets, n, FALSE);
+	chat_history_trim (history, TRUE);
 
-	chat = GTK_WIDGET (g_object_get_data (G_OBJECT (connection),
-	                                      CHAT_DATA_KEY));
+	g_strfreev (lines);
+	g_free (offsets);
+}
 
-	if (chat != NULL)
-	{
-		panel = gedit_window_get_bottom_panel (helper->priv->window);
-		gedit_panel_remove_item (panel, chat);
+static void
+on_chat_log_rotated (GeditCollaborationChatLog *log,
+                     ChatHistory               *history)
+{
+	/* The history shown is no longer in the log */
+	gtk_text_buffer_set_text (history->buffer, "", 0);
+	g_array_set_size (history->offsets, 0);
 
-		g_object_set_data (G_OBJECT (connection), CHAT_DATA_KEY, NULL);
-	}
+	history->end = 0;
+	history->limit = 0;
 }
 
 static void
-on_browser_status_changed (InfcBrowser                    *browser,
-                           GParamSpec                     *spec,
-                           GeditCollaborationWindowHelper *helper)
+on_chat_history_scrolled (GtkAdjustment *adjustment,
+                          ChatHistory   *history)
 {
-	update_sensitivity (helper);
+	gdouble value = gtk_adjustment_get_value (adjustment);
 
-	if (infc_browser_get_status (browser) == INFC_BROWSER_CONNECTED)
+	if (value <= gtk_adjustment_get_lower (adjustment))
 	{
-		request_chat (browser, helper);
+		if (history->offsets->len == 0 ||
+		    g_array_index (history->offsets, goffset, 0) > 0)
+		{
+			chat_history_load_before (history);
+		}
 	}
-	else if (infc_browser_get_status (browser) == INFC_BROWSER_DISCONNECTED)
+	else if (value + gtk_adjustment_get_page_size (adjustment) >=
+	         gtk_adjustment_get_upper (adjustment))
 	{
-		remove_chat (browser, helper);
+		if (history->end < history->limit)
+		{
+			chat_history_load_after (history);
+		}
 	}
 }
 
-static void
-on_set_browser (InfGtkBrowserModel             *model,
-                GtkTreePath                    *path,
-                GtkTreeIter                    *iter,
-                InfcBrowser                    *browser,
-                GeditCollaborationWindowHelper *helper)
+/* Messages from earlier subscriptions are read back from the log into
+   a view of their own, the chat widget only shows the live chat */
+static GtkWidget *
+create_chat_history (GeditCollaborationWindowHelper *helper,
+                     GtkWidget                      *item,
+                     InfcBrowser                    *browser)
 {
-	if (browser != NULL)
-	{
-		infc_browser_add_plugin (browser,
-		                         gedit_collaboration_manager_get_note_plugin (helper->priv->manager));
+	GeditCollaborationChatLog *log;
+	ChatHistory *history;
+	GtkWidget *expander;
+	GtkWidget *sw;
+	GtkWidget *text_view;
+
+	log = gedit_collaboration_core_get_chat_log (helper->priv->core, browser);
 
-		g_signal_connect (browser,
-		                  "notify::status",
-		                  G_CALLBACK (on_browser_status_changed),
-		                  helper);
+	if (log == NULL)
+	{
+		return NULL;
 	}
 
-	update_sensitivity (helper);
-}
+	history = g_slice_new0 (ChatHistory);
+	history->log = g_object_ref (log);
+	history->offsets = g_array_new (FALSE, FALSE, sizeof (goffset));
+	history->limit = gedit_collaboration_core_get_chat_log_start (helper->priv->core,
+	                                                              browser);
+	history->end = history->limit;
+	history->history_size = MAX (CHAT_LOAD_LINES,
+	                             g_settings_get_uint (gedit_collaboration_core_get_settings (helper->priv->core),
+	                                                  "chat-history-size"));
 
-typedef struct
-{
-	GeditCollaborationWindowHelper *helper;
-	InfXmlConnection *connection;
-} NameInfo;
+	expander = gtk_expander_new (_("Earlier messages"));
+	gtk_widget_show (expander);
 
-static void
-on_bookmark_name_changed (GeditCollaborationBookmark *bookmark,
-                          GParamSpec                 *spec,
-                          NameInfo                   *info)
-{
-	inf_gtk_browser_store_set_connection_name (info->helper->priv->browser_store,
-	                                           info->connection,
-	                                           gedit_collaboration_bookmark_get_name (bookmark));
-}
+	sw = gtk_scrolled_window_new (NULL, NULL);
+	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (sw),
+	                                GTK_POLICY_AUTOMATIC,
+	                                GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (sw),
+	                                     GTK_SHADOW_ETCHED_IN);
+	gtk_widget_set_size_request (sw, -1, 120);
+	gtk_widget_show (sw);
 
-static void
-name_info_free (NameInfo *info)
-{
-	g_slice_free (NameInfo, info);
-}
+	text_view = gtk_text_view_new ();
+	gtk_text_view_set_editable (GTK_TEXT_VIEW (text_view), FALSE);
+	gtk_text_view_set_cursor_visible (GTK_TEXT_VIEW (text_view), FALSE);
+	gtk_text_view_set_wrap_mode (GTK_TEXT_VIEW (text_view), GTK_WRAP_WORD_CHAR);
+	gtk_widget_show (text_view);
 
-static gchar *
-show_password_dialog (GeditCollaborationWindowHelper *helper,
-                      GeditCollaborationUser         *user,
-                      InfXmppConnection              *connection)
-{
-	GtkBuilder *builder;
-	GtkWidget *dialog;
+	gtk_container_add (GTK_CONTAINER (sw), text_view);
+	gtk_container_add (GTK_CONTAINER (expander), sw);
+
+	history->buffer = g_object_ref (gtk_text_view_get_buffer (GTK_TEXT_VIEW (text_view)));
+	history->vadjustment = g_object_ref (gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (text_view)));
+
+	chat_history_load_before (history);
+
+	g_signal_connect (history->vadjustment,
+	                  "value-changed",
+	                  G_CALLBACK (on_chat_history_scrolled),
+	                  history);
+
+	g_signal_connect (history->log,
+	                  "rotated",
+	                  G_CALLBACK (on_chat_log_rotated),
+	                  history);
+
+	g_object_set_data_full (G_OBJECT (item),
+	                        CHAT_HISTORY_KEY,
+	                        history,
+	                        (GDestroyNotify)chat_history_free);
+
+	return expander;
+}
+
+static void
+fill_chat (GeditCollaborationWindowHelper *helper,
+           GtkWidget                      *item,
+           InfcBrowser                    *browser)
+{
+	InfChatSession *session;
+	InfUser *user;
+	GtkWidget *hpaned;
+	GtkWidget *chat;
+	GtkWidget *sw;
+	GtkWidget *tree_view;
+	GtkWidget *history;
+	GeditCollaborationUserStore *store;
+
+	if (g_object_get_data (G_OBJECT (item), CHAT_DATA_KEY) != NULL)
+	{
+		return;
+	}
+
+	session = gedit_collaboration_core_get_chat_session (helper->priv->core,
+	                                                     browser);
+
+	if (session == NULL)
+	{
+		return;
+	}
+
+	/* Replace the placeholder */
+	gtk_container_foreach (GTK_CONTAINER (item),
+	                       (GtkCallback)gtk_widget_destroy,
+	                       NULL);
+
+	chat = inf_gtk_chat_new ();
+	inf_gtk_chat_set_session (INF_GTK_CHAT (chat), session);
+
+	user = gedit_collaboration_core_get_chat_user (helper->priv->core,
+	                                               browser);
+
+	if (user != NULL)
+	{
+		inf_gtk_chat_set_active_user (INF_GTK_CHAT (chat), user);
+	}
+
+	hpaned = gtk_hpaned_new ();
+	gtk_widget_show (hpaned);
+
+	gtk_paned_pack1 (GTK_PANED (hpaned), chat, TRUE, TRUE);
+	gtk_widget_show (chat);
+
+	build_user_view (helper, &tree_view, &sw, FALSE);
+	gtk_widget_show (sw);
+
+	store = gedit_collaboration_user_store_new (inf_session_get_user_table (INF_SESSION (session)),
+	                                            FALSE);
+
+	gtk_tree_view_set_model (GTK_TREE_VIEW (tree_view),
+	                         GTK_TREE_MODEL (store));
+	g_object_unref (store);
+
+	gtk_paned_pack2 (GTK_PANED (hpaned), sw, TRUE, TRUE);
+
+	history = create_chat_history (helper, item, browser);
+
+	if (history != NULL)
+	{
+		gtk_box_pack_start (GTK_BOX (item), history, FALSE, FALSE, 0);
+	}
+
+	gtk_box_pack_start (GTK_BOX (item), hpaned, TRUE, TRUE, 0);
+
+	g_object_set_data (G_OBJECT (item), CHAT_DATA_KEY, chat);
+}
+
+static void
+on_chat_item_mapped (GtkWidget                      *item,
+                     GeditCollaborationWindowHelper *helper)
+{
+	InfcBrowser *browser;
+
+	browser = g_object_get_data (G_OBJECT (item), CHAT_BROWSER_KEY);
+
+	/* The chat is only subscribed once its panel item is shown */
+	if (gedit_collaboration_core_get_chat_session (helper->priv->core, browser) != NULL)
+	{
+		fill_chat (helper, item, browser);
+	}
+	else
+	{
+		gedit_collaboration_core_request_chat (helper->priv->core, browser);
+	}
+
+	gedit_collaboration_core_mark_chat_read (helper->priv->core, browser);
+}
+
+static void
+add_chat (GeditCollaborationWindowHelper *helper,
+          InfcBrowser                    *browser)
+{
+	GeditPanel *panel;
+	GtkWidget *image;
+	GtkWidget *item;
 	GtkWidget *label;
-	GtkWidget *entry;
-	gchar *password;
-	gchar *remote;
-	gchar *text;
-	gchar *name;
-	gchar *username;
-	gchar *remotename;
-	gchar *datadir;
+	gchar *chat_name;
 
-	datadir = peas_extension_base_get_data_dir (PEAS_EXTENSION_BASE (helper));
-	builder = gedit_collaboration_create_builder (datadir,
-	                                              "gedit-collaboration-password-dialog.ui");
-	g_free (datadir);
+	if (g_hash_table_lookup (helper->priv->chats, browser) != NULL)
+	{
+		return;
+	}
 
-	if (!builder)
+	item = gtk_vbox_new (FALSE, 0);
+	gtk_widget_show (item);
+
+	label = gtk_label_new (_("Loading chat..."));
+	gtk_widget_show (label);
+	gtk_box_pack_start (GTK_BOX (item), label, TRUE, TRUE, 0);
+
+	g_object_set_data (G_OBJECT (item), CHAT_BROWSER_KEY, browser);
+
+	chat_name = get_chat_name (helper, browser);
+
+	panel = gedit_window_get_bottom_panel (helper->priv->window);
+
+	image = create_collaboration_image (helper);
+	gedit_panel_add_item (panel,
+	                      item,
+			      "GeditCollaborationChat",
+			      chat_name ? chat_name : _("Chat"),
+			      image);
+
+	g_hash_table_insert (helper->priv->chats, browser, item);
+	g_free (chat_name);
+
+	g_signal_connect (item,
+	                  "map",
+	                  G_CALLBACK (on_chat_item_mapped),
+	                  helper);
+
+	/* Chats subscribed from other windows are shown right away */
+	fill_chat (helper, item, browser);
+}
+
+static void
+remove_chat (GeditCollaborationWindowHelper *helper,
+             InfcBrowser                    *browser)
+{
+	GtkWidget *item;
+	GeditPanel *panel;
+
+	item = g_hash_table_lookup (helper->priv->chats, browser);
+
+	if (item != NULL)
 	{
-		return NULL;
+		g_signal_handlers_disconnect_by_func (item,
+		                                      G_CALLBACK (on_chat_item_mapped),
+		                                      helper);
+
+		panel = gedit_window_get_bottom_panel (helper->priv->window);
+		gedit_panel_remove_item (panel, item);
+
+		g_hash_table_remove (helper->priv->chats, browser);
 	}
+}
 
-	dialog = GTK_WIDGET (gtk_builder_get_object (builder, "dialog_password"));
-	label = GTK_WIDGET (gtk_builder_get_object (builder, "label_caption"));
-	entry = GTK_WIDGET (gtk_builder_get_object (builder, "entry_password"));
+static void
+on_chat_added (GeditCollaborationCore         *core,
+               InfcBrowser                    *browser,
+               GeditCollaborationWindowHelper *helper)
+{
+	GtkWidget *item;
 
-	g_object_get (connection, "remote-hostname", &remote, NULL);
+	item = g_hash_table_lookup (helper->priv->chats, browser);
 
-	username = g_markup_escape_text (gedit_collaboration_user_get_name (user), -1);
-	remotename = g_markup_escape_text (remote, -1);
+	if (item != NULL)
+	{
+		fill_chat (helper, item, browser);
+	}
+}
 
-	name = g_strdup_printf ("<i>%s@%s</i>", username, remotename);
+static void
+on_chat_joined (GeditCollaborationCore         *core,
+                InfcBrowser                    *browser,
+                GeditCollaborationWindowHelper *helper)
+{
+	GtkWidget *item;
+	GtkWidget *chat;
 
-	g_free (remote);
-	g_free (username);
-	g_free (remotename);
+	item = g_hash_table_lookup (helper->priv->chats, browser);
 
-	text = g_strdup_printf (_("Please provide a password for %s"),
-	                        name);
-	g_free (name);
+	if (item == NULL)
+	{
+		return;
+	}
 
-	if (!inf_xmpp_connection_get_tls_enabled (connection))
+	chat = g_object_get_data (G_OBJECT (item), CHAT_DATA_KEY);
+
+	if (chat != NULL)
+	{
+		inf_gtk_chat_set_active_user (INF_GTK_CHAT (chat),
+		                              gedit_collaboration_core_get_chat_user (core, browser));
+	}
+}
+
+static void
+on_chat_unread_changed (GeditCollaborationCore         *core,
+                        InfcBrowser                    *browser,
+                        GeditCollaborationWindowHelper *helper)
+{
+	GtkWidget *item;
+
+	item = g_hash_table_lookup (helper->priv->chats, browser);
+
+	/* Messages arriving while the chat is in view are read already */
+	if (item != NULL && gtk_widget_get_mapped (item))
+	{
+		gedit_collaboration_core_mark_chat_read (core, browser);
+		return;
+	}
+
+	gtk_widget_queue_draw (helper->priv->browser_view);
+}
+
+static void
+on_chat_removed (GeditCollaborationCore         *core,
+                 InfcBrowser                    *browser,
+                 GeditCollaborationWindowHelper *helper)
+{
+	remove_chat (helper, browser);
+}
+
+static void
+unread_data_func (GtkTreeViewColumn              *tree_column,
+                  GtkCellRenderer                *cell,
+                  GtkTreeModel                   *tree_model,
+                  GtkTreeIter                    *iter,
+                  GeditCollaborationWindowHelper *helper)
+{
+	InfcBrowser *browser = NULL;
+	GtkTreeIter parent;
+	guint unread = 0;
+
+	if (!gtk_tree_model_iter_parent (tree_model, &parent, iter))
+	{
+		gtk_tree_model_get (tree_model,
+		                    iter,
+		                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
+		                    &browser,
+		                    -1);
+	}
+
+	if (browser != NULL)
+	{
+		unread = gedit_collaboration_core_get_chat_unread (helper->priv->core,
+		                                                   browser);
+		g_object_unref (browser);
+	}
+
+	if (unread > 0)
 	{
-		gchar *all = g_strdup_printf ("%s\n\n<small><b>%s</b></small>",
-		                              text,
-		                              _("Note: The connection is not secure"));
+		gchar *text = g_strdup_printf ("(%u)", unread);
+
+		g_object_set (cell,
+		              "text", text,
+		              "weight", PANGO_WEIGHT_BOLD,
+		              "visible", TRUE,
+		              NULL);
 
 		g_free (text);
-		text = all;
 	}
+	else
+	{
+		g_object_set (cell, "visible", FALSE, NULL);
+	}
+}
+
+static void
+on_browser_status_changed (InfcBrowser                    *browser,
+                           GParamSpec                     *spec,
+                           GeditCollaborationWindowHelper *helper)
+{
+	update_sensitivity (helper);
+
+	if (infc_browser_get_status (browser) == INFC_BROWSER_CONNECTED)
+	{
+		add_chat (helper, browser);
+	}
+	else if (infc_browser_get_status (browser) == INFC_BROWSER_DISCONNECTED)
+	{
+		remove_chat (helper, browser);
+	}
+}
+
+static void
+on_set_browser (InfGtkBrowserModel             *model,
+                GtkTreePath                    *path,
+                GtkTreeIter                    *iter,
+                InfcBrowser                    *browser,
+                GeditCollaborationWindowHelper *helper)
+{
+	/* The browser of a replaced connection is not detached on shutdown,
+	   the handler goes away together with the helper */
+	if (browser != NULL)
+	{
+		g_signal_connect_object (browser,
+		                         "notify::status",
+		                         G_CALLBACK (on_browser_status_changed),
+		                         helper,
+		                         0);
+	}
+
+	update_sensitivity (helper);
+}
+
+typedef void (*BrowserFunc) (GeditCollaborationWindowHelper *helper,
+                             InfcBrowser                    *browser);
+
+static void
+foreach_browser (GeditCollaborationWindowHelper *helper,
+                 BrowserFunc                     func)
+{
+	GtkTreeIter iter;
+	GtkTreeModel *model = GTK_TREE_MODEL (helper->priv->browser_store);
+
+	if (!gtk_tree_model_get_iter_first (model, &iter))
+	{
+		return;
+	}
+
+	do
+	{
+		InfcBrowser *browser;
+
+		gtk_tree_model_get (model,
+		                    &iter,
+		                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
+		                    &browser,
+		                    -1);
+
+		if (browser != NULL)
+		{
+			func (helper, browser);
+			g_object_unref (browser);
+		}
+	} while (gtk_tree_model_iter_next (model, &iter));
+}
+
+static void
+attach_browser (GeditCollaborationWindowHelper *helper,
+                InfcBrowser                    *browser)
+{
+	g_signal_connect_object (browser,
+	                         "notify::status",
+	                         G_CALLBACK (on_browser_status_changed),
+	                         helper,
+	                         0);
+
+	if (infc_browser_get_status (browser) == INFC_BROWSER_CONNECTED)
+	{
+		add_chat (helper, browser);
+	}
+}
+
+static void
+detach_browser (GeditCollaborationWindowHelper *helper,
+                InfcBrowser                    *browser)
+{
+	g_signal_handlers_disconnect_by_func (browser,
+	                                      G_CALLBACK (on_browser_status_changed),
+	                                      helper);
+
+	remove_chat (helper, browser);
+}
+
+static void
+open_bookmark_for_row (GeditCollaborationWindowHelper *helper,
+                       GtkTreeModel                   *model,
+                       GtkTreeIter                    *iter)
+{
+	InfcBrowser *browser;
+
+	gtk_tree_model_get (model,
+	                    iter,
+	                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
+	                    &browser,
+	                    -1);
+
+	if (browser == NULL)
+	{
+		return;
+	}
+
+	gedit_collaboration_core_open_connection (helper->priv->core,
+	                                          infc_browser_get_connection (browser));
+
+	g_object_unref (browser);
+}
+
+static void
+on_browser_row_activated (GtkTreeView                    *tree_view,
+                          GtkTreePath                    *path,
+                          GtkTreeViewColumn              *column,
+                          GeditCollaborationWindowHelper *helper)
+{
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+
+	model = gtk_tree_view_get_model (tree_view);
+
+	if (gtk_tree_model_get_iter (model, &iter, path))
+	{
+		open_bookmark_for_row (helper, model, &iter);
+	}
+}
+
+static gboolean
+on_browser_test_expand_row (GtkTreeView                    *tree_view,
+                            GtkTreeIter                    *iter,
+                            GtkTreePath                    *path,
+                            GeditCollaborationWindowHelper *helper)
+{
+	open_bookmark_for_row (helper, gtk_tree_view_get_model (tree_view), iter);
+
+	/* Allow the expansion */
+	return FALSE;
+}
+
+static void
+set_row_expanded (GeditCollaborationWindowHelper *helper,
+                  GtkTreeModel                   *model,
+                  GtkTreeIter                    *iter,
+                  gboolean                        expanded)
+{
+	InfcBrowser *browser;
+	InfcBrowserIter *browser_iter;
+	InfcBrowserIter root;
+	GeditCollaborationListingCache *cache;
+	gchar *path;
+
+	gtk_tree_model_get (model,
+	                    iter,
+	                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
+	                    &browser,
+	                    INF_GTK_BROWSER_MODEL_COL_NODE,
+	                    &browser_iter,
+	                    -1);
+
+	if (browser == NULL)
+	{
+		return;
+	}
+
+	cache = gedit_collaboration_core_get_listing_cache (helper->priv->core,
+	                                                    browser);
+
+	if (cache != NULL)
+	{
+		/* The connection row shows the root directory */
+		if (browser_iter == NULL)
+		{
+			infc_browser_iter_get_root (browser, &root);
+			path = infc_browser_iter_get_path (browser, &root);
+		}
+		else
+		{
+			path = infc_browser_iter_get_path (browser, browser_iter);
+		}
+
+		gedit_collaboration_listing_cache_set_expanded (cache, path, expanded);
+		g_free (path);
+	}
+
+	if (browser_iter != NULL)
+	{
+		infc_browser_iter_free (browser_iter);
+	}
+
+	g_object_unref (browser);
+}
+
+static void
+on_browser_row_expanded (GtkTreeView                    *tree_view,
+                         GtkTreeIter                    *iter,
+                         GtkTreePath                    *path,
+                         GeditCollaborationWindowHelper *helper)
+{
+	set_row_expanded (helper, gtk_tree_view_get_model (tree_view), iter, TRUE);
+}
+
+static void
+on_browser_row_collapsed (GtkTreeView                    *tree_view,
+                          GtkTreeIter                    *iter,
+                          GtkTreePath                    *path,
+                          GeditCollaborationWindowHelper *helper)
+{
+	set_row_expanded (helper, gtk_tree_view_get_model (tree_view), iter, FALSE);
+}
+
+static gboolean
+create_popup_menu_item (GeditCollaborationWindowHelper *helper,
+                        GtkMenu                        *menu,
+                        const gchar                    *id,
+                        gboolean                        create_separator)
+{
+	GtkAction *action;
+	GtkWidget *item;
+	GtkActionGroup *ac;
+
+	action = get_action (helper, id);
+	g_object_get (action, "action-group", &ac, NULL);
+
+	if (!gtk_action_get_sensitive (action) ||
+	    !gtk_action_group_get_sensitive (ac))
+	{
+		g_object_unref (ac);
+		return FALSE;
+	}
+
+	gtk_action_set_accel_group (action,
+	                            gtk_ui_manager_get_accel_group (helper->priv->uimanager));
+
+	g_object_unref (ac);
+
+	if (create_separator)
+	{
+		item = gtk_separator_menu_item_new ();
+		gtk_widget_show (item);
+
+		gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+	}
+
+	item = gtk_action_create_menu_item (action);
+	gtk_widget_show (item);
+
+	gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+
+	return TRUE;
+}
+
+static void
+on_populate_popup (InfGtkBrowserView              *view,
+                   GtkMenu                        *menu,
+                   GeditCollaborationWindowHelper *helper)
+{
+	gboolean createsep;
+
+	create_popup_menu_item (helper, menu, "FileNew", FALSE);
+	createsep = create_popup_menu_item (helper, menu, "FolderNew", FALSE);
+
+	createsep &= !create_popup_menu_item (helper, menu, "ItemDelete", createsep);
+	createsep |= create_popup_menu_item (helper, menu, "SessionDisconnect", createsep);
+
+	createsep &= !create_popup_menu_item (helper, menu, "BookmarkNew", createsep);
+	create_popup_menu_item (helper, menu, "BookmarkEdit", createsep);
+}
+
+static void
+on_browser_activate (InfGtkBrowserView              *view,
+                     GtkTreeIter                    *iter,
+                     GeditCollaborationWindowHelper *helper)
+{
+	InfcBrowser *browser;
+	InfcBrowserIter *browser_iter;
+	InfDiscovery *discovery;
+	GeditCollaborationUser *user;
+	GtkTreeIter selected;
+
+	gtk_tree_model_sort_convert_iter_to_child_iter (
+		GTK_TREE_MODEL_SORT (inf_gtk_browser_view_get_model (view)),
+		&selected,
+		iter
+	);
+
+	gtk_tree_model_get (GTK_TREE_MODEL (helper->priv->browser_store),
+	                    &selected,
+	                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
+	                    &browser,
+	                    INF_GTK_BROWSER_MODEL_COL_DISCOVERY,
+	                    &discovery,
+	                    -1);
+
+	if (browser == NULL)
+	{
+		if (discovery)
+		{
+			g_object_unref (discovery);
+		}
+
+		return;
+	}
+
+	gtk_tree_model_get (GTK_TREE_MODEL (helper->priv->browser_store),
+	                    &selected,
+	                    INF_GTK_BROWSER_MODEL_COL_NODE,
+	                    &browser_iter,
+	                    -1);
+
+	if (browser_iter == NULL ||
+	    infc_browser_iter_is_subdirectory (browser, browser_iter))
+	{
+		g_object_unref (browser);
+
+		if (browser_iter)
+		{
+			infc_browser_iter_free (browser_iter);
+		}
+
+		if (discovery)
+		{
+			g_object_unref (discovery);
+		}
+
+		return;
+	}
+
+	if (discovery)
+	{
+		user = gedit_collaboration_user_get_default ();
+	}
+	else
+	{
+		GeditCollaborationBookmark *bookmark;
+
+		bookmark = g_object_get_data (G_OBJECT (infc_browser_get_connection (browser)),
+		                              BOOKMARK_DATA_KEY);
+
+		user = gedit_collaboration_bookmark_get_user (bookmark);
+	}
+
+	gedit_collaboration_manager_subscribe (helper->priv->manager,
+	                                       user,
+	                                       browser,
+	                                       browser_iter);
+
+	if (discovery)
+	{
+		g_object_unref (discovery);
+	}
+
+	if (browser_iter)
+	{
+		infc_browser_iter_free (browser_iter);
+	}
+}
+
+
+static void
+init_infinity (GeditCollaborationWindowHelper *helper)
+{
+	InfGtkBrowserModel *model_sort;
+	GtkWidget *tree_view;
+	GtkTreeViewColumn *column;
+	GtkCellRenderer *renderer;
+
+	/* Connections, the browser store and chats are shared between all
+	   windows, every window only has its own view on them */
+	helper->priv->core = g_object_ref (gedit_collaboration_core_get_default ());
+	helper->priv->browser_store =
+		g_object_ref (gedit_collaboration_core_get_browser_store (helper->priv->core));
+
+	model_sort = INF_GTK_BROWSER_MODEL (
+		gedit_collaboration_browser_model_new (
+			INF_GTK_BROWSER_MODEL (helper->priv->browser_store),
+			gedit_collaboration_core_get_collation_cache (helper->priv->core)
+		)
+	);
+
+	helper->priv->browser_view =
+		inf_gtk_browser_view_new_with_model (model_sort);
+
+	g_object_unref (model_sort);
+
+	gtk_widget_show (helper->priv->browser_view);
+
+	g_signal_connect_after (helper->priv->browser_store,
+	                        "set-browser",
+	                        G_CALLBACK (on_set_browser),
+	                        helper);
+
+	g_signal_connect (helper->priv->browser_view,
+	                  "selection-changed",
+	                  G_CALLBACK (on_selection_changed),
+	                  helper);
+
+	g_signal_connect (helper->priv->browser_view,
+	                  "populate-popup",
+	                  G_CALLBACK (on_populate_popup),
+	                  helper);
+
+	g_signal_connect (helper->priv->browser_view,
+	                  "activate",
+	                  G_CALLBACK (on_browser_activate),
+	                  helper);
+
+	/* Bookmarks connect on demand when they are activated or expanded */
+	tree_view = gtk_bin_get_child (GTK_BIN (helper->priv->browser_view));
+
+	/* Unread chat messages next to the server name */
+	renderer = gtk_cell_renderer_text_new ();
+	column = gtk_tree_view_get_column (GTK_TREE_VIEW (tree_view), 0);
+	gtk_tree_view_column_pack_end (column, renderer, FALSE);
+
+	gtk_tree_view_column_set_cell_data_func (column,
+	                                         renderer,
+	                                         (GtkTreeCellDataFunc)unread_data_func,
+	                                         helper,
+	                                         NULL);
+
+	g_signal_connect (tree_view,
+	                  "row-activated",
+	                  G_CALLBACK (on_browser_row_activated),
+	                  helper);
+
+	g_signal_connect (tree_view,
+	                  "test-expand-row",
+	                  G_CALLBACK (on_browser_test_expand_row),
+	                  helper);
+
+	/* Expanded directories are explored again on the next connect */
+	g_signal_connect (tree_view,
+	                  "row-expanded",
+	                  G_CALLBACK (on_browser_row_expanded),
+	                  helper);
+
+	g_signal_connect (tree_view,
+	                  "row-collapsed",
+	                  G_CALLBACK (on_browser_row_collapsed),
+	                  helper);
+
+	g_signal_connect (helper->priv->core,
+	                  "chat-added",
+	                  G_CALLBACK (on_chat_added),
+	                  helper);
+
+	g_signal_connect (helper->priv->core,
+	                  "chat-joined",
+	                  G_CALLBACK (on_chat_joined),
+	                  helper);
+
+	g_signal_connect (helper->priv->core,
+	                  "chat-removed",
+	                  G_CALLBACK (on_chat_removed),
+	                  helper);
+
+	g_signal_connect (helper->priv->core,
+	                  "chat-unread-changed",
+	                  G_CALLBACK (on_chat_unread_changed),
+	                  helper);
+
+	foreach_browser (helper, attach_browser);
+}
+
+static void
+shutdown_infinity (GeditCollaborationWindowHelper *helper)
+{
+	g_signal_handlers_disconnect_matched (helper->priv->core,
+	                                      G_SIGNAL_MATCH_DATA,
+	                                      0,
+	                                      0,
+	                                      NULL,
+	                                      NULL,
+	                                      helper);
+
+	g_signal_handlers_disconnect_by_func (helper->priv->browser_store,
+	                                      G_CALLBACK (on_set_browser),
+	                                      helper);
+
+	foreach_browser (helper, detach_browser);
+
+	g_object_unref (helper->priv->browser_store);
+	helper->priv->browser_store = NULL;
+
+	g_object_unref (helper->priv->core);
+	helper->priv->core = NULL;
+}
+
+static void
+on_clear_collaboration_colors_activate (GtkAction                      *action,
+                                        GeditCollaborationWindowHelper *helper)
+{
+	GeditTab *tab;
+
+	tab = gedit_window_get_active_tab (helper->priv->window);
+
+	gedit_collaboration_manager_clear_colors (helper->priv->manager,
+	                                          tab);
+}
+
+static void
+on_collaboration_memory_usage_activate (GtkAction                      *action,
+                                        GeditCollaborationWindowHelper *helper)
+{
+	GeditTab *tab;
+	GeditCollaborationSubscription *subscription;
+	GtkWidget *dialog;
+	gchar *name;
+	gchar *report;
+
+	tab = gedit_window_get_active_tab (helper->priv->window);
+
+	subscription = gedit_collaboration_manager_tab_get_subscription (helper->priv->manager,
+	                                                                 tab);
+
+	if (subscription == NULL)
+	{
+		return;
+	}
+
+	name = gedit_document_get_short_name_for_display (gedit_tab_get_document (tab));
+	report = gedit_collaboration_subscription_get_memory_report (subscription);
+
+	dialog = gtk_message_dialog_new (GTK_WINDOW (helper->priv->window),
+	                                 GTK_DIALOG_DESTROY_WITH_PARENT,
+	                                 GTK_MESSAGE_INFO,
+	                                 GTK_BUTTONS_CLOSE,
+	                                 _("Memory usage of %s"),
+	                                 name);
+
+	gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog),
+	                                          "%s",
+	                                          report);
+
+	g_signal_connect (dialog,
+	                  "response",
+	                  G_CALLBACK (gtk_widget_destroy),
+	                  NULL);
+
+	gtk_widget_show (dialog);
+
+	g_free (report);
+	g_free (name);
+}
+
+static void
+on_locator_failed (GeditCollaborationLocator      *locator,
+                   const GError                   *error,
+                   GeditCollaborationWindowHelper *helper)
+{
+	GtkWidget *dialog;
+	gchar *location;
 
-	gtk_label_set_markup (GTK_LABEL (label),
-	                      text);
-	g_free (text);
+	g_object_get (locator, "location", &location, NULL);
 
-	gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+	dialog = gtk_message_dialog_new (GTK_WINDOW (helper->priv->window),
+	                                 GTK_DIALOG_DESTROY_WITH_PARENT,
+	                                 GTK_MESSAGE_ERROR,
+	                                 GTK_BUTTONS_CLOSE,
+	                                 _("Could not open %s"),
+	                                 location);
 
-	/* Need to do this modal/sync for now */
-	if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_OK)
-	{
-		password = g_strdup (gtk_entry_get_text (GTK_ENTRY (entry)));
+	gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog),
+	                                          "%s",
+	                                          error->message);
 
-		if (!*password)
-		{
-			g_free (password);
-			password = NULL;
-		}
-	}
-	else
-	{
-		password = NULL;
-	}
+	g_signal_connect (dialog,
+	                  "response",
+	                  G_CALLBACK (gtk_widget_destroy),
+	                  NULL);
 
-	g_object_unref (builder);
-	gtk_widget_destroy (dialog);
+	gtk_widget_show (dialog);
 
-	return password;
+	g_free (location);
 }
 
 static void
-user_request_password (GeditCollaborationUser         *user,
-                       gpointer                        session_data,
-                       GeditCollaborationWindowHelper *helper)
+open_location (GeditCollaborationWindowHelper *helper,
+               const gchar                    *location)
 {
-	gchar *password;
+	GeditCollaborationLocator *locator;
+
+	locator = gedit_collaboration_locator_new (helper->priv->manager,
+	                                           location);
 
-	password = show_password_dialog (helper, user, session_data);
-	gedit_collaboration_user_set_password (user, password);
+	g_signal_connect_object (locator,
+	                         "failed",
+	                         G_CALLBACK (on_locator_failed),
+	                         helper,
+	                         0);
 
-	g_free (password);
+	/* The locator keeps itself alive until the document is opened */
+	gedit_collaboration_locator_start (locator);
+	g_object_unref (locator);
 }
 
 static void
-bookmark_added (GeditCollaborationWindowHelper *helper,
-                GeditCollaborationBookmark     *bookmark)
-{
-	GResolver *resolver = g_resolver_get_default ();
-	GList *addresses;
-	InfTcpConnection *tcp;
-	InfIpAddress *ipaddress;
-	InfXmppConnection *connection;
-	gchar *ipaddr;
-	NameInfo *info;
-	GeditCollaborationUser *user;
-
-	/* TODO: make this asynchronous and be smarter about it */
-	addresses = g_resolver_lookup_by_name (resolver,
-	                                       gedit_collaboration_bookmark_get_host (bookmark),
-	                                       NULL,
-	                                       NULL);
-
-	if (!addresses)
+on_open_location_response (GtkDialog                      *dialog,
+                           gint                            response_id,
+                           GeditCollaborationWindowHelper *helper)
+{
+	if (response_id == GTK_RESPONSE_OK)
 	{
-		return;
-	}
+		GtkWidget *entry;
+		gchar *location;
 
-	ipaddr = g_inet_address_to_string ((GInetAddress *)addresses->data);
-	g_resolver_free_addresses (addresses);
+		entry = g_object_get_data (G_OBJECT (dialog), "entry");
+		location = g_strstrip (g_strdup (gtk_entry_get_text (GTK_ENTRY (entry))));
 
-	ipaddress = inf_ip_address_new_from_string (ipaddr);
-	g_free (ipaddr);
+		if (*location != '\0')
+		{
+			open_location (helper, location);
+		}
 
-	tcp = inf_tcp_connection_new (helper->priv->io,
-	                              ipaddress,
-	                              (guint)gedit_collaboration_bookmark_get_port (bookmark));
+		g_free (location);
+	}
 
-	user = gedit_collaboration_bookmark_get_user (bookmark);
-	connection = inf_xmpp_connection_new (tcp,
-	                                      INF_XMPP_CONNECTION_CLIENT,
-	                                      NULL,
-	                                      gedit_collaboration_bookmark_get_host (bookmark),
-	                                      INF_XMPP_CONNECTION_SECURITY_BOTH_PREFER_TLS,
-	                                      helper->priv->certificate_credentials,
-	                                      gedit_collaboration_user_get_sasl_context (user),
-	                                      "ANONYMOUS PLAIN");
-
-	g_signal_connect (user,
-	                  "request-password",
-	                  G_CALLBACK (user_request_password),
-	                  helper);
+	gtk_widget_destroy (GTK_WIDGET (dialog));
+}
 
-	inf_gtk_browser_store_add_connection (helper->priv->browser_store,
-	                                      INF_XML_CONNECTION (connection),
-	                                      gedit_collaboration_bookmark_get_name (bookmark));
+static void
+on_open_collaboration_location_activate (GtkAction                      *action,
+                                         GeditCollaborationWindowHelper *helper)
+{
+	GtkWidget *dialog;
+	GtkWidget *vbox;
+	GtkWidget *label;
+	GtkWidget *entry;
 
-	g_object_set_data (G_OBJECT (connection), BOOKMARK_DATA_KEY, bookmark);
+	if (helper->priv->open_location_dialog)
+	{
+		gtk_window_present (GTK_WINDOW (helper->priv->open_location_dialog));
+		return;
+	}
 
-	inf_ip_address_free (ipaddress);
-	g_object_unref (tcp);
+	dialog = gtk_dialog_new_with_buttons (_("Open Collaboration Location"),
+	                                      GTK_WINDOW (helper->priv->window),
+	                                      GTK_DIALOG_DESTROY_WITH_PARENT,
+	                                      GTK_STOCK_CANCEL,
+	                                      GTK_RESPONSE_CANCEL,
+	                                      GTK_STOCK_OPEN,
+	                                      GTK_RESPONSE_OK,
+	                                      NULL);
 
-	info = g_slice_new (NameInfo);
-	info->helper = helper;
-	info->connection = INF_XML_CONNECTION (connection);
+	gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
 
-	g_signal_connect_data (bookmark,
-	                       "notify::name",
-	                       G_CALLBACK (on_bookmark_name_changed),
-	                       info,
-	                       (GClosureNotify)name_info_free,
-	                       0);
-}
+	vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+	gtk_container_set_border_width (GTK_CONTAINER (vbox), 6);
 
-static void
-on_bookmark_added (GeditCollaborationBookmarks    *bookmarks,
-                   GeditCollaborationBookmark     *bookmark,
-                   GeditCollaborationWindowHelper *helper)
-{
-	bookmark_added (helper, bookmark);
-}
+	label = gtk_label_new_with_mnemonic (_("_Location (host:port/path or infinote://host:port/path):"));
+	gtk_misc_set_alignment (GTK_MISC (label), 0, 0.5);
 
-static void
-on_bookmark_removed (GeditCollaborationBookmarks    *bookmarks,
-                     GeditCollaborationBookmark     *bookmark,
-                     GeditCollaborationWindowHelper *helper)
-{
+	entry = gtk_entry_new ();
+	gtk_entry_set_activates_default (GTK_ENTRY (entry), TRUE);
+	gtk_label_set_mnemonic_widget (GTK_LABEL (label), entry);
 
-}
+	gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (vbox), entry, FALSE, FALSE, 0);
+	gtk_widget_show_all (vbox);
 
-static void
-init_bookmarks (GeditCollaborationWindowHelper *helper)
-{
-	GeditCollaborationBookmarks *bookmarks;
-	GList *item;
+	gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))),
+	                    vbox,
+	                    TRUE,
+	                    TRUE,
+	                    0);
 
-	bookmarks = gedit_collaboration_bookmarks_get_default ();
-	item = gedit_collaboration_bookmarks_get_bookmarks (bookmarks);
+	g_object_set_data (G_OBJECT (dialog), "entry", entry);
 
-	while (item)
-	{
-		GeditCollaborationBookmark *bookmark = item->data;
+	g_signal_connect (dialog,
+	                  "response",
+	                  G_CALLBACK (on_open_location_response),
+	                  helper);
 
-		bookmark_added (helper, bookmark);
-		item = g_list_next (item);
-	}
+	helper->priv->open_location_dialog = dialog;
 
-	helper->priv->added_handler_id =
-		g_signal_connect (bookmarks,
-		                  "added",
-		                  G_CALLBACK (on_bookmark_added),
-		                  helper);
+	g_signal_connect (dialog,
+	                  "destroy",
+	                  G_CALLBACK (gtk_widget_destroyed),
+	                  &helper->priv->open_location_dialog);
 
-	helper->priv->removed_handler_id =
-		g_signal_connect (bookmarks,
-		                  "removed",
-		                  G_CALLBACK (on_bookmark_removed),
-		                  helper);
+	gtk_widget_show (dialog);
 }
 
-static gboolean
-create_popup_menu_item (GeditCollaborationWindowHelper *helper,
-                        GtkMenu                        *menu,
-                        const gchar                    *id,
-                        gboolean                        create_separator)
+/* Locations given on the command line end up in a tab gedit can not
+   load, the document is opened through the locator instead. The load is
+   cancelled before it can fail, gedit then removes the tab by itself */
+static void
+on_tab_added (GeditWindow                    *window,
+              GeditTab                       *tab,
+              GeditCollaborationWindowHelper *helper)
 {
-	GtkAction *action;
-	GtkWidget *item;
-	GtkActionGroup *ac;
+	GeditDocument *doc;
+	GFile *location;
+	gchar *uri;
 
-	action = get_action (helper, id);
-	g_object_get (action, "action-group", &ac, NULL);
+	doc = gedit_tab_get_document (tab);
+	location = gedit_document_get_location (doc);
 
-	if (!gtk_action_get_sensitive (action) ||
-	    !gtk_action_group_get_sensitive (ac))
+	if (location == NULL)
 	{
-		g_object_unref (ac);
-		return FALSE;
+		return;
 	}
 
-	gtk_action_set_accel_group (action,
-	                            gtk_ui_manager_get_accel_group (helper->priv->uimanager));
-
-	g_object_unref (ac);
-
-	if (create_separator)
+	if (!g_file_has_uri_scheme (location, GEDIT_COLLABORATION_LOCATOR_SCHEME))
 	{
-		item = gtk_separator_menu_item_new ();
-		gtk_widget_show (item);
-
-		gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+		g_object_unref (location);
+		return;
 	}
 
-	item = gtk_action_create_menu_item (action);
-	gtk_widget_show (item);
+	gedit_document_load_cancel (doc);
 
-	gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+	uri = g_file_get_uri (location);
+	open_location (helper, uri);
 
-	return TRUE;
+	g_free (uri);
+	g_object_unref (location);
 }
 
 static void
-on_populate_popup (InfGtkBrowserView              *view,
-                   GtkMenu                        *menu,
-                   GeditCollaborationWindowHelper *helper)
+quick_open_free (QuickOpen *quick_open)
 {
-	gboolean createsep;
-
-	create_popup_menu_item (helper, menu, "FileNew", FALSE);
-	createsep = create_popup_menu_item (helper, menu, "FolderNew", FALSE);
-
-	createsep &= !create_popup_menu_item (helper, menu, "ItemDelete", createsep);
-	createsep |= create_popup_menu_item (helper, menu, "SessionDisconnect", createsep);
+	g_object_unref (quick_open->store);
+	g_slice_free (QuickOpen, quick_open);
+}
 
-	createsep &= !create_popup_menu_item (helper, menu, "BookmarkNew", createsep);
-	create_popup_menu_item (helper, menu, "BookmarkEdit", createsep);
+static void
+add_quick_open_match (InfcBrowser *browser,
+                      guint        node_id,
+                      const gchar *server,
+                      const gchar *path,
+                      QuickOpen   *quick_open)
+{
+	gtk_list_store_insert_with_values (quick_open->store,
+	                                   NULL,
+	                                   -1,
+	                                   QUICK_OPEN_COLUMN_PATH, path,
+	                                   QUICK_OPEN_COLUMN_SERVER, server,
+	                                   QUICK_OPEN_COLUMN_BROWSER, browser,
+	                                   QUICK_OPEN_COLUMN_NODE_ID, node_id,
+	                                   -1);
 }
 
 static void
-on_browser_activate (InfGtkBrowserView              *view,
-                     GtkTreeIter                    *iter,
-                     GeditCollaborationWindowHelper *helper)
+on_quick_open_changed (GtkEntry  *entry,
+                       QuickOpen *quick_open)
 {
-	InfcBrowser *browser;
-	InfcBrowserIter *browser_iter;
-	InfDiscovery *discovery;
-	GeditCollaborationUser *user;
-	GtkTreeIter selected;
+	GeditCollaborationPathIndex *index;
+	GtkTreePath *path;
 
-	gtk_tree_model_sort_convert_iter_to_child_iter (
-		GTK_TREE_MODEL_SORT (inf_gtk_browser_view_get_model (view)),
-		&selected,
-		iter
-	);
+	index = gedit_collaboration_core_get_path_index (gedit_collaboration_core_get_default ());
 
-	gtk_tree_model_get (GTK_TREE_MODEL (helper->priv->browser_store),
-	                    &selected,
-	                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
-	                    &browser,
-	                    INF_GTK_BROWSER_MODEL_COL_DISCOVERY,
-	                    &discovery,
-	                    -1);
+	gtk_list_store_clear (quick_open->store);
 
-	if (browser == NULL)
-	{
-		if (discovery)
-		{
-			g_object_unref (discovery);
-		}
+	gedit_collaboration_path_index_query (index,
+	                                      gtk_entry_get_text (entry),
+	                                      QUICK_OPEN_MAX_RESULTS,
+	                                      (GeditCollaborationPathIndexFunc)add_quick_open_match,
+	                                      quick_open);
 
-		return;
-	}
+	path = gtk_tree_path_new_first ();
+	gtk_tree_view_set_cursor (GTK_TREE_VIEW (quick_open->view), path, NULL, FALSE);
+	gtk_tree_path_free (path);
+}
 
-	gtk_tree_model_get (GTK_TREE_MODEL (helper->priv->browser_store),
-	                    &selected,
-	                    INF_GTK_BROWSER_MODEL_COL_NODE,
-	                    &browser_iter,
-	                    -1);
+/* Up and down move through the matches while typing */
+static gboolean
+on_quick_open_key_press (GtkWidget   *entry,
+                         GdkEventKey *event,
+                         QuickOpen   *quick_open)
+{
+	GtkTreePath *path;
+	GtkTreeIter iter;
 
-	if (browser_iter == NULL ||
-	    infc_browser_iter_is_subdirectory (browser, browser_iter))
+	if (event->keyval != GDK_KEY_Up && event->keyval != GDK_KEY_Down)
 	{
-		g_object_unref (browser);
-
-		if (browser_iter)
-		{
-			infc_browser_iter_free (browser_iter);
-		}
+		return FALSE;
+	}
 
-		if (discovery)
-		{
-			g_object_unref (discovery);
-		}
+	gtk_tree_view_get_cursor (GTK_TREE_VIEW (quick_open->view), &path, NULL);
 
-		return;
+	if (path == NULL)
+	{
+		return TRUE;
 	}
 
-	if (discovery)
+	if (event->keyval == GDK_KEY_Up)
 	{
-		user = gedit_collaboration_user_get_default ();
+		gtk_tree_path_prev (path);
 	}
 	else
 	{
-		GeditCollaborationBookmark *bookmark;
-
-		bookmark = g_object_get_data (G_OBJECT (infc_browser_get_connection (browser)),
-		                              BOOKMARK_DATA_KEY);
-
-		user = gedit_collaboration_bookmark_get_user (bookmark);
+		gtk_tree_path_next (path);
 	}
 
-	gedit_collaboration_manager_subscribe (helper->priv->manager,
-	                                       user,
-	                                       browser,
-	                                       browser_iter);
-
-	if (discovery)
+	if (gtk_tree_model_get_iter (GTK_TREE_MODEL (quick_open->store), &iter, path))
 	{
-		g_object_unref (discovery);
+		gtk_tree_view_set_cursor (GTK_TREE_VIEW (quick_open->view), path, NULL, FALSE);
 	}
 
-	if (browser_iter)
-	{
-		infc_browser_iter_free (browser_iter);
-	}
+	gtk_tree_path_free (path);
+	return TRUE;
 }
 
-#ifdef LIBINFINITY_HAVE_AVAHI
 static void
-init_infinity_discovery (GeditCollaborationWindowHelper *helper,
-                         InfXmppManager                 *xmpp_manager)
+open_quick_open_selection (QuickOpen *quick_open)
 {
-	InfDiscoveryAvahi *discovery;
+	GeditCollaborationWindowHelper *helper = quick_open->helper;
+	GeditCollaborationPathIndex *index;
+	GeditCollaborationBookmark *bookmark;
 	GeditCollaborationUser *user;
+	GtkTreeSelection *selection;
+	GtkTreeIter iter;
+	InfcBrowser *browser;
+	InfcBrowserIter browser_iter;
+	guint node_id;
 
-	user = gedit_collaboration_user_get_default ();
-	discovery = inf_discovery_avahi_new (helper->priv->io,
-	                                     xmpp_manager,
-	                                     helper->priv->certificate_credentials,
-	                                     gedit_collaboration_user_get_sasl_context (user),
-	                                     "ANONYMOUS PLAIN");
-
-	g_signal_connect (user,
-	                 "request-password",
-	                 G_CALLBACK (user_request_password),
-	                 helper);
-
-	inf_gtk_browser_store_add_discovery (helper->priv->browser_store,
-	                                     INF_DISCOVERY (discovery));
-}
-#endif
-
-/* Copied from gobby: code/core/browser.cpp */
-static gint
-compare_func (GtkTreeModel *model,
-              GtkTreeIter  *first,
-              GtkTreeIter  *second,
-              gpointer      user_data)
-{
-	gint result;
-	InfcBrowser *br_one;
-	InfcBrowser *br_two;
-	InfcBrowserIter *bri_one;
-	InfcBrowserIter *bri_two;
-	GtkTreeIter parent;
-
-	result = 0;
+	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (quick_open->view));
 
-	if (gtk_tree_model_iter_parent (model, &parent, first))
+	if (!gtk_tree_selection_get_selected (selection, NULL, &iter))
 	{
-		g_assert (gtk_tree_model_iter_parent (model, &parent, second));
+		return;
+	}
 
-		gtk_tree_model_get (model,
-		                   first,
-		                   INF_GTK_BROWSER_MODEL_COL_BROWSER,
-		                   &br_one,
-		                   INF_GTK_BROWSER_MODEL_COL_NODE,
-		                   &bri_one,
-		                   -1);
+	gtk_tree_model_get (GTK_TREE_MODEL (quick_open->store),
+	                    &iter,
+	                    QUICK_OPEN_COLUMN_BROWSER, &browser,
+	                    QUICK_OPEN_COLUMN_NODE_ID, &node_id,
+	                    -1);
 
-		gtk_tree_model_get (model,
-		                    second,
-		                    INF_GTK_BROWSER_MODEL_COL_BROWSER,
-		                    &br_two,
-		                    INF_GTK_BROWSER_MODEL_COL_NODE,
-		                    &bri_two,
-		                    -1);
+	index = gedit_collaboration_core_get_path_index (gedit_collaboration_core_get_default ());
+
+	/* The document might have been removed in the meantime */
+	if (gedit_collaboration_path_index_lookup (index,
+	                                           browser,
+	                                           node_id,
+	                                           &browser_iter))
+	{
+		bookmark = g_object_get_data (G_OBJECT (infc_browser_get_connection (browser)),
+		                              BOOKMARK_DATA_KEY);
 
-		if (infc_browser_iter_is_subdirectory (br_one, bri_one) &&
-		   !infc_browser_iter_is_subdirectory (br_two, bri_two))
+		if (bookmark != NULL)
 		{
-			result = -1;
+			user = gedit_collaboration_bookmark_get_user (bookmark);
 		}
-		else if (!infc_browser_iter_is_subdirectory(br_one, bri_one) &&
-		          infc_browser_iter_is_subdirectory(br_two, bri_two))
+		else
 		{
-			result = 1;
+			user = gedit_collaboration_user_get_default ();
 		}
 
-		g_object_unref (br_one);
-		g_object_unref (br_two);
-
-		infc_browser_iter_free (bri_one);
-		infc_browser_iter_free (bri_two);
+		gedit_collaboration_manager_subscribe (helper->priv->manager,
+		                                       user,
+		                                       browser,
+		                                       &browser_iter);
 	}
 
-	if (!result)
-	{
-		gchar* name_one;
-		gchar* name_two;
-
-		gtk_tree_model_get (model,
-		                    first,
-		                    INF_GTK_BROWSER_MODEL_COL_NAME,
-		                    &name_one,
-		                    -1);
-
-		gtk_tree_model_get (model,
-		                    second,
-		                    INF_GTK_BROWSER_MODEL_COL_NAME,
-		                    &name_two,
-		                    -1);
-
-		gchar* one = g_utf8_casefold (name_one, -1);
-		gchar* two = g_utf8_casefold (name_two, -1);
+	g_object_unref (browser);
+}
 
-		result = g_utf8_collate (one, two);
+static void
+on_quick_open_row_activated (GtkTreeView       *view,
+                             GtkTreePath       *path,
+                             GtkTreeViewColumn *column,
+                             GtkDialog         *dialog)
+{
+	gtk_dialog_response (dialog, GTK_RESPONSE_OK);
+}
 
-		g_free (name_one);
-		g_free (name_two);
-		g_free (one);
-		g_free (two);
+static void
+on_quick_open_response (GtkDialog *dialog,
+                        gint       response_id,
+                        QuickOpen *quick_open)
+{
+	if (response_id == GTK_RESPONSE_OK)
+	{
+		open_quick_open_selection (quick_open);
 	}
 
-	return result;
+	gtk_widget_destroy (GTK_WIDGET (dialog));
 }
 
 static void
-init_infinity (GeditCollaborationWindowHelper *helper)
+on_collaboration_quick_open_activate (GtkAction                      *action,
+                                      GeditCollaborationWindowHelper *helper)
 {
-	InfGtkIo *io;
-	InfCommunicationManager *communication_manager;
-	InfXmppManager *xmpp_manager;
-	InfCertificateCredentials *certificate_credentials;
-	InfGtkBrowserModel *model_sort;
+	QuickOpen *quick_open;
+	GtkWidget *dialog;
+	GtkWidget *vbox;
+	GtkWidget *sw;
+	GtkCellRenderer *renderer;
+	GtkTreeViewColumn *column;
 
-	io = inf_gtk_io_new ();
-	communication_manager = inf_communication_manager_new ();
-	xmpp_manager = inf_xmpp_manager_new ();
-	certificate_credentials = inf_certificate_credentials_new ();
+	if (helper->priv->quick_open_dialog)
+	{
+		gtk_window_present (GTK_WINDOW (helper->priv->quick_open_dialog));
+		return;
+	}
 
-	helper->priv->io = INF_IO (io);
-	helper->priv->certificate_credentials = certificate_credentials;
-	helper->priv->browser_store = inf_gtk_browser_store_new (INF_IO (io),
-	                                                         communication_manager);
+	dialog = gtk_dialog_new_with_buttons (_("Quick Open Shared Document"),
+	                                      GTK_WINDOW (helper->priv->window),
+	                                      GTK_DIALOG_DESTROY_WITH_PARENT,
+	                                      GTK_STOCK_CANCEL,
+	                                      GTK_RESPONSE_CANCEL,
+	                                      GTK_STOCK_OPEN,
+	                                      GTK_RESPONSE_OK,
+	                                      NULL);
 
-	model_sort = INF_GTK_BROWSER_MODEL (
-		inf_gtk_browser_model_sort_new (
-			INF_GTK_BROWSER_MODEL (helper->priv->browser_store)
-		)
-	);
+	gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+	gtk_window_set_default_size (GTK_WINDOW (dialog), 500, 400);
 
-	gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (model_sort),
-	                                         compare_func,
-	                                         NULL,
-	                                         NULL);
+	quick_open = g_slice_new0 (QuickOpen);
+	quick_open->helper = helper;
+	quick_open->store = gtk_list_store_new (QUICK_OPEN_NUM_COLUMNS,
+	                                        G_TYPE_STRING,
+	                                        G_TYPE_STRING,
+	                                        INFC_TYPE_BROWSER,
+	                                        G_TYPE_UINT);
 
-	helper->priv->browser_view =
-		inf_gtk_browser_view_new_with_model (model_sort);
+	g_object_set_data_full (G_OBJECT (dialog),
+	                        QUICK_OPEN_DATA_KEY,
+	                        quick_open,
+	                        (GDestroyNotify)quick_open_free);
 
-	gtk_widget_show (helper->priv->browser_view);
+	vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+	gtk_container_set_border_width (GTK_CONTAINER (vbox), 6);
 
-	g_signal_connect_after (helper->priv->browser_store,
-	                        "set-browser",
-	                        G_CALLBACK (on_set_browser),
-	                        helper);
+	quick_open->entry = gtk_entry_new ();
+	gtk_entry_set_activates_default (GTK_ENTRY (quick_open->entry), TRUE);
 
-	g_signal_connect (helper->priv->browser_view,
-	                  "selection-changed",
-	                  G_CALLBACK (on_selection_changed),
-	                  helper);
+	quick_open->view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (quick_open->store));
+	gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (quick_open->view), FALSE);
 
-	g_signal_connect (helper->priv->browser_view,
-	                  "populate-popup",
-	                  G_CALLBACK (on_populate_popup),
-	                  helper);
+	renderer = gtk_cell_renderer_text_new ();
+	g_object_set (renderer, "ellipsize", PANGO_ELLIPSIZE_START, NULL);
 
-	g_signal_connect (helper->priv->browser_view,
-	                  "activate",
-	                  G_CALLBACK (on_browser_activate),
-	                  helper);
+	column = gtk_tree_view_column_new_with_attributes (_("Document"),
+	                                                   renderer,
+	                                                   "text",
+	                                                   QUICK_OPEN_COLUMN_PATH,
+	                                                   NULL);
 
-#ifdef LIBINFINITY_HAVE_AVAHI
-	init_infinity_discovery (helper, xmpp_manager);
-#endif
+	gtk_tree_view_column_set_expand (column, TRUE);
+	gtk_tree_view_append_column (GTK_TREE_VIEW (quick_open->view), column);
 
-	init_bookmarks (helper);
+	renderer = gtk_cell_renderer_text_new ();
+	g_object_set (renderer, "style", PANGO_STYLE_ITALIC, NULL);
 
-	g_object_unref (communication_manager);
-	g_object_unref (xmpp_manager);
-}
+	column = gtk_tree_view_column_new_with_attributes (_("Server"),
+	                                                   renderer,
+	                                                   "text",
+	                                                   QUICK_OPEN_COLUMN_SERVER,
+	                                                   NULL);
 
-static void
-on_clear_collaboration_colors_activate (GtkAction                      *action,
-                                        GeditCollaborationWindowHelper *helper)
-{
-	GeditTab *tab;
+	gtk_tree_view_append_column (GTK_TREE_VIEW (quick_open->view), column);
 
-	tab = gedit_window_get_active_tab (helper->priv->window);
+	sw = gtk_scrolled_window_new (NULL, NULL);
+	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (sw),
+	                                GTK_POLICY_AUTOMATIC,
+	                                GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (sw),
+	                                     GTK_SHADOW_ETCHED_IN);
+	gtk_container_add (GTK_CONTAINER (sw), quick_open->view);
 
-	gedit_collaboration_manager_clear_colors (helper->priv->manager,
-	                                          tab);
+	gtk_box_pack_start (GTK_BOX (vbox), quick_open->entry, FALSE, FALSE, 0);
+	gtk_box_pack_start (GTK_BOX (vbox), sw, TRUE, TRUE, 0);
+	gtk_widget_show_all (vbox);
+
+	gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))),
+	                    vbox,
+	                    TRUE,
+	                    TRUE,
+	                    0);
+
+	g_signal_connect (quick_open->entry,
+	                  "changed",
+	                  G_CALLBACK (on_quick_open_changed),
+	                  quick_open);
+
+	g_signal_connect (quick_open->entry,
+	                  "key-press-event",
+	                  G_CALLBACK (on_quick_open_key_press),
+	                  quick_open);
+
+	g_signal_connect (quick_open->view,
+	                  "row-activated",
+	                  G_CALLBACK (on_quick_open_row_activated),
+	                  dialog);
+
+	g_signal_connect (dialog,
+	                  "response",
+	                  G_CALLBACK (on_quick_open_response),
+	                  quick_open);
+
+	helper->priv->quick_open_dialog = dialog;
+
+	g_signal_connect (dialog,
+	                  "destroy",
+	                  G_CALLBACK (gtk_widget_destroyed),
+	                  &helper->priv->quick_open_dialog);
+
+	gtk_widget_show (dialog);
 }
 
 static const gchar submenu[] = {
 "<ui>"
 "  <menubar name='MenuBar'>"
+"    <menu name='FileMenu' action='File'>"
+"      <placeholder name='FileOps_1'>"
+"        <menuitem name='CollaborationOpenLocation' action='CollaborationOpenLocationAction'/>"
+"        <menuitem name='CollaborationQuickOpen' action='CollaborationQuickOpenAction'/>"
+"      </placeholder>"
+"    </menu>"
 "    <menu name='ViewMenu' action='View'>"
 "      <separator />"
 "      <menuitem name='CollaborationClearColors' action='CollaborationClearColorsAction'/>"
+"      <menuitem name='CollaborationMemoryUsage' action='CollaborationMemoryUsageAction'/>"
 "    </menu>"
 "  </menubar>"
 "</ui>"
 };
 
-static const GtkActionEntry action_clear_colors_entries[] =
+static const GtkActionEntry action_entries[] =
 {
+	{ "CollaborationOpenLocationAction", GTK_STOCK_OPEN, N_("Open Collaboration _Location..."), NULL,
+	 N_("Open a shared document by its location on a server"),
+	 G_CALLBACK (on_open_collaboration_location_activate)},
+	{ "CollaborationQuickOpenAction", NULL, N_("_Quick Open Shared Document..."), "<Control><Alt>o",
+	 N_("Find a shared document by typing part of its path"),
+	 G_CALLBACK (on_collaboration_quick_open_activate)},
 	{ "CollaborationClearColorsAction", NULL, N_("Clear _Collaboration Colors"), NULL,
 	 N_("Clear collaboration user colors"),
 	 G_CALLBACK (on_clear_collaboration_colors_activate)},
+	{ "CollaborationMemoryUsageAction", NULL, N_("Collaboration _Memory Usage"), NULL,
+	 N_("Show what the shared document keeps in memory"),
+	 G_CALLBACK (on_collaboration_memory_usage_activate)},
 };
 
 static void
@@ -1470,8 +2326,8 @@ add_window_menu (GeditCollaborationWindowHelper *helper)
 	                                         GETTEXT_PACKAGE);
 
 	gtk_action_group_add_actions (helper->priv->action_group,
-	                              action_clear_colors_entries,
-	                              G_N_ELEMENTS (action_clear_colors_entries),
+	                              action_entries,
+	                              G_N_ELEMENTS (action_entries),
 	                              helper);
 
 	gtk_ui_manager_insert_action_group (manager, helper->priv->action_group, -1);
@@ -1660,6 +2516,7 @@ static void
 gedit_collaboration_window_helper_init (GeditCollaborationWindowHelper *self)
 {
 	self->priv = GEDIT_COLLABORATION_WINDOW_HELPER_GET_PRIVATE (self);
+	self->priv->chats = g_hash_table_new (g_direct_hash, g_direct_equal);
 }
 
 void
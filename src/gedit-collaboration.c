@@ -2,6 +2,8 @@
 
 #include "gedit-collaboration.h"
 #include <math.h>
+#include <libinfinity/common/inf-xmpp-connection.h>
+#include <libinfinity/common/inf-tcp-connection.h>
 
 GQuark
 gedit_collaboration_error_quark (void)
@@ -133,3 +135,33 @@ gedit_collaboration_generate_new_name (const gchar *name,
 
 	return new_name;
 }
+
+/* Identifies the server of a connection (host:port) in everything cached
+   for it on disk */
+gchar *
+gedit_collaboration_get_server_key (InfXmlConnection *connection)
+{
+	InfTcpConnection *tcp = NULL;
+	gchar *host = NULL;
+	guint port = 0;
+	gchar *key;
+
+	if (INF_IS_XMPP_CONNECTION (connection))
+	{
+		g_object_get (connection,
+		              "remote-hostname", &host,
+		              "tcp-connection", &tcp,
+		              NULL);
+	}
+
+	if (tcp != NULL)
+	{
+		g_object_get (tcp, "remote-port", &port, NULL);
+		g_object_unref (tcp);
+	}
+
+	key = g_strdup_printf ("%s:%u", host ? host : "unknown", port);
+	g_free (host);
+
+	return key;
+}
@@ -5,8 +5,10 @@
 
 #include <gtk/gtk.h>
 #include <libinfinity/common/inf-protocol.h>
+#include <libinfinity/common/inf-xml-connection.h>
 
 #define DEFAULT_INFINOTE_PORT (inf_protocol_get_default_port ())
+#define COLLABORATION_SETTINGS "org.gnome.gedit.plugins.collaboration"
 
 G_BEGIN_DECLS
 
@@ -14,7 +16,10 @@ G_BEGIN_DECLS
 
 enum
 {
-	GEDIT_COLLABORATION_ERROR_SESSION_CLOSED
+	GEDIT_COLLABORATION_ERROR_SESSION_CLOSED,
+	GEDIT_COLLABORATION_ERROR_INVALID_LOCATION,
+	GEDIT_COLLABORATION_ERROR_NOT_FOUND,
+	GEDIT_COLLABORATION_ERROR_CONNECTION_FAILED
 };
 
 GQuark gedit_collaboration_error_quark (void);
@@ -32,6 +37,8 @@ GtkBuilder *gedit_collaboration_create_builder (const gchar *data_dir,
 gchar *gedit_collaboration_generate_new_name (const gchar *name,
                                               gint        *name_failed_counter);
 
+gchar *gedit_collaboration_get_server_key (InfXmlConnection *connection);
+
 G_END_DECLS
 
 #endif /* __GEDIT_COLLABORATION_H__ */